@@ -0,0 +1,229 @@
+/***
+Copyright (c) 2019, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2019>: Arthur Glowacki
+#include "cpu_info.h"
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+#if defined _WIN32 || defined __CYGWIN__
+#include "windows.h"
+#else
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+// ----------------------------------------------------------------------------
+
+// parse a linux cpulist string such as 0-7,16-23
+static std::vector<size_t> parse_cpu_list(const std::string& cpu_list)
+{
+    std::vector<size_t> cores;
+    std::stringstream ss(cpu_list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.length() == 0 || item[0] < '0' || item[0] > '9')
+        {
+            continue;
+        }
+        size_t idx = item.find('-');
+        if (idx != std::string::npos)
+        {
+            size_t start = std::stoul(item.substr(0, idx));
+            size_t end = std::stoul(item.substr(idx + 1));
+            for (size_t c = start; c <= end; c++)
+            {
+                cores.push_back(c);
+            }
+        }
+        else
+        {
+            cores.push_back(std::stoul(item));
+        }
+    }
+    return cores;
+}
+
+// ----------------------------------------------------------------------------
+
+// cpus the process is allowed on, the cgroup cpuset shows up in the affinity mask. false if the mask is unknown
+static bool get_allowed_cores(std::vector<bool>& allowed)
+{
+#if defined _WIN32 || defined __CYGWIN__
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == 0)
+    {
+        return false;
+    }
+    allowed.assign(sizeof(DWORD_PTR) * 8, false);
+    for (size_t c = 0; c < allowed.size(); c++)
+    {
+        allowed[c] = ((process_mask >> c) & 1) != 0;
+    }
+    return true;
+#else
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) != 0)
+    {
+        return false;
+    }
+    allowed.assign(CPU_SETSIZE, false);
+    for (size_t c = 0; c < allowed.size(); c++)
+    {
+        allowed[c] = CPU_ISSET(c, &cpuset) != 0;
+    }
+    return true;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<std::vector<size_t> > get_numa_node_cores()
+{
+    std::vector<std::vector<size_t> > nodes;
+    std::vector<bool> allowed;
+    bool has_mask = get_allowed_cores(allowed);
+    auto is_allowed = [&](size_t c) { return false == has_mask || (c < allowed.size() && allowed[c]); };
+#if !defined _WIN32 && !defined __CYGWIN__
+    for (size_t node = 0; ; node++)
+    {
+        std::ifstream file_io("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (false == file_io.is_open())
+        {
+            break;
+        }
+        std::string cpu_list;
+        std::getline(file_io, cpu_list);
+        std::vector<size_t> cores = parse_cpu_list(cpu_list);
+        cores.erase(std::remove_if(cores.begin(), cores.end(), [&](size_t c) { return false == is_allowed(c); }), cores.end());
+        if (cores.size() > 0)
+        {
+            nodes.push_back(cores);
+        }
+    }
+#endif
+    if (nodes.size() == 0)
+    {
+        std::vector<size_t> cores;
+        size_t num_cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t c = 0; c < num_cores; c++)
+        {
+            if (is_allowed(c))
+            {
+                cores.push_back(c);
+            }
+        }
+        if (cores.size() == 0)
+        {
+            cores.push_back(0);
+        }
+        nodes.push_back(cores);
+    }
+    return nodes;
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<size_t> get_interleaved_cores()
+{
+    std::vector<std::vector<size_t> > nodes = get_numa_node_cores();
+    std::vector<size_t> cores;
+    size_t max_node_size = 0;
+    for (const auto& node : nodes)
+    {
+        max_node_size = std::max(max_node_size, node.size());
+    }
+    for (size_t i = 0; i < max_node_size; i++)
+    {
+        for (const auto& node : nodes)
+        {
+            if (i < node.size())
+            {
+                cores.push_back(node[i]);
+            }
+        }
+    }
+    return cores;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t get_numa_node_of_core(size_t core)
+{
+    std::vector<std::vector<size_t> > nodes = get_numa_node_cores();
+    for (size_t n = 0; n < nodes.size(); n++)
+    {
+        for (size_t c : nodes[n])
+        {
+            if (c == core)
+            {
+                return n;
+            }
+        }
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+bool pin_current_thread(size_t core)
+{
+#if defined _WIN32 || defined __CYGWIN__
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#else
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+#endif
+}
+
+// ----------------------------------------------------------------------------
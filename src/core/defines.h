@@ -69,6 +69,9 @@ static std::time_t now_c;
   #define H5T_INTEL_R H5T_INTEL_F64
 #endif
 
+// samples are stored as real_t, long sums (integrated spectra, optimizer internals) are carried out in compute_t
+#define compute_t double
+
 #if defined _WIN32 || defined __CYGWIN__
   #pragma warning( disable : 4251 4127 4996 4505 4244 )
   #define DIR_END_CHAR '\\'
@@ -58,6 +58,10 @@ void help()
     logit_s<<"Usage: xrf_maps [Options] --dir [dataset directory] \n\n";
     logit_s<<"Options: \n";
     logit_s<<"--nthreads : <int> number of threads to use (default is all system threads) \n";
+    logit_s<<"--work-stealing : Use per thread work stealing task queues instead of one shared queue. \n";
+    logit_s<<"--tile-size <rows>,<cols> : Number of pixels fitted per job (default 1,32). \n";
+    logit_s<<"--pin-threads : Pin worker and sink threads to cpu cores. \n";
+    logit_s<<"--numa-aware : Pin threads and fit rows on the numa node that holds them (implies --work-stealing). \n";
     logit_s<<"--quantify-with : <standard.txt> File to use as quantification standard \n";
     logit_s<<"--detectors : <int,..> Detectors to process, Defaults to 0,1,2,3 for 4 detector \n";
     logit_s<<"--generate-avg-h5 : Generate .h5 file which is the average of all detectors .h50 - h.53 or range specified. \n";
@@ -69,10 +73,16 @@ void help()
 	logit_s << "--update-amps <us_amp>,<ds_amp>: Updates upstream and downstream amps if they changed inbetween scans.\n";
 	logit_s << "--update-quant-amps <us_amp>,<ds_amp>: Updates upstream and downstream amps for quantification if they changed inbetween scans.\n";
     logit_s<<"--quick-and-dirty : Integrate the detector range into 1 spectra.\n";
-//	logit_s<< "--mem-limit <limit> : Limit the memory usage. Append M for megabytes or G for gigabytes\n";
+	logit_s<< "--mem-limit <limit> : Limit the memory usage of streamed spectra, or of out of core spectra volumes. Append M for megabytes or G for gigabytes\n";
+    logit_s<<"--out-of-core <dir> : Keep spectra volumes in a memory mapped scratch file in <dir> instead of memory. \n";
+    logit_s<<"--telemetry <file> : Write stream pipeline queue depths, throughput and latencies to a json lines file (csv if it ends in .csv). \n";
+    logit_s<<"--telemetry-period <sec> : Seconds between telemetry snapshots (default 5). \n";
+    logit_s<<"--telemetry-zmq : Publish telemetry on the XRF-Telemetry topic when streaming out. \n";
     logit_s<<"--optimize-fit-override-params : <int> Integrate the 8 largest mda datasets and fit with multiple params.\n"<<
                "  1 = matrix batch fit\n  2 = batch fit without tails\n  3 = batch fit with tails\n  4 = batch fit with free E, everything else fixed \n";
     logit_s<<"--optimizer <lmfit, mpfit> : Choose which optimizer to use for --optimize-fit-override-params or matrix fit routine \n";
+    logit_s<<"--jacobian <numeric, analytic, check> : How the optimizer gets parameter derivatives. numeric (default) uses finite differences, analytic the model's own derivatives, check logs both before fitting numerically. \n";
+    logit_s<<"--line-window <sigmas> : Model each line only within +-sigmas of its energy, widened for step and tail (default 8, 0 for the whole fit range). \n";
     logit_s<<"Fitting Routines: \n";
 	logit_s<< "--fit <routines,> comma seperated \n";
     logit_s<<"  roi : element energy region of interest \n";
@@ -130,6 +140,38 @@ int main(int argc, char *argv[])
         analysis_job.num_threads = std::stoi(clp.get_option("--nthreads"));
     }
 
+    if ( clp.option_exists("--work-stealing") )
+    {
+        analysis_job.thread_pool_mode = Thread_Pool_Mode::WORK_STEALING;
+    }
+
+    if ( clp.option_exists("--pin-threads") )
+    {
+        analysis_job.pin_threads = true;
+    }
+
+    if ( clp.option_exists("--numa-aware") )
+    {
+        analysis_job.numa_aware = true;
+        analysis_job.pin_threads = true;
+        analysis_job.thread_pool_mode = Thread_Pool_Mode::WORK_STEALING;
+    }
+
+    if ( clp.option_exists("--tile-size") )
+    {
+        string tile_size = clp.get_option("--tile-size");
+        size_t idx = tile_size.find(',');
+        if (idx != string::npos)
+        {
+            analysis_job.tile_rows = std::stoi(tile_size.substr(0, idx));
+            analysis_job.tile_cols = std::stoi(tile_size.substr(idx+1));
+        }
+        else
+        {
+            logW << "Could not find ',' while parsing --tile-size\n";
+        }
+    }
+
     //Look for which analysis types we want to run
 	if (clp.option_exists("--fit"))
 	{
@@ -201,21 +243,59 @@ int main(int argc, char *argv[])
 	if (clp.option_exists("--mem-limit"))
 	{
 		 std::string memlimit = clp.get_option("--mem-limit");
-		 if (memlimit.rfind('M'))
+		 long long multiplier = 0;
+		 if (memlimit.length() > 1 && std::toupper(memlimit.back()) == 'M')
 		 {
-
+			 multiplier = 1024LL * 1024LL;
 		 }
-		 else if (memlimit.rfind('G'))
+		 else if (memlimit.length() > 1 && std::toupper(memlimit.back()) == 'G')
 		 {
+			 multiplier = 1024LL * 1024LL * 1024LL;
+		 }
 
+		 if (multiplier > 0 && std::isdigit(memlimit[0]))
+		 {
+			 analysis_job.mem_limit = std::stoll(memlimit.substr(0, memlimit.length() - 1)) * multiplier;
 		 }
 		 else
 		 {
 			 logW << "Could not parse --mem-limit parameter. Make sure to use M for megabytes or G for gigabytes. ex 200M\n";
 		 }
-		 //analysis_job.mem_limit = ;
 	}
 
+    if (clp.option_exists("--out-of-core"))
+    {
+        analysis_job.scratch_dir = clp.get_option("--out-of-core");
+    }
+
+    if (clp.option_exists("--line-window"))
+    {
+        analysis_job.line_window_sigmas = std::stof(clp.get_option("--line-window"));
+        if (analysis_job.line_window_sigmas > 0.0)
+        {
+            logI << "Modeling lines within +-" << analysis_job.line_window_sigmas << " sigma, at most " << fitting::models::Gaussian_Model::line_window_error(analysis_job.line_window_sigmas) << " of each line is truncated\n";
+        }
+        else
+        {
+            logI << "Modeling lines over the whole fit range\n";
+        }
+    }
+
+    if (clp.option_exists("--telemetry"))
+    {
+        analysis_job.telemetry_file = clp.get_option("--telemetry");
+    }
+
+    if (clp.option_exists("--telemetry-period"))
+    {
+        analysis_job.telemetry_period = std::stof(clp.get_option("--telemetry-period"));
+    }
+
+    if (clp.option_exists("--telemetry-zmq"))
+    {
+        analysis_job.telemetry_zmq = true;
+    }
+
     //Do we want to optimize our fitting parameters
     if( clp.option_exists("--optimize-fit-override-params") )
     {
@@ -250,6 +330,17 @@ int main(int argc, char *argv[])
         analysis_job.set_optimizer(clp.get_option("--optimizer"));
     }
 
+    //Analytic derivatives for the optimizer. Default is finite differences
+    if( clp.option_exists("--jacobian"))
+    {
+        std::string jacobian_mode = clp.get_option("--jacobian");
+        if (jacobian_mode != "numeric" && jacobian_mode != "analytic" && jacobian_mode != "check")
+        {
+            logW << "Unknown --jacobian " << jacobian_mode << ", using numeric\n";
+        }
+        analysis_job.set_jacobian_mode(jacobian_mode);
+    }
+
     //Should we sum up all the detectors and process it as one?
     if( clp.option_exists("--quick-and-dirty"))
     {
@@ -50,16 +50,28 @@ POSSIBILITY OF SUCH DAMAGE.
 // ----------------------------------------------------------------------------
 
 data_struct::Stream_Block* proc_spectra_block( data_struct::Stream_Block* stream_block )
+{
+    return counts_per_sec_block( fit_spectra_block(stream_block) );
+}
+
+// ----------------------------------------------------------------------------
+
+data_struct::Stream_Block* fit_spectra_block( data_struct::Stream_Block* stream_block,
+                                              const std::unordered_map<Fitting_Routines, workflow::Latency_Histogram*>* fit_latency )
 {
 
     for(auto &itr : stream_block->fitting_blocks)
     {
         std::unordered_map<std::string, real_t> counts_dict;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         stream_block->fitting_blocks[itr.first].fit_routine->fit_spectra(stream_block->model, stream_block->spectra, stream_block->elements_to_fit, counts_dict);
-        //make count / sec
+        if(fit_latency != nullptr && fit_latency->count(itr.first) > 0)
+        {
+            fit_latency->at(itr.first)->add(start, std::chrono::steady_clock::now());
+        }
         for (auto& el_itr : *(stream_block->elements_to_fit))
         {
-            stream_block->fitting_blocks[itr.first].fit_counts[el_itr.first] = counts_dict[el_itr.first] / stream_block->spectra->elapsed_livetime();
+            stream_block->fitting_blocks[itr.first].fit_counts[el_itr.first] = counts_dict[el_itr.first];
         }
         stream_block->fitting_blocks[itr.first].fit_counts[STR_NUM_ITR] = counts_dict[STR_NUM_ITR];
     }
@@ -68,11 +80,31 @@ data_struct::Stream_Block* proc_spectra_block( data_struct::Stream_Block* stream
 
 // ----------------------------------------------------------------------------
 
+data_struct::Stream_Block* counts_per_sec_block( data_struct::Stream_Block* stream_block )
+{
+    if(stream_block->spectra == nullptr || stream_block->elements_to_fit == nullptr)
+    {
+        return stream_block;
+    }
+    real_t livetime = stream_block->spectra->elapsed_livetime();
+    for(auto &itr : stream_block->fitting_blocks)
+    {
+        for (auto& el_itr : *(stream_block->elements_to_fit))
+        {
+            itr.second.fit_counts[el_itr.first] /= livetime;
+        }
+    }
+    return stream_block;
+}
+
+// ----------------------------------------------------------------------------
+
 void run_stream_pipeline(data_struct::Analysis_Job* job)
 {
     workflow::Source<data_struct::Stream_Block*> *source;
-    workflow::Distributor<data_struct::Stream_Block*, data_struct::Stream_Block*> distributor(job->num_threads);
+    workflow::Pipeline<data_struct::Stream_Block*> pipeline;
     workflow::Sink<data_struct::Stream_Block*> *sink;
+    workflow::xrf::Spectra_Net_Streamer *net_streamer = nullptr;
 
     //setup input
     if(job->quick_and_dirty)
@@ -98,21 +130,54 @@ void run_stream_pipeline(data_struct::Analysis_Job* job)
     //setup output
     if(job->stream_over_network)
     {
-        sink = new workflow::xrf::Spectra_Net_Streamer(job->network_stream_port);
+        net_streamer = new workflow::xrf::Spectra_Net_Streamer(job->network_stream_port);
+        sink = net_streamer;
     }
     else
     {
         sink = new workflow::xrf::Spectra_Stream_Saver();
     }
 
-    distributor.set_function(proc_spectra_block);
-    source->connect(&distributor);
-    sink->connect(&distributor);
+    // fit latency per routine, created up front so the fit threads only read the map
+    std::unordered_map<Fitting_Routines, workflow::Latency_Histogram*> fit_latency;
+    for(const auto &itr : job->fitting_routines)
+    {
+        fit_latency[itr] = pipeline.telemetry()->histogram("fit " + data_struct::Fitting_Routine_To_Str.at(itr));
+    }
+
+    // load (source thread) -> fit -> counts per sec -> save (sink)
+    pipeline.add_stage("fit", [&fit_latency](data_struct::Stream_Block* stream_block) { return fit_spectra_block(stream_block, &fit_latency); }, job->num_threads);
+    pipeline.add_stage("counts_per_sec", counts_per_sec_block, 1);
+    pipeline.connect_source(source);
+    pipeline.connect_sink(sink);
+    // hand blocks to the sink as soon as they are fit, the saver reorders rows itself
+    pipeline.set_ordered(false);
+    pipeline.set_pin_threads(job->pin_threads);
+
+    std::function<void (const std::string&)> publish_func = nullptr;
+    if(job->telemetry_zmq)
+    {
+        if(net_streamer != nullptr)
+        {
+            publish_func = [net_streamer](const std::string& data) { net_streamer->publish("XRF-Telemetry", data); };
+        }
+        else
+        {
+            logW << "--telemetry-zmq needs --streamout, not publishing telemetry\n";
+        }
+    }
+    if(job->telemetry_file.length() > 0 || publish_func != nullptr)
+    {
+        pipeline.telemetry()->start_reporting(job->telemetry_file, job->telemetry_period, publish_func);
+    }
+
+    pipeline.run();
 
+    pipeline.telemetry()->stop_reporting();
+    pipeline.telemetry()->log_summary();
 
-    sink->start();
-    source->run();
-    sink->wait_and_stop();
+    logI << "Source stalled " << pipeline.producer_stall_count() << " times for " << pipeline.producer_stall_seconds() << "s waiting on a full queue\n";
+    logI << "Stream block pool allocated " << data_struct::Stream_Block_Pool::inst()->num_allocated() << " and reused " << data_struct::Stream_Block_Pool::inst()->num_reused() << " blocks and spectra\n";
 
     delete source;
     delete sink;
@@ -71,6 +71,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "core/command_line_parser.h"
 #include "data_struct/stream_block.h"
 #include "workflow/pipeline.h"
+#include "workflow/telemetry.h"
 #include "workflow/xrf/spectra_file_source.h"
 #include "workflow/xrf/integrated_spectra_source.h"
 #include "workflow/xrf/detector_sum_spectra_source.h"
@@ -82,6 +83,18 @@ POSSIBILITY OF SUCH DAMAGE.
 
 DLL_EXPORT data_struct::Stream_Block* proc_spectra_block( data_struct::Stream_Block* stream_block );
 
+// ----------------------------------------------------------------------------
+
+// fit_latency is optional, fit time of each routine is added to its histogram
+DLL_EXPORT data_struct::Stream_Block* fit_spectra_block( data_struct::Stream_Block* stream_block,
+                                                         const std::unordered_map<Fitting_Routines, workflow::Latency_Histogram*>* fit_latency = nullptr );
+
+// ----------------------------------------------------------------------------
+
+DLL_EXPORT data_struct::Stream_Block* counts_per_sec_block( data_struct::Stream_Block* stream_block );
+
+// ----------------------------------------------------------------------------
+
 DLL_EXPORT void run_stream_pipeline(data_struct::Analysis_Job* job);
 
 DLL_EXPORT void stream_spectra(data_struct::Analysis_Job* job);
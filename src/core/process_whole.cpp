@@ -46,88 +46,329 @@ POSSIBILITY OF SUCH DAMAGE.
 /// Initial Author <2017>: Arthur Glowacki
 
 #include "core/process_whole.h"
+#include "core/mem_info.h"
 
 using namespace std::placeholders; //for _1, _2,
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
-template<typename T>
-data_struct::Fit_Count_Dict* generate_fit_count_dict(std::unordered_map<std::string, T> *elements_to_fit, size_t height, size_t width, bool alloc_iter_count)
+bool fit_single_spectra(fitting::routines::Base_Fit_Routine * fit_routine,
+                        const fitting::models::Base_Model * const model,
+                        const data_struct::Spectra * const spectra,
+                        const data_struct::Fit_Element_Map_Dict * const elements_to_fit,
+                        data_struct::Fit_Count_Volume * out_fit_counts,
+                        size_t i,
+                        size_t j,
+                        const data_struct::Sparse_Spectra * const sparse_spectra)
 {
-    data_struct::Fit_Count_Dict* element_fit_counts_dict = new data_struct::Fit_Count_Dict();
-    for(auto& e_itr : *elements_to_fit)
+    // counts come back by index in the dict's iteration order, the layout maps them to channels
+    const data_struct::Fit_Count_Layout* layout = &out_fit_counts->layout();
+    data_struct::Fit_Count_Layout other_layout;
+    if (layout->elements != elements_to_fit || layout->channels.size() != elements_to_fit->size())
+    {
+        out_fit_counts->make_layout(elements_to_fit, other_layout);
+        layout = &other_layout;
+    }
+    const size_t num_elements = layout->channels.size();
+    static thread_local std::vector<real_t> counts;
+    counts.assign(num_elements + 2, (real_t)0.0);
+    if (sparse_spectra != nullptr)
+    {
+        fit_routine->fit_sparse_spectra_counts(model, spectra, sparse_spectra, elements_to_fit, counts.data());
+    }
+    else
+    {
+        fit_routine->fit_spectra_counts(model, spectra, elements_to_fit, counts.data());
+    }
+    //save count / sec
+    for (size_t k = 0; k < num_elements; k++)
+    {
+        if (layout->channels[k] > -1)
+        {
+            (*out_fit_counts)(layout->channels[k], i, j) = counts[k] / spectra->elapsed_livetime();
+        }
+    }
+    int num_itr_idx = out_fit_counts->num_iter_channel();
+    if (num_itr_idx > -1)
+    {
+        (*out_fit_counts)(num_itr_idx, i, j) = counts[num_elements];
+    }
+    int residual_idx = out_fit_counts->residual_channel();
+    if (residual_idx > -1)
+    {
+        (*out_fit_counts)(residual_idx, i, j) = counts[num_elements + 1];
+    }
+    int tfy_idx = out_fit_counts->total_fluorescence_yield_channel();
+    int sum_scatter_idx = out_fit_counts->sum_elastic_inelastic_channel();
+	// add sum coherent and compton
+	if (sum_scatter_idx > -1 && layout->coherent_amplitude > -1 && layout->compton_amplitude > -1)
+	{
+		(*out_fit_counts)(sum_scatter_idx, i, j) = counts[layout->coherent_amplitude] + counts[layout->compton_amplitude];
+        // add total fluorescense yield
+        if (tfy_idx > -1)
+        {                   //                                      (sum - (elastic + inelastic)) / live time
+            (*out_fit_counts)(tfy_idx, i, j) = ( spectra->sum() - (*out_fit_counts)(sum_scatter_idx, i, j) ) / spectra->elapsed_livetime();
+        }
+	}
+    else
     {
-        element_fit_counts_dict->emplace(std::pair<std::string, data_struct::ArrayXXr >(e_itr.first, data_struct::ArrayXXr()) );
-        element_fit_counts_dict->at(e_itr.first).resize(height, width);
+        // add total fluorescense yield
+        if (tfy_idx > -1)
+        {
+            (*out_fit_counts)(tfy_idx, i, j) = spectra->sum() / spectra->elapsed_livetime();
+        }
     }
 
-    if (alloc_iter_count)
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t resident_row_limit(const data_struct::Spectra_Volume * spectra_volume, ThreadPool* tp, size_t tile_rows, long long mem_limit)
+{
+    // every worker holds a tile and the next one is prefetched
+    size_t min_rows = 2 * tile_rows * std::max((size_t)1, (size_t)tp->size());
+    if (mem_limit <= 0)
     {
-        //Allocate memeory to save number of fit iterations
-        element_fit_counts_dict->emplace(std::pair<std::string, data_struct::ArrayXXr >(STR_NUM_ITR, data_struct::ArrayXXr() ));
-        element_fit_counts_dict->at(STR_NUM_ITR).resize(height, width);
-        element_fit_counts_dict->emplace(std::pair<std::string, data_struct::ArrayXXr >(STR_RESIDUAL, data_struct::ArrayXXr()));
-        element_fit_counts_dict->at(STR_RESIDUAL).resize(height, width);
+        mem_limit = get_available_mem() / 2;
     }
+    size_t row_bytes = std::max((size_t)1, spectra_volume->row_bytes());
+    return std::max(min_rows, (size_t)std::max(0LL, mem_limit) / row_bytes);
+}
 
-	//  TOTAL_FLUORESCENCE_YIELD
-	element_fit_counts_dict->emplace(std::pair<std::string, data_struct::ArrayXXr >(STR_TOTAL_FLUORESCENCE_YIELD, data_struct::ArrayXXr()));
-	element_fit_counts_dict->at(STR_TOTAL_FLUORESCENCE_YIELD).resize(height, width);
+// ----------------------------------------------------------------------------
 
-	//SUM_ELASTIC_INELASTIC
-	element_fit_counts_dict->emplace(std::pair<std::string, data_struct::ArrayXXr >(STR_SUM_ELASTIC_INELASTIC_AMP , data_struct::ArrayXXr()));
-	element_fit_counts_dict->at(STR_SUM_ELASTIC_INELASTIC_AMP).resize(height, width);
+void advance_resident_rows(data_struct::Spectra_Volume * spectra_volume,
+                           Resident_Row_Window * window,
+                           size_t row_start,
+                           size_t row_end)
+{
+    std::unique_lock<std::mutex> lock(window->mutex);
+    size_t next_end = std::min(row_end + (row_end - row_start), spectra_volume->rows());
+    next_end = std::min(next_end, window->first_row + window->max_rows);
+    if (next_end > window->prefetch_row)
+    {
+        spectra_volume->prefetch_rows(std::max(row_end, window->prefetch_row), next_end);
+        window->prefetch_row = next_end;
+    }
+}
 
+// ----------------------------------------------------------------------------
 
-    return element_fit_counts_dict;
+void release_fitted_rows(data_struct::Spectra_Volume * spectra_volume,
+                         Resident_Row_Window * window,
+                         size_t row_start,
+                         size_t row_end,
+                         size_t num_cols)
+{
+    std::unique_lock<std::mutex> lock(window->mutex);
+    for (size_t i = row_start; i < row_end && i < window->cols_done.size(); i++)
+    {
+        window->cols_done[i] += num_cols;
+    }
+    // stolen tiles finish out of row order, only a fully fitted prefix is safe to drop
+    size_t release_end = window->first_row;
+    while (release_end < window->cols_done.size() && window->cols_done[release_end] >= window->cols)
+    {
+        release_end++;
+    }
+    if (release_end > window->first_row)
+    {
+        spectra_volume->release_rows(window->first_row, release_end);
+        window->first_row = release_end;
+    }
 }
 
 // ----------------------------------------------------------------------------
 
-bool fit_single_spectra(fitting::routines::Base_Fit_Routine * fit_routine,
-                        const fitting::models::Base_Model * const model,
-                        const data_struct::Spectra * const spectra,
-                        const data_struct::Fit_Element_Map_Dict * const elements_to_fit,
-                        data_struct::Fit_Count_Dict * out_fit_counts,
-                        size_t i,
-                        size_t j)
+void fit_spectra_tile(fitting::routines::Base_Fit_Routine * fit_routine,
+                      const fitting::models::Base_Model * const model,
+                      data_struct::Spectra_Volume * spectra_volume,
+                      const data_struct::Fit_Element_Map_Dict * const elements_to_fit,
+                      data_struct::Fit_Count_Volume * out_fit_counts,
+                      size_t row_start,
+                      size_t row_end,
+                      size_t col_start,
+                      size_t col_end,
+                      Fit_Tile_Counter * counter,
+                      Resident_Row_Window * window)
 {
-    std::unordered_map<std::string, real_t> counts_dict;
-    fit_routine->fit_spectra(model, spectra, elements_to_fit, counts_dict);
-    //save count / sec
-    for (auto& el_itr : *elements_to_fit)
+    try
     {
-        (*out_fit_counts)[el_itr.first](i,j) = counts_dict[el_itr.first] / spectra->elapsed_livetime();
+        if (window != nullptr)
+        {
+            advance_resident_rows(spectra_volume, window, row_start, row_end);
+        }
+        // compact volumes are converted to real_t one pixel at a time, right before the fit
+        bool compact = (spectra_volume->storage() != data_struct::Volume_Storage::REAL);
+        bool use_sparse = fit_routine->supports_sparse();
+        data_struct::Spectra pixel;
+        data_struct::Sparse_Spectra sparse_pixel;
+        for(size_t i=row_start; i<row_end; i++)
+        {
+            for(size_t j=col_start; j<col_end; j++)
+            {
+                const data_struct::Spectra *spectra = &(*spectra_volume)[i][j];
+                if (compact)
+                {
+                    spectra_volume->pixel_spectra(i, j, pixel);
+                    spectra = &pixel;
+                }
+                // low count pixels are fit from their nonzero channels
+                if (use_sparse && sparse_pixel.from_dense(*spectra))
+                {
+                    fit_single_spectra(fit_routine, model, spectra, elements_to_fit, out_fit_counts, i, j, &sparse_pixel);
+                }
+                else
+                {
+                    fit_single_spectra(fit_routine, model, spectra, elements_to_fit, out_fit_counts, i, j);
+                }
+            }
+        }
+    }
+    catch(std::exception& e)
+    {
+        logE << "Failed to fit tile rows [" << row_start << ":" << row_end << "] cols [" << col_start << ":" << col_end << "] : " << e.what() << "\n";
+    }
+    if (window != nullptr)
+    {
+        release_fitted_rows(spectra_volume, window, row_start, row_end, col_end - col_start);
+    }
+    // always count the tile so proc_spectra does not wait forever.
+    // notify under the lock, the counter lives on the waiter's stack and is gone once it sees the last tile
+    {
+        std::unique_lock<std::mutex> lock(counter->mutex);
+        counter->tiles_done++;
+        counter->cond.notify_one();
     }
-    (*out_fit_counts)[STR_NUM_ITR](i,j) = counts_dict[STR_NUM_ITR];
+}
 
-    (*out_fit_counts)[STR_RESIDUAL](i, j) = counts_dict[STR_RESIDUAL];
-	// add total fluorescense yield
-	if (out_fit_counts->count(STR_TOTAL_FLUORESCENCE_YIELD))
-	{
-		(*out_fit_counts)[STR_TOTAL_FLUORESCENCE_YIELD](i, j) = spectra->sum();
-	}
-	// add sum coherent and compton
-	if (out_fit_counts->count(STR_SUM_ELASTIC_INELASTIC_AMP) > 0  && counts_dict.count(STR_COHERENT_SCT_AMPLITUDE) > 0 && counts_dict.count(STR_COMPTON_AMPLITUDE) > 0)
-	{
-		(*out_fit_counts)[STR_SUM_ELASTIC_INELASTIC_AMP](i, j) = counts_dict[STR_COHERENT_SCT_AMPLITUDE] + counts_dict[STR_COMPTON_AMPLITUDE];
-        // add total fluorescense yield
-        if (out_fit_counts->count(STR_TOTAL_FLUORESCENCE_YIELD))
-        {                   //                                      (sum - (elastic + inelastic)) / live time
-            (*out_fit_counts)[STR_TOTAL_FLUORESCENCE_YIELD](i, j) = ( spectra->sum() - (*out_fit_counts)[STR_SUM_ELASTIC_INELASTIC_AMP](i, j) ) / spectra->elapsed_livetime();
+// ----------------------------------------------------------------------------
+
+void localize_spectra_tile(data_struct::Spectra_Volume * spectra_volume,
+                           size_t row_start,
+                           size_t row_end,
+                           size_t col_start,
+                           size_t col_end,
+                           Fit_Tile_Counter * counter)
+{
+    spectra_volume->relocate_tile(row_start, row_end, col_start, col_end);
+    {
+        std::unique_lock<std::mutex> lock(counter->mutex);
+        counter->tiles_done++;
+        counter->cond.notify_one();
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<Tile_Row_Range> generate_row_ranges(ThreadPool* tp, size_t rows, bool numa_aware)
+{
+    std::vector<Tile_Row_Range> row_ranges;
+    const std::vector<size_t> &worker_cores = tp->worker_cores();
+
+    if (numa_aware && tp->mode() == Thread_Pool_Mode::WORK_STEALING && worker_cores.size() == tp->size())
+    {
+        std::map<size_t, std::vector<size_t> > node_workers;
+        for (size_t w = 0; w < worker_cores.size(); w++)
+        {
+            node_workers[get_numa_node_of_core(worker_cores[w])].push_back(w);
         }
-	}
+        size_t row_start = 0;
+        size_t workers_assigned = 0;
+        for (auto &itr : node_workers)
+        {
+            workers_assigned += itr.second.size();
+            Tile_Row_Range range;
+            range.row_start = row_start;
+            range.row_end = (rows * workers_assigned) / worker_cores.size();
+            range.workers = itr.second;
+            row_start = range.row_end;
+            row_ranges.push_back(range);
+        }
+    }
     else
     {
-        // add total fluorescense yield
-        if (out_fit_counts->count(STR_TOTAL_FLUORESCENCE_YIELD))
+        Tile_Row_Range range;
+        range.row_start = 0;
+        range.row_end = rows;
+        row_ranges.push_back(range);
+    }
+    return row_ranges;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t submit_tiles(ThreadPool* tp,
+                    const std::vector<Tile_Row_Range>& row_ranges,
+                    size_t cols,
+                    size_t tile_rows,
+                    size_t tile_cols,
+                    std::function<void(size_t, size_t, size_t, size_t)> tile_func)
+{
+    size_t total_tiles = 0;
+    for (const auto &range : row_ranges)
+    {
+        size_t next_worker = 0;
+        for(size_t i=range.row_start; i<range.row_end; i+=tile_rows)
         {
-            (*out_fit_counts)[STR_TOTAL_FLUORESCENCE_YIELD](i, j) = spectra->sum() / spectra->elapsed_livetime();
+            size_t row_end = std::min(i + tile_rows, range.row_end);
+            for(size_t j=0; j<cols; j+=tile_cols)
+            {
+                size_t col_end = std::min(j + tile_cols, cols);
+                if (range.workers.size() > 0)
+                {
+                    tp->enqueue_to(range.workers[next_worker % range.workers.size()], tile_func, i, row_end, j, col_end);
+                    next_worker++;
+                }
+                else
+                {
+                    tp->enqueue(tile_func, i, row_end, j, col_end);
+                }
+                total_tiles++;
+            }
         }
     }
+    return total_tiles;
+}
 
-    return true;
+// ----------------------------------------------------------------------------
+
+void wait_for_tiles(Fit_Tile_Counter * counter, size_t total_tiles, Callback_Func_Status_Def* status_callback)
+{
+    size_t total_blocks = total_tiles - 1;
+    size_t cur_block = 0;
+    while(cur_block < total_tiles)
+    {
+        size_t tiles_done;
+        {
+            std::unique_lock<std::mutex> lock(counter->mutex);
+            counter->cond.wait(lock, [counter, cur_block]{ return counter->tiles_done > cur_block; });
+            tiles_done = counter->tiles_done;
+        }
+        for(; cur_block < tiles_done; cur_block++)
+        {
+            if (status_callback != nullptr)
+            {
+                (*status_callback)(cur_block, total_blocks);
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void pin_thread_pool(ThreadPool* tp)
+{
+    if (tp->pin_workers(get_interleaved_cores()))
+    {
+        logI << "Pinned " << tp->size() << " worker threads over " << get_numa_node_cores().size() << " numa node(s)\n";
+    }
+    else
+    {
+        logW << "Failed to pin worker threads to cores\n";
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -289,7 +530,11 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
                   data_struct::Detector * detector,
                   ThreadPool* tp,
                   bool save_spec_vol,
-                  Callback_Func_Status_Def* status_callback)
+                  Callback_Func_Status_Def* status_callback,
+                  size_t tile_rows,
+                  size_t tile_cols,
+                  bool numa_aware,
+                  long long mem_limit)
 {
     if (detector == nullptr)
     {
@@ -303,6 +548,15 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
         return;
     }
 
+    if (tile_rows == 0)
+    {
+        tile_rows = 1;
+    }
+    if (tile_cols == 0)
+    {
+        tile_cols = 1;
+    }
+
     data_struct::Params_Override * override_params = &(detector->fit_params_override_dict);
 
     //Range of energy in spectra to fit
@@ -310,6 +564,22 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
 
     std::chrono::time_point<std::chrono::system_clock> start, end;
 
+    // numa aware: every node fits a contiguous block of rows, first copy those rows into memory local to the node
+    std::vector<Tile_Row_Range> row_ranges = generate_row_ranges(tp, spectra_volume->rows(), numa_aware);
+    if (row_ranges.size() > 1 && spectra_volume->storage() == data_struct::Volume_Storage::REAL && false == spectra_volume->is_out_of_core())
+    {
+        start = std::chrono::system_clock::now();
+        Fit_Tile_Counter localize_counter;
+        localize_counter.tiles_done = 0;
+        spectra_volume->begin_relocate();
+        size_t total_tiles = submit_tiles(tp, row_ranges, spectra_volume->cols(), tile_rows, tile_cols,
+                                          std::bind(localize_spectra_tile, spectra_volume, _1, _2, _3, _4, &localize_counter));
+        wait_for_tiles(&localize_counter, total_tiles, nullptr);
+        spectra_volume->end_relocate();
+        std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start;
+        logI << "Moved spectra to " << row_ranges.size() << " numa nodes in " << elapsed_seconds.count() << "s\n";
+    }
+
     for(auto &itr : detector->fit_routines)
     {
         fitting::routines::Base_Fit_Routine *fit_routine = itr.second;
@@ -323,50 +593,57 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
             continue;
         }
 
-		//Fit job queue
-		std::queue<std::future<bool> >* fit_job_queue = new std::queue<std::future<bool> >();
-
         //Allocate memeory to save fit counts
-        data_struct::Fit_Count_Dict  *element_fit_count_dict = generate_fit_count_dict(&override_params->elements_to_fit, spectra_volume->rows(), spectra_volume->cols(), true);
-
-        for(size_t i=0; i<spectra_volume->rows(); i++)
+        data_struct::Fit_Count_Volume element_fit_counts;
+        element_fit_counts.init(&override_params->elements_to_fit, spectra_volume->rows(), spectra_volume->cols(), true);
+
+        //Out of core volumes are swept from the first row again, keep a bounded window of rows resident
+        Resident_Row_Window row_window;
+        row_window.first_row = 0;
+        row_window.prefetch_row = 0;
+        row_window.max_rows = resident_row_limit(spectra_volume, tp, tile_rows, mem_limit);
+        row_window.cols = spectra_volume->cols();
+        Resident_Row_Window *window = nullptr;
+        if (spectra_volume->is_out_of_core())
         {
-            for(size_t j=0; j<spectra_volume->cols(); j++)
-            {
-                //logD<< i<<" "<<j<<"\n";
-                fit_job_queue->emplace( tp->enqueue(fit_single_spectra, fit_routine, detector->model, &(*spectra_volume)[i][j], &override_params->elements_to_fit, element_fit_count_dict, i, j) );
-            }
+            row_window.cols_done.assign(spectra_volume->rows(), 0);
+            window = &row_window;
+            logI << "Prefetching at most " << row_window.max_rows << " rows of the out of core volume, rows are released once fitted\n";
         }
 
-        size_t total_blocks = (spectra_volume->rows() * spectra_volume->cols()) - 1;
-        size_t cur_block = 0;
-        //wait for queue to finish processing
-        while(!fit_job_queue->empty())
+        //Submit one job per tile, completion is tracked with a counter instead of a future per pixel
+        Fit_Tile_Counter tile_counter;
+        tile_counter.tiles_done = 0;
+        size_t total_tiles = submit_tiles(tp, row_ranges, spectra_volume->cols(), tile_rows, tile_cols,
+                                          std::bind(fit_spectra_tile, fit_routine, detector->model, spectra_volume, &override_params->elements_to_fit, &element_fit_counts, _1, _2, _3, _4, &tile_counter, window));
+
+        //wait for all tiles to finish processing
+        wait_for_tiles(&tile_counter, total_tiles, status_callback);
+
+        if (window != nullptr)
         {
-            auto ret = std::move(fit_job_queue->front());
-            fit_job_queue->pop();
-            ret.get();
-            if (status_callback != nullptr)
-            {
-                (*status_callback)(cur_block, total_blocks);
-            }
-            cur_block++;
+            spectra_volume->release_rows(row_window.first_row, spectra_volume->rows());
         }
 
         std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
         std::chrono::duration<double> elapsed_seconds = end-start;
         logI << "Fitting [ "<< fit_routine->get_name() <<" ] elapsed time: " << elapsed_seconds.count() << "s"<<"\n";
+        if (tp->mode() == Thread_Pool_Mode::WORK_STEALING)
+        {
+            logI << "Work stealing pool: " << tp->size() << " threads, " << tp->num_steals() << " tasks stolen so far, " << row_ranges.size() << " row range(s), pinned: " << (tp->worker_cores().size() > 0) << "\n";
+        }
 
-        io::file::HDF5_IO::inst()->save_element_fits(fit_routine->get_name(), element_fit_count_dict);
+        io::file::HDF5_IO::inst()->save_element_fits(fit_routine->get_name(), &element_fit_counts);
 
         if(itr.first == data_struct::Fitting_Routines::GAUSS_MATRIX || itr.first == data_struct::Fitting_Routines::NNLS)
         {
             fitting::routines::Matrix_Optimized_Fit_Routine* matrix_fit = (fitting::routines::Matrix_Optimized_Fit_Routine*)fit_routine;
+            matrix_fit->finalize_integrated_spectra();
             io::file::HDF5_IO::inst()->save_fitted_int_spectra( fit_routine->get_name(),
 																matrix_fit->fitted_integrated_spectra(),
 																matrix_fit->energy_range(),
                                                                 matrix_fit->fitted_integrated_background(),
-																(*spectra_volume)[0][0].size());
+																spectra_volume->samples_size());
         }
 		if (itr.first == data_struct::Fitting_Routines::GAUSS_MATRIX)
 		{
@@ -377,10 +654,6 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
 																matrix_fit->max_10_integrated_spectra(),
                                                                 matrix_fit->fitted_integrated_background());
 		}
-
-        delete fit_job_queue;
-        element_fit_count_dict->clear();
-        delete element_fit_count_dict;
     }
 
     real_t energy_offset = 0.0;
@@ -414,7 +687,11 @@ void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
 
 void process_dataset_files(data_struct::Analysis_Job* analysis_job, Callback_Func_Status_Def* status_callback)
 {
-    ThreadPool tp(analysis_job->num_threads);
+    ThreadPool tp(analysis_job->num_threads, analysis_job->thread_pool_mode);
+    if (analysis_job->pin_threads)
+    {
+        pin_thread_pool(&tp);
+    }
 
     for(auto &dataset_file : analysis_job->dataset_files)
     {
@@ -433,6 +710,9 @@ void process_dataset_files(data_struct::Analysis_Job* analysis_job, Callback_Fun
 
                 //Spectra volume data
                 data_struct::Spectra_Volume* spectra_volume = new data_struct::Spectra_Volume();
+                // out of core volumes keep the real_t layout in their scratch file
+                spectra_volume->set_allow_compact(analysis_job->scratch_dir.length() == 0);
+                spectra_volume->set_out_of_core(analysis_job->scratch_dir);
 
                 std::string fullpath;
                 size_t dlen = dataset_file.length();
@@ -465,8 +745,11 @@ void process_dataset_files(data_struct::Analysis_Job* analysis_job, Callback_Fun
                     continue;
                 }
 
+                // the loader touched every row, write them out before fitting sweeps them back in
+                spectra_volume->release_rows(0, spectra_volume->rows());
+
                 analysis_job->init_fit_routines(spectra_volume->samples_size(), true);
-                proc_spectra(spectra_volume, detector, &tp, !loaded_from_analyzed_hdf5, status_callback);
+                proc_spectra(spectra_volume, detector, &tp, !loaded_from_analyzed_hdf5, status_callback, analysis_job->tile_rows, analysis_job->tile_cols, analysis_job->numa_aware, analysis_job->mem_limit);
 				delete spectra_volume;
             }
         }
@@ -483,6 +766,7 @@ void process_dataset_files_quick_and_dirty(std::string dataset_file, data_struct
     //Spectra volume data
     data_struct::Spectra_Volume* spectra_volume = new data_struct::Spectra_Volume();
     data_struct::Spectra_Volume* tmp_spectra_volume = new data_struct::Spectra_Volume();
+    spectra_volume->set_out_of_core(analysis_job->scratch_dir);
 
     io::file::HDF5_IO::inst()->start_save_seq(full_save_path, true); // force to create new file for quick and dirty
 
@@ -544,7 +828,9 @@ void process_dataset_files_quick_and_dirty(std::string dataset_file, data_struct
 
     analysis_job->init_fit_routines(spectra_volume->samples_size(), true);
 	
-    proc_spectra(spectra_volume, detector, &tp, !is_loaded_from_analyzed_h5, status_callback);
+    spectra_volume->release_rows(0, spectra_volume->rows());
+
+    proc_spectra(spectra_volume, detector, &tp, !is_loaded_from_analyzed_h5, status_callback, analysis_job->tile_rows, analysis_job->tile_cols, analysis_job->numa_aware, analysis_job->mem_limit);
     delete spectra_volume;
 }
 
@@ -766,6 +1052,7 @@ void load_and_fit_quatification_datasets(data_struct::Analysis_Job* analysis_job
                     }
                 }
                 fitting::routines::Matrix_Optimized_Fit_Routine* f_routine = (fitting::routines::Matrix_Optimized_Fit_Routine*)fit_routine;
+                f_routine->finalize_integrated_spectra();
                 real_t energy_offset = fit_params.value(STR_ENERGY_OFFSET);
                 real_t energy_slope = fit_params.value(STR_ENERGY_SLOPE);
                 real_t energy_quad = fit_params.value(STR_ENERGY_QUADRATIC);
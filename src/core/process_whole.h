@@ -56,6 +56,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <unordered_map>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
 #include <ctime>
 #include <limits>
 #include <sstream>
@@ -72,6 +74,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "core/defines.h"
+#include "core/cpu_info.h"
 
 #include "workflow/threadpool.h"
 
@@ -94,6 +97,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "fitting/optimizers/mpfit_optimizer.h"
 
 #include "data_struct/fit_element_map.h"
+#include "data_struct/fit_count_volume.h"
 #include "data_struct/params_override.h"
 
 #include "data_struct/quantification_standard.h"
@@ -103,21 +107,124 @@ using namespace std::placeholders; //for _1, _2,
 
 // ----------------------------------------------------------------------------
 
-template<typename T>
-data_struct::Fit_Count_Dict* generate_fit_count_dict(std::unordered_map<std::string, T> *elements_to_fit,
-                                                          size_t height,
-                                                          size_t width,
-                                                          bool alloc_iter_count);
-
-// ----------------------------------------------------------------------------
-
 DLL_EXPORT bool fit_single_spectra(fitting::routines::Base_Fit_Routine * fit_routine,
                         const fitting::models::Base_Model * const model,
                         const data_struct::Spectra * const spectra,
                         const data_struct::Fit_Element_Map_Dict * const elements_to_fit,
-                        data_struct::Fit_Count_Dict * out_fit_counts,
+                        data_struct::Fit_Count_Volume * out_fit_counts,
                         size_t i,
-                        size_t j);
+                        size_t j,
+                        const data_struct::Sparse_Spectra * const sparse_spectra = nullptr);
+
+// ----------------------------------------------------------------------------
+
+///
+/// \brief Completion counter shared by the tiles of one proc_spectra pass
+///
+struct Fit_Tile_Counter
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t tiles_done;
+};
+
+// ----------------------------------------------------------------------------
+
+///
+/// \brief Rows of an out of core volume kept resident while one proc_spectra pass sweeps it
+///
+struct Resident_Row_Window
+{
+    std::mutex mutex;
+    //rows below first_row were fitted and released
+    size_t first_row;
+    //rows below prefetch_row were prefetched
+    size_t prefetch_row;
+    //prefetch at most this many rows past first_row
+    size_t max_rows;
+    //columns fitted so far in each row, tiles can finish out of row order when they are stolen
+    std::vector<size_t> cols_done;
+    size_t cols;
+};
+
+// ----------------------------------------------------------------------------
+
+/// rows of the volume that fit in mem_limit bytes (half the available memory if -1), at least enough for the tiles in flight
+DLL_EXPORT size_t resident_row_limit(const data_struct::Spectra_Volume * spectra_volume, ThreadPool* tp, size_t tile_rows, long long mem_limit);
+
+// ----------------------------------------------------------------------------
+
+/// prefetch the rows of the tile after [row_start, row_end), staying within max_rows of the first unreleased row
+DLL_EXPORT void advance_resident_rows(data_struct::Spectra_Volume * spectra_volume,
+                                      Resident_Row_Window * window,
+                                      size_t row_start,
+                                      size_t row_end);
+
+/// count the tile [row_start, row_end) x num_cols as fitted and release the fully fitted rows at the start of the window
+DLL_EXPORT void release_fitted_rows(data_struct::Spectra_Volume * spectra_volume,
+                                    Resident_Row_Window * window,
+                                    size_t row_start,
+                                    size_t row_end,
+                                    size_t num_cols);
+
+// ----------------------------------------------------------------------------
+
+DLL_EXPORT void fit_spectra_tile(fitting::routines::Base_Fit_Routine * fit_routine,
+                                 const fitting::models::Base_Model * const model,
+                                 data_struct::Spectra_Volume * spectra_volume,
+                                 const data_struct::Fit_Element_Map_Dict * const elements_to_fit,
+                                 data_struct::Fit_Count_Volume * out_fit_counts,
+                                 size_t row_start,
+                                 size_t row_end,
+                                 size_t col_start,
+                                 size_t col_end,
+                                 Fit_Tile_Counter * counter,
+                                 Resident_Row_Window * window = nullptr);
+
+// ----------------------------------------------------------------------------
+
+/// copy a tile into the volume relocate buffer from the calling thread so its pages are first touched on its numa node
+DLL_EXPORT void localize_spectra_tile(data_struct::Spectra_Volume * spectra_volume,
+                                      size_t row_start,
+                                      size_t row_end,
+                                      size_t col_start,
+                                      size_t col_end,
+                                      Fit_Tile_Counter * counter);
+
+// ----------------------------------------------------------------------------
+
+///
+/// \brief Rows handled by one group of workers, workers is empty when any worker can take them
+///
+struct Tile_Row_Range
+{
+    size_t row_start;
+    size_t row_end;
+    std::vector<size_t> workers;
+};
+
+// ----------------------------------------------------------------------------
+
+/// one range per numa node (proportional to its pinned workers) or one range covering all rows
+DLL_EXPORT std::vector<Tile_Row_Range> generate_row_ranges(ThreadPool* tp, size_t rows, bool numa_aware);
+
+// ----------------------------------------------------------------------------
+
+DLL_EXPORT size_t submit_tiles(ThreadPool* tp,
+                               const std::vector<Tile_Row_Range>& row_ranges,
+                               size_t cols,
+                               size_t tile_rows,
+                               size_t tile_cols,
+                               std::function<void(size_t, size_t, size_t, size_t)> tile_func);
+
+// ----------------------------------------------------------------------------
+
+DLL_EXPORT void wait_for_tiles(Fit_Tile_Counter * counter, size_t total_tiles, Callback_Func_Status_Def* status_callback);
+
+// ----------------------------------------------------------------------------
+
+/// pin the pool workers round robin over the numa nodes
+DLL_EXPORT void pin_thread_pool(ThreadPool* tp);
 
 // ----------------------------------------------------------------------------
 
@@ -139,7 +246,11 @@ DLL_EXPORT void proc_spectra(data_struct::Spectra_Volume* spectra_volume,
                              data_struct::Detector* detector_struct,
                              ThreadPool* tp,
                              bool save_spec_vol,
-                             Callback_Func_Status_Def* status_callback = nullptr);
+                             Callback_Func_Status_Def* status_callback = nullptr,
+                             size_t tile_rows = 1,
+                             size_t tile_cols = 1,
+                             bool numa_aware = false,
+                             long long mem_limit = -1);
 
 // ----------------------------------------------------------------------------
 
@@ -60,6 +60,11 @@ Analysis_Job::Analysis_Job()
     _last_init_sample_size = 0;
 	_first_init = true;
     num_threads = std::thread::hardware_concurrency();
+    thread_pool_mode = Thread_Pool_Mode::SHARED_QUEUE;
+    tile_rows = 1;
+    tile_cols = 32;
+    pin_threads = false;
+    numa_aware = false;
     //default mode for which parameters to fit when optimizing fit parameters
     optimize_fit_params_preset = fitting::models::Fit_Params_Preset::BATCH_FIT_NO_TAILS;
     quick_and_dirty = false;
@@ -78,6 +83,11 @@ Analysis_Job::Analysis_Job()
     network_source_port = "43434";
     network_stream_port = "43434";
 	mem_limit = -1;
+    scratch_dir = "";
+    line_window_sigmas = -1.0;
+    telemetry_file = "";
+    telemetry_period = 5.0;
+    telemetry_zmq = false;
 	update_theta_str = "";
 	update_us_amps_str = "";
 	update_ds_amps_str = "";
@@ -167,4 +177,21 @@ void Analysis_Job::set_optimizer(std::string optimizer)
 
 //-----------------------------------------------------------------------------
 
+void Analysis_Job::set_jacobian_mode(std::string mode)
+{
+    fitting::optimizers::Jacobian_Mode jacobian_mode = fitting::optimizers::Jacobian_Mode::NUMERIC;
+    if(mode == "analytic")
+    {
+        jacobian_mode = fitting::optimizers::Jacobian_Mode::ANALYTIC;
+    }
+    else if(mode == "check")
+    {
+        jacobian_mode = fitting::optimizers::Jacobian_Mode::CHECK;
+    }
+    _lmfit_optimizer.set_jacobian_mode(jacobian_mode);
+    _mpfit_optimizer.set_jacobian_mode(jacobian_mode);
+}
+
+//-----------------------------------------------------------------------------
+
 } //namespace data_struct
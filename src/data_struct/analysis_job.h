@@ -61,6 +61,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "data_struct/params_override.h"
 #include "fitting/optimizers/lmfit_optimizer.h"
 #include "fitting/optimizers/mpfit_optimizer.h"
+#include "workflow/threadpool.h"
 #include <iostream>
 
 namespace data_struct
@@ -85,6 +86,9 @@ public:
 
     void set_optimizer(std::string optimizer);
 
+    /// numeric, analytic or check, see fitting::optimizers::Jacobian_Mode. Applies to both optimizers
+    void set_jacobian_mode(std::string mode);
+
     fitting::optimizers::Optimizer *optimizer(){return _optimizer;}
 
     void init_fit_routines(size_t spectra_samples, bool force=false);
@@ -121,6 +125,17 @@ public:
 
     size_t num_threads;
 
+    Thread_Pool_Mode thread_pool_mode;
+
+    //rows x cols of pixels fitted by one job in proc_spectra
+    size_t tile_rows;
+
+    size_t tile_cols;
+
+    bool pin_threads;
+
+    bool numa_aware;
+
     //bool update_scalers;
 
     bool quick_and_dirty;
@@ -141,6 +156,20 @@ public:
 
 	long long mem_limit;
 
+    //directory for the memory mapped scratch files of out of core spectra volumes, empty keeps volumes in memory
+    std::string scratch_dir;
+
+    //evaluate fit lines within +-line_window_sigmas of their energy, 0 for the whole fit range, negative keeps the model default
+    real_t line_window_sigmas;
+
+    //stream pipeline telemetry, written as json lines or csv (.csv) every telemetry_period seconds
+    std::string telemetry_file;
+
+    real_t telemetry_period;
+
+    //also publish telemetry on the XRF-Telemetry topic of the network stream
+    bool telemetry_zmq;
+
 	std::string update_us_amps_str;
 
 	std::string update_ds_amps_str;
@@ -0,0 +1,192 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#include "fit_count_volume.h"
+#include "data_struct/element_info.h"
+#include <algorithm>
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+Fit_Count_Volume::Fit_Count_Volume()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+
+Fit_Count_Volume::~Fit_Count_Volume()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void Fit_Count_Volume::clear()
+{
+    _names.clear();
+    _name_index.clear();
+    _element_channels.clear();
+    _layout = Fit_Count_Layout();
+    _counts.clear();
+    _rows = 0;
+    _cols = 0;
+    _num_iter_channel = -1;
+    _residual_channel = -1;
+    _total_fluorescence_yield_channel = -1;
+    _sum_elastic_inelastic_channel = -1;
+}
+
+//-----------------------------------------------------------------------------
+
+void Fit_Count_Volume::_add_channel(const std::string& name)
+{
+    if (_name_index.count(name) == 0)
+    {
+        _name_index[name] = (int)_names.size();
+        _names.push_back(name);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Fit_Count_Volume::init(const Fit_Element_Map_Dict * const elements_to_fit, size_t rows, size_t cols, bool alloc_iter_count)
+{
+    clear();
+    _rows = rows;
+    _cols = cols;
+
+    //save order by element Z number with K , L, M lines
+    const std::string line_suffix[3] = {"", "_L", "_M"};
+    for (const std::string& suffix : line_suffix)
+    {
+        for (const std::string& el_symb : Element_Symbols)
+        {
+            if (elements_to_fit->count(el_symb + suffix) > 0)
+            {
+                _add_channel(el_symb + suffix);
+            }
+        }
+    }
+    //pileups and scatter amplitudes, sorted so the order does not depend on hashing
+    std::vector<std::string> others;
+    for (const auto& itr : *elements_to_fit)
+    {
+        if (_name_index.count(itr.first) == 0)
+        {
+            others.push_back(itr.first);
+        }
+    }
+    std::sort(others.begin(), others.end());
+    for (const std::string& name : others)
+    {
+        _add_channel(name);
+    }
+    for (size_t i = 0; i < _names.size(); i++)
+    {
+        _element_channels.push_back((int)i);
+    }
+
+    if (alloc_iter_count)
+    {
+        _add_channel(STR_NUM_ITR);
+        _add_channel(STR_RESIDUAL);
+    }
+    _add_channel(STR_TOTAL_FLUORESCENCE_YIELD);
+    _add_channel(STR_SUM_ELASTIC_INELASTIC_AMP);
+
+    _num_iter_channel = channel_index(STR_NUM_ITR);
+    _residual_channel = channel_index(STR_RESIDUAL);
+    _total_fluorescence_yield_channel = channel_index(STR_TOTAL_FLUORESCENCE_YIELD);
+    _sum_elastic_inelastic_channel = channel_index(STR_SUM_ELASTIC_INELASTIC_AMP);
+
+    make_layout(elements_to_fit, _layout);
+
+    _counts.assign(_names.size() * _rows * _cols, (real_t)0.0);
+}
+
+//-----------------------------------------------------------------------------
+
+int Fit_Count_Volume::channel_index(const std::string& name) const
+{
+    auto itr = _name_index.find(name);
+    if (itr != _name_index.end())
+    {
+        return itr->second;
+    }
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+
+void Fit_Count_Volume::make_layout(const Fit_Element_Map_Dict * const elements_to_fit, Fit_Count_Layout& layout) const
+{
+    layout = Fit_Count_Layout();
+    layout.elements = elements_to_fit;
+    int k = 0;
+    for (const auto& itr : *elements_to_fit)
+    {
+        layout.channels.push_back(channel_index(itr.first));
+        if (itr.first == STR_COHERENT_SCT_AMPLITUDE)
+        {
+            layout.coherent_amplitude = k;
+        }
+        else if (itr.first == STR_COMPTON_AMPLITUDE)
+        {
+            layout.compton_amplitude = k;
+        }
+        k++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace data_struct
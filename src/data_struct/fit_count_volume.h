@@ -0,0 +1,178 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#ifndef Fit_Count_Volume_H
+#define Fit_Count_Volume_H
+
+#include "core/defines.h"
+#include "data_struct/fit_parameters.h"
+#include "data_struct/fit_element_map.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief Where the values of a Base_Fit_Routine::fit_spectra_counts() buffer go, resolved once per elements dict
+///
+struct DLL_EXPORT Fit_Count_Layout
+{
+    Fit_Count_Layout() : elements(nullptr), coherent_amplitude(-1), compton_amplitude(-1) {}
+
+    /// dict the layout was resolved for
+    const Fit_Element_Map_Dict* elements;
+
+    /// channel of the k-th element of the dict in iteration order, -1 if the volume has none
+    std::vector<int> channels;
+
+    /// buffer index of the elastic and inelastic amplitudes, -1 if they are not fit
+    int coherent_amplitude;
+
+    int compton_amplitude;
+};
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief The Fit_Count_Volume class : fit counts of all channels in one [channel][row][col] buffer.
+///        Channels are ordered the way they are saved (K, L, M lines by Z, then pileups and the
+///        iteration/residual/yield maps) so the whole cube is written in one call.
+///        Look up a channel index once with channel_index() and fill pixels with plain indexing.
+///
+class DLL_EXPORT Fit_Count_Volume
+{
+
+public:
+
+    Fit_Count_Volume();
+
+    ~Fit_Count_Volume();
+
+    /// allocate a zeroed channel plane for each element to fit, plus num iter, residual, total fluorescence yield and sum elastic inelastic
+    void init(const Fit_Element_Map_Dict * const elements_to_fit, size_t rows, size_t cols, bool alloc_iter_count);
+
+    /// index of the channel or -1 if it does not exist
+    int channel_index(const std::string& name) const;
+
+    /// layout of the elements dict given to init()
+    const Fit_Count_Layout& layout() const { return _layout; }
+
+    /// resolve the layout of another elements dict, its iteration order can differ from the one given to init()
+    void make_layout(const Fit_Element_Map_Dict * const elements_to_fit, Fit_Count_Layout& layout) const;
+
+    inline real_t& operator()(int channel, size_t row, size_t col) { return _counts[((size_t)channel * _rows + row) * _cols + col]; }
+
+    inline const real_t& operator()(int channel, size_t row, size_t col) const { return _counts[((size_t)channel * _rows + row) * _cols + col]; }
+
+    /// rows x cols view of one channel
+    Eigen::Map<ArrayXXr> plane(int channel) { return Eigen::Map<ArrayXXr>(_counts.data() + ((size_t)channel * _rows * _cols), _rows, _cols); }
+
+    Eigen::Map<const ArrayXXr> plane(int channel) const { return Eigen::Map<const ArrayXXr>(_counts.data() + ((size_t)channel * _rows * _cols), _rows, _cols); }
+
+    const std::string& channel_name(int channel) const { return _names[channel]; }
+
+    const std::vector<std::string>& channel_names() const { return _names; }
+
+    /// channels holding fitted element counts, in channel order
+    const std::vector<int>& element_channels() const { return _element_channels; }
+
+    /// fixed channels resolved by init(), -1 if not allocated
+    int num_iter_channel() const { return _num_iter_channel; }
+
+    int residual_channel() const { return _residual_channel; }
+
+    int total_fluorescence_yield_channel() const { return _total_fluorescence_yield_channel; }
+
+    int sum_elastic_inelastic_channel() const { return _sum_elastic_inelastic_channel; }
+
+    const real_t* data() const { return _counts.data(); }
+
+    size_t num_channels() const { return _names.size(); }
+
+    size_t rows() const { return _rows; }
+
+    size_t cols() const { return _cols; }
+
+    void clear();
+
+protected:
+
+    void _add_channel(const std::string& name);
+
+    std::vector<std::string> _names;
+
+    std::unordered_map<std::string, int> _name_index;
+
+    std::vector<int> _element_channels;
+
+    Fit_Count_Layout _layout;
+
+    std::vector<real_t> _counts;
+
+    int _num_iter_channel;
+
+    int _residual_channel;
+
+    int _total_fluorescence_yield_channel;
+
+    int _sum_elastic_inelastic_channel;
+
+    size_t _rows;
+
+    size_t _cols;
+
+};
+
+} //namespace data_struct
+
+#endif // Fit_Count_Volume_H
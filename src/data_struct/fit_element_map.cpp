@@ -48,6 +48,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "fit_element_map.h"
 #include <iostream>
+#include <limits>
 
 namespace data_struct
 {
@@ -65,6 +66,8 @@ Fit_Element_Map::Fit_Element_Map(std::string name, Element_Info* element_info)
 
     _width_multi = 1.0;
 
+    _generation = 0;
+
     size_t num_ratios = 1;
 
     int idx = _full_name.find_last_of("_") + 1;
@@ -117,6 +120,7 @@ void Fit_Element_Map::init_energy_ratio_for_detector_element(const Element_Info
     //real_t weight =  Element_Weight.at(element_info->number);
 
     _energy_ratios.clear();
+    _generation++;
 
     if (_shell_type == "K") // K line
     {
@@ -258,6 +262,7 @@ void Fit_Element_Map::set_custom_multiply_ratio(unsigned int idx, real_t multi)
     if (idx > 0 && idx < _energy_ratio_custom_multipliers.size()) // index 0 has to be 1.0
     {
         _energy_ratio_custom_multipliers[idx] = multi;
+        _generation++;
     }
 }
 
@@ -268,6 +273,7 @@ void Fit_Element_Map::multiply_custom_multiply_ratio(unsigned int idx, real_t mu
     if (idx > 0 && idx < _energy_ratio_custom_multipliers.size()) // index 0 has to be 1.0
     {
         _energy_ratio_custom_multipliers[idx] *= multi;
+        _generation++;
     }
 }
 
@@ -288,6 +294,7 @@ void Fit_Element_Map::set_as_pileup(std::string name, Element_Info* element_info
         }
         _full_name += "_"+name;
         _pileup_element_info = element_info;
+        _generation++;
     }
     else
     {
@@ -299,15 +306,18 @@ void Fit_Element_Map::set_as_pileup(std::string name, Element_Info* element_info
 
 bool Fit_Element_Map::check_binding_energy(real_t incident_energy, int energy_ratio_idx) const
 {
-	real_t binding_e;
+	return binding_energy(energy_ratio_idx) < incident_energy;
+}
+
+//-----------------------------------------------------------------------------
+
+real_t Fit_Element_Map::binding_energy(int energy_ratio_idx) const
+{
 	if (_element_info != nullptr)
 	{
 		if (_shell_type == "K")
 		{
-			if (_element_info->bindingE["K"] < incident_energy)
-			{
-				return true;
-			}
+			return _element_info->bindingE["K"];
 		}
 		else if (_shell_type == "L")
 		{
@@ -318,38 +328,22 @@ bool Fit_Element_Map::check_binding_energy(real_t incident_energy, int energy_ra
 			case 7:
 			case 8:
 			case 9:
-				if (_element_info->bindingE["L1"] < incident_energy)
-				{
-					return true;
-				}
-				break;
+				return _element_info->bindingE["L1"];
             case 2:
             case 6:
             case 11:
-                if (_element_info->bindingE["L2"] < incident_energy)
-                {
-                    return true;
-                }
-                break;
+                return _element_info->bindingE["L2"];
             case 0:
             case 1:
             case 3:
             case 10:
-                if (_element_info->bindingE["L3"] < incident_energy)
-                {
-                    return true;
-                }
-                break;
+                return _element_info->bindingE["L3"];
 			default:
 				break;
 			}
 		}
-		else
-		{
-
-		}
 	}
-	return false;
+	return std::numeric_limits<real_t>::max();
 }
 
 //-----------------------------------------------------------------------------
@@ -380,6 +374,25 @@ data_struct::Fit_Element_Map* gen_element_map(std::string element_symb)
 	return fit_map;
 }
 
+//-----------------------------------------------------------------------------
+
+size_t element_dict_stamp(const Fit_Element_Map_Dict& elements)
+{
+    // summed so the stamp does not depend on the bucket order
+    size_t stamp = elements.size();
+    for (const auto& itr : elements)
+    {
+        size_t entry = std::hash<std::string>()(itr.first);
+        entry = (entry * 1000003) ^ std::hash<const Fit_Element_Map*>()(itr.second);
+        if (itr.second != nullptr)
+        {
+            entry = (entry * 1000003) ^ itr.second->generation();
+        }
+        stamp += (entry ^ (entry >> 16)) * 1000003;
+    }
+    return stamp;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
@@ -169,6 +169,12 @@ public:
 	const string& shell_type_as_string() const { return _shell_type; }
 
 	bool check_binding_energy(real_t incident_energy, int energy_ratio_idx) const;
+
+    /// edge the incident energy has to be above to excite line energy_ratio_idx, max real_t if it is never excited
+    real_t binding_energy(int energy_ratio_idx) const;
+
+    /// bumped by every call that changes the energy ratios, name or multipliers
+    size_t generation() const { return _generation; }
 protected:
 
     void generate_energy_ratio(real_t energy, real_t ratio, Element_Param_Type et, const Element_Info * const detector_element);
@@ -188,6 +194,8 @@ protected:
 
     Element_Info* _pileup_element_info;
     std::string _pileup_shell_type;
+
+    size_t _generation;
 };
 
 //-----------------------------------------------------------------------------
@@ -196,6 +204,9 @@ DLL_EXPORT Fit_Element_Map* gen_element_map(std::string element_symb);
 
 typedef std::unordered_map<std::string, Fit_Element_Map*> Fit_Element_Map_Dict;
 
+/// changes when an entry is added, removed or replaced or an element's generation() changes, independent of iteration order
+DLL_EXPORT size_t element_dict_stamp(const Fit_Element_Map_Dict& elements);
+
 
 } //namespace data_struct
 
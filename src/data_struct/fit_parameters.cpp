@@ -81,36 +81,64 @@ const std::string Fit_Param::bound_type_str() const
     return "N/A";
 }
 
+// order dependent, swapping two names changes the layout
+static size_t combine_layout_hash(size_t seed, const std::string& name)
+{
+    return (seed * 1000003) ^ std::hash<std::string>()(name);
+}
+
 Fit_Parameters::Fit_Parameters(const Fit_Parameters& fit_pars)
 {
-    _params.clear();
-    for(const auto& itr : fit_pars._params)
+    _params = fit_pars._params;
+    _name_index = fit_pars._name_index;
+    _layout_hash = fit_pars._layout_hash;
+}
+
+Fit_Param& Fit_Parameters::operator [](std::string name)
+{
+    auto itr = _name_index.find(name);
+    if (itr != _name_index.end())
     {
-        _params[itr.first] = itr.second;
+        return _params[itr->second].second;
+    }
+    _name_index[name] = (int)_params.size();
+    _layout_hash = combine_layout_hash(_layout_hash, name);
+    _params.emplace_back(name, Fit_Param());
+    return _params.back().second;
+}
+
+void Fit_Parameters::_rebuild_index()
+{
+    _name_index.clear();
+    _layout_hash = 0;
+    for (size_t i = 0; i < _params.size(); i++)
+    {
+        _name_index[_params[i].first] = (int)i;
+        _layout_hash = combine_layout_hash(_layout_hash, _params[i].first);
     }
 }
 
 void Fit_Parameters::add_parameter(Fit_Param param)
 {
-    _params[param.name] = param;
+    (*this)[param.name] = param;
 }
 
 void Fit_Parameters::append_and_update(Fit_Parameters* fit_params)
 {
-	for (auto& itr : *(fit_params->Params()))
+	for (auto& itr : *fit_params)
 	{
-		_params[itr.first] = itr.second;	
+		(*this)[itr.first] = itr.second;
 	}
 }
 
-std::vector<real_t> Fit_Parameters::to_array()
+std::vector<compute_t> Fit_Parameters::to_array()
 {
-    std::vector<real_t> arr;
-    for(const auto& itr : _params)
+    std::vector<compute_t> arr;
+    for(auto& itr : _params)
     {
         if (itr.second.bound_type > E_Bound_Type::FIXED)
         {
-            _params[itr.first].opt_array_index = arr.size();
+            itr.second.opt_array_index = arr.size();
             arr.push_back(itr.second.value);
         }
     }
@@ -120,9 +148,9 @@ std::vector<real_t> Fit_Parameters::to_array()
 std::vector<std::string> Fit_Parameters::names_to_array()
 {
     std::vector<std::string> arr;
-    for(const auto& itr : _params)
+    for(auto& itr : _params)
     {
-        _params[itr.first].opt_array_index = arr.size();
+        itr.second.opt_array_index = arr.size();
         arr.push_back(itr.first);
     }
     return arr;
@@ -130,40 +158,41 @@ std::vector<std::string> Fit_Parameters::names_to_array()
 
 void Fit_Parameters::sum_values(Fit_Parameters fit_params)
 {
-    for(const auto &itr : _params)
+    for(auto &itr : _params)
     {
-        if(fit_params.contains(itr.first) && itr.second.bound_type > E_Bound_Type::FIXED)
+        int idx = fit_params.param_index(itr.first);
+        if(idx > -1 && itr.second.bound_type > E_Bound_Type::FIXED)
         {
-            _params[itr.first].value += fit_params[itr.first].value;
+            itr.second.value += fit_params.value(idx);
         }
     }
 }
 
 void Fit_Parameters::divide_fit_values_by(real_t divisor)
 {
-    for(const auto &itr : _params)
+    for(auto &itr : _params)
     {
         if (itr.second.bound_type > E_Bound_Type::FIXED)
         {
-            _params[itr.first].value /= divisor;
+            itr.second.value /= divisor;
         }
     }
 
 }
 
-void Fit_Parameters::from_array(std::vector<real_t> &arr)
+void Fit_Parameters::from_array(std::vector<compute_t> &arr)
 {
     from_array(&arr[0], arr.size());
 }
 
-void Fit_Parameters::from_array(const real_t* arr, size_t arr_size)
+void Fit_Parameters::from_array(const compute_t* arr, size_t arr_size)
 {
     //logit_s<<"\n";
     for(auto& itr : _params)
     {
         if (itr.second.opt_array_index > -1 && itr.second.opt_array_index < (int)arr_size)
         {
-            itr.second.value = arr[itr.second.opt_array_index];
+            itr.second.value = (real_t)arr[itr.second.opt_array_index];
         }
     }
     //logit_s<<"\n";
@@ -174,7 +203,6 @@ void Fit_Parameters::set_all_value(real_t value, E_Bound_Type btype)
     for(auto& itr : _params)
     {
         if (itr.second.bound_type == btype)
-            //_params[itr.first].value = value;
             itr.second.value = value;
     }
 }
@@ -183,7 +211,6 @@ void Fit_Parameters::set_all(E_Bound_Type btype)
 {
     for(auto& itr : _params)
     {
-        //_params[itr.first].bound_type = btype;
         itr.second.bound_type = btype;
     }
 }
@@ -192,23 +219,25 @@ void Fit_Parameters::update_values(Fit_Parameters *override_fit_params)
 {
     for(auto& itr : _params)
     {
-        if(override_fit_params->contains(itr.first))
+        int idx = override_fit_params->param_index(itr.first);
+        if(idx > -1)
         {
-            if( std::isfinite(override_fit_params->at(itr.first).value) )
+            const Fit_Param& override_param = override_fit_params->at(idx);
+            if( std::isfinite(override_param.value) )
             {
-                itr.second.value = override_fit_params->at(itr.first).value;
+                itr.second.value = override_param.value;
             }
-            if( std::isfinite(override_fit_params->at(itr.first).min_val) )
+            if( std::isfinite(override_param.min_val) )
             {
-                itr.second.min_val = override_fit_params->at(itr.first).min_val;
+                itr.second.min_val = override_param.min_val;
             }
-            if( std::isfinite(override_fit_params->at(itr.first).max_val) )
+            if( std::isfinite(override_param.max_val) )
             {
-                itr.second.max_val = override_fit_params->at(itr.first).max_val;
+                itr.second.max_val = override_param.max_val;
             }
-            if( override_fit_params->at(itr.first).bound_type != E_Bound_Type::NOT_INIT)
+            if( override_param.bound_type != E_Bound_Type::NOT_INIT)
             {
-                itr.second.bound_type = override_fit_params->at(itr.first).bound_type;
+                itr.second.bound_type = override_param.bound_type;
             }
         }
     }
@@ -218,7 +247,7 @@ void Fit_Parameters::update_and_add_values(Fit_Parameters *override_fit_params)
 {
     for(auto& itr : *override_fit_params)
     {
-        _params[itr.first] = itr.second;
+        (*this)[itr.first] = itr.second;
     }
 }
 
@@ -228,7 +257,7 @@ void Fit_Parameters::update_and_add_values_gt_zero(Fit_Parameters *override_fit_
     {
         if(itr.second.value > 0.0)
         {
-            _params[itr.first] = itr.second;
+            (*this)[itr.first] = itr.second;
         }
     }
 }
@@ -258,20 +287,21 @@ void Fit_Parameters::print_non_fixed()
 
 void Fit_Parameters::remove(Fit_Parameters* override_fit_params)
 {
-    for (auto& itr : *override_fit_params)
+    auto new_end = std::remove_if(_params.begin(), _params.end(), [override_fit_params](const std::pair<std::string, Fit_Param>& p) { return override_fit_params->contains(p.first); });
+    if (new_end != _params.end())
     {
-        if (_params.count(itr.first) > 0)
-        {
-            _params.erase(itr.first);
-        }
+        _params.erase(new_end, _params.end());
+        _rebuild_index();
     }
 }
 
 void Fit_Parameters::remove(std::string key)
 {
-    if (_params.count(key) > 0)
+    int idx = param_index(key);
+    if (idx > -1)
     {
-        _params.erase(key);
+        _params.erase(_params.begin() + idx);
+        _rebuild_index();
     }
 
 }
@@ -75,8 +75,6 @@ enum class E_Bound_Type {NOT_INIT=0, FIXED=1, LIMITED_LO_HI=2, LIMITED_LO=3, LIM
 
 typedef Eigen::Array<real_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> ArrayXXr;
 
-typedef std::unordered_map<std::string, ArrayXXr > Fit_Count_Dict;
-
 /**
 * @brief The Range struct to determine size of spectra we want to fit or model
 */
@@ -178,21 +176,38 @@ struct DLL_EXPORT Fit_Param
 //-----------------------------------------------------------------------------
 /**
  * @brief The Fit_Parameters class: Dictionary of fit parameters. Many fit routines use arrays so there are convert to and from array functions.
+ *  Parameters are stored in a flat array in insertion order, names are only hashed to find their index.
+ *  Hot code should resolve an index once with param_index() and use the index accessors. An index stays valid
+ *  for copies and as long as no parameter is removed.
  */
 class DLL_EXPORT Fit_Parameters
 {
 public:
 
-    Fit_Parameters(){}
+    Fit_Parameters() : _layout_hash(0) {}
 
     Fit_Parameters(const Fit_Parameters& fit_pars);
 
     ~Fit_Parameters(){_params.clear();}
 
-    Fit_Param& operator [](std::string name) { return _params[name]; }
+    /// adds the parameter if it does not exist. Adding can reallocate the parameter array, so a Fit_Param&
+    /// from an earlier operator[] or at() is invalidated by the next insert, hold on to the index instead
+    Fit_Param& operator [](std::string name);
 
     //const Fit_Param& operator [](std::string name) const { return _params[name]; }
 
+    /// index of the parameter or -1 if it does not exist
+    int param_index(const std::string& name) const { auto itr = _name_index.find(name); return (itr != _name_index.end()) ? itr->second : -1; }
+
+    inline Fit_Param& at(int idx) { return _params[idx].second; }
+
+    inline const Fit_Param& at(int idx) const { return _params[idx].second; }
+
+    inline const real_t& value(int idx) const { return _params[idx].second.value; }
+
+    /// name the parameter at idx was added under, lets cached indices be checked without hashing
+    inline const std::string& name_at(int idx) const { return _params[idx].first; }
+
     void add_parameter(Fit_Param param);
 
 	void append_and_update(Fit_Parameters* fit_params);
@@ -201,19 +216,24 @@ public:
 
     inline auto end() { return _params.end(); }
 
+    inline auto begin() const { return _params.begin(); }
+
+    inline auto end() const { return _params.end(); }
+
     void sum_values(Fit_Parameters fit_params);
 
     void divide_fit_values_by(real_t divisor);
 
-    bool contains(std::string name) const { return ( _params.find(name) != _params.end()); }
+    bool contains(std::string name) const { return ( _name_index.find(name) != _name_index.end()); }
 
-    std::vector<real_t> to_array();
+    /// values of the fitted parameters for an optimizer, optimizers work in compute_t
+    std::vector<compute_t> to_array();
 
     std::vector<std::string> names_to_array();
 
-    void from_array(std::vector<real_t> &arr);
+    void from_array(std::vector<compute_t> &arr);
 
-    void from_array(const real_t* arr, size_t arr_size);
+    void from_array(const compute_t* arr, size_t arr_size);
 
     void set_all_value(real_t value, E_Bound_Type btype);
 
@@ -229,21 +249,28 @@ public:
 
     void remove(std::string key);
 
-    inline const real_t& value(std::string key) const { return _params.at(key).value; }
+    inline const real_t& value(std::string key) const { return at(key).value; }
 
     void print();
 
     void print_non_fixed();
 
-    const Fit_Param& at(std::string name) const {return _params.at(name); }
+    const Fit_Param& at(std::string name) const {return _params[_name_index.at(name)].second; }
 
     size_t size() const { return _params.size(); }
-	
-	std::unordered_map<std::string, Fit_Param>* Params() { return &_params; }
+
+    /// hash of the parameter names in index order, parameters with the same layout_hash() and size() have the same indices
+    size_t layout_hash() const { return _layout_hash; }
 
 private:
 
-    std::unordered_map<std::string, Fit_Param> _params;
+    void _rebuild_index();
+
+    std::vector<std::pair<std::string, Fit_Param> > _params;
+
+    std::unordered_map<std::string, int> _name_index;
+
+    size_t _layout_hash;
 
 };
 
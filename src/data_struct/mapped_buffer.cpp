@@ -0,0 +1,235 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#include "data_struct/mapped_buffer.h"
+#include "core/defines.h"
+
+#if defined _WIN32 || defined __CYGWIN__
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#endif
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+Mapped_Buffer::Mapped_Buffer()
+{
+    _data = nullptr;
+    _size = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+Mapped_Buffer::Mapped_Buffer(Mapped_Buffer&& buf)
+{
+    _data = buf._data;
+    _size = buf._size;
+    buf._data = nullptr;
+    buf._size = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+Mapped_Buffer::~Mapped_Buffer()
+{
+    unmap();
+}
+
+//-----------------------------------------------------------------------------
+
+Mapped_Buffer& Mapped_Buffer::operator=(Mapped_Buffer&& buf)
+{
+    if (this != &buf)
+    {
+        unmap();
+        _data = buf._data;
+        _size = buf._size;
+        buf._data = nullptr;
+        buf._size = 0;
+    }
+    return *this;
+}
+
+//-----------------------------------------------------------------------------
+
+bool Mapped_Buffer::map(const std::string& directory, size_t count)
+{
+    unmap();
+    if (count == 0)
+    {
+        return false;
+    }
+#if defined _WIN32 || defined __CYGWIN__
+    logW << "Memory mapped scratch files are not supported on this platform, keeping the buffer in memory\n";
+    return false;
+#else
+    std::string path = directory;
+    if (path.length() > 0 && path.back() != DIR_END_CHAR)
+    {
+        path += DIR_END_CHAR;
+    }
+    path += "xrf_maps_scratch_XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+
+    int fd = mkstemp(name.data());
+    if (fd < 0)
+    {
+        logE << "Could not create scratch file " << path << " : " << strerror(errno) << "\n";
+        return false;
+    }
+    // the mapping keeps the file alive, nothing is left behind if we crash
+    unlink(name.data());
+
+    size_t bytes = count * sizeof(real_t);
+    // a sparse file reads back as zeros
+    if (ftruncate(fd, (off_t)bytes) != 0)
+    {
+        logE << "Could not size scratch file " << name.data() << " to " << bytes << " bytes : " << strerror(errno) << "\n";
+        close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        logE << "Could not map scratch file " << name.data() << " : " << strerror(errno) << "\n";
+        return false;
+    }
+    _data = (real_t*)addr;
+    _size = count;
+    logI << "Mapped " << bytes << " bytes to scratch file in " << directory << "\n";
+    return true;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+void Mapped_Buffer::unmap()
+{
+#if defined _WIN32 || defined __CYGWIN__
+#else
+    if (_data != nullptr)
+    {
+        munmap(_data, _size * sizeof(real_t));
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+bool Mapped_Buffer::_page_range(size_t offset, size_t count, char** start, size_t* length) const
+{
+#if defined _WIN32 || defined __CYGWIN__
+    return false;
+#else
+    if (_data == nullptr || offset >= _size)
+    {
+        return false;
+    }
+    if (offset + count > _size)
+    {
+        count = _size - offset;
+    }
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t first = offset * sizeof(real_t);
+    size_t last = (offset + count) * sizeof(real_t);
+    first -= first % page_size;
+    *start = (char*)_data + first;
+    *length = last - first;
+    return *length > 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+void Mapped_Buffer::will_need(size_t offset, size_t count)
+{
+#if defined _WIN32 || defined __CYGWIN__
+#else
+    char* start;
+    size_t length;
+    if (_page_range(offset, count, &start, &length))
+    {
+        madvise(start, length, MADV_WILLNEED);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+void Mapped_Buffer::dont_need(size_t offset, size_t count)
+{
+#if defined _WIN32 || defined __CYGWIN__
+#else
+    char* start;
+    size_t length;
+    if (_page_range(offset, count, &start, &length))
+    {
+        // start writing dirty pages back without waiting, the page cache keeps them until they are written
+        msync(start, length, MS_ASYNC);
+        // shared file pages are only unmapped, touching them again reads them back from the page cache or the file
+        madvise(start, length, MADV_DONTNEED);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace data_struct
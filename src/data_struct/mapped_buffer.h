@@ -0,0 +1,114 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#ifndef Mapped_Buffer_H
+#define Mapped_Buffer_H
+
+#include "core/defines.h"
+#include <string>
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief The Mapped_Buffer class : a zeroed real_t buffer backed by a memory mapped scratch file.
+///        The file is unlinked as soon as it is created so it goes away with the mapping, the OS pages
+///        the buffer in and out of the file instead of holding it all in memory.
+///        Not supported on Windows, map() returns false and the caller keeps the buffer in memory.
+///
+class DLL_EXPORT Mapped_Buffer
+{
+
+public:
+
+    Mapped_Buffer();
+
+    Mapped_Buffer(const Mapped_Buffer&) = delete;
+
+    Mapped_Buffer(Mapped_Buffer&& buf);
+
+    ~Mapped_Buffer();
+
+    Mapped_Buffer& operator=(const Mapped_Buffer&) = delete;
+
+    Mapped_Buffer& operator=(Mapped_Buffer&& buf);
+
+    /// map count zeroed samples in a new scratch file under directory
+    bool map(const std::string& directory, size_t count);
+
+    void unmap();
+
+    /// ask the OS to start reading samples [offset, offset + count) in
+    void will_need(size_t offset, size_t count);
+
+    /// drop samples [offset, offset + count) from resident memory, they are read back from the file when touched again
+    void dont_need(size_t offset, size_t count);
+
+    real_t* data() { return _data; }
+
+    const real_t* data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+private:
+
+    /// page aligned byte range covering samples [offset, offset + count), false if it is empty
+    bool _page_range(size_t offset, size_t count, char** start, size_t* length) const;
+
+    real_t* _data;
+
+    size_t _size;
+
+};
+
+} //namespace data_struct
+
+#endif // Mapped_Buffer_H
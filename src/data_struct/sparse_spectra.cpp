@@ -0,0 +1,129 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#include "sparse_spectra.h"
+#include <algorithm>
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+Sparse_Spectra::Sparse_Spectra()
+{
+    _size = 0;
+    _valid = false;
+}
+
+//-----------------------------------------------------------------------------
+
+Sparse_Spectra::~Sparse_Spectra()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void Sparse_Spectra::clear()
+{
+    _channels.clear();
+    _values.clear();
+    _size = 0;
+    _valid = false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool Sparse_Spectra::from_dense(const Spectra& spectra, real_t max_density)
+{
+    clear();
+    size_t max_nnz = (size_t)(max_density * (real_t)spectra.size());
+    size_t nnz = (size_t)(spectra != (real_t)0.0).count();
+    if (spectra.size() == 0 || nnz > max_nnz)
+    {
+        return false;
+    }
+
+    _channels.reserve(nnz);
+    _values.reserve(nnz);
+    for (Eigen::Index i = 0; i < spectra.size(); i++)
+    {
+        if (spectra[i] != (real_t)0.0)
+        {
+            _channels.push_back((unsigned int)i);
+            _values.push_back(spectra[i]);
+        }
+    }
+    _size = spectra.size();
+    _valid = true;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t Sparse_Spectra::lower_index(size_t channel) const
+{
+    return std::lower_bound(_channels.begin(), _channels.end(), (unsigned int)channel) - _channels.begin();
+}
+
+//-----------------------------------------------------------------------------
+
+real_t Sparse_Spectra::sum(size_t first, size_t last) const
+{
+    real_t val = 0.0;
+    for (size_t idx = lower_index(first); idx < _channels.size() && _channels[idx] <= last; idx++)
+    {
+        val += _values[idx];
+    }
+    return val;
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace data_struct
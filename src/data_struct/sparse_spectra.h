@@ -0,0 +1,115 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#ifndef Sparse_Spectra_H
+#define Sparse_Spectra_H
+
+#include "core/defines.h"
+#include "data_struct/spectra.h"
+#include <vector>
+
+namespace data_struct
+{
+
+/// pixels with at most this fraction of nonzero channels are fitted from their sparse form
+const real_t SPARSE_SPECTRA_MAX_DENSITY = (real_t)0.125;
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief The Sparse_Spectra class : channel index / value pairs of the nonzero channels of a spectra,
+///        ordered by channel. Low count pixels of fly scans are mostly zeros, fit routines that support
+///        it (see Base_Fit_Routine::supports_sparse) then only touch the nonzero channels.
+///
+class DLL_EXPORT Sparse_Spectra
+{
+
+public:
+
+    Sparse_Spectra();
+
+    ~Sparse_Spectra();
+
+    /// keep the nonzero channels of spectra if at most max_density of them are nonzero, otherwise clear and return false
+    bool from_dense(const Spectra& spectra, real_t max_density = SPARSE_SPECTRA_MAX_DENSITY);
+
+    /// sum of the values of channels [first, last]
+    real_t sum(size_t first, size_t last) const;
+
+    /// index of the first stored channel >= channel
+    size_t lower_index(size_t channel) const;
+
+    bool is_valid() const { return _valid; }
+
+    size_t nnz() const { return _channels.size(); }
+
+    /// number of channels of the dense spectra
+    size_t size() const { return _size; }
+
+    unsigned int channel(size_t idx) const { return _channels[idx]; }
+
+    real_t value(size_t idx) const { return _values[idx]; }
+
+    void clear();
+
+private:
+
+    std::vector<unsigned int> _channels;
+
+    std::vector<real_t> _values;
+
+    size_t _size;
+
+    bool _valid;
+
+};
+
+} //namespace data_struct
+
+#endif // Sparse_Spectra_H
@@ -61,87 +61,138 @@ using namespace std;
 
 typedef Eigen::Array<real_t, Eigen::Dynamic, Eigen::RowMajor> ArrayXr;
 
+/// sums of real_t samples
+typedef Eigen::Array<compute_t, Eigen::Dynamic, Eigen::RowMajor> ArrayXc;
+
+/**
+ * @brief Spectra_T : A single spectra with its acquisition meta data.
+ *  The samples either live in storage owned by the spectra or are a view into a larger buffer
+ *  (see Spectra_Volume) so a whole volume can live in one contiguous allocation.
+ */
 template<typename _T>
-class Spectra_T : public Eigen::Array<_T, Eigen::Dynamic, Eigen::RowMajor>
+class Spectra_T : public Eigen::Map<Eigen::Array<_T, Eigen::Dynamic, Eigen::RowMajor> >
 {
 public:
 	typedef Eigen::Array<_T, Eigen::Dynamic, Eigen::RowMajor> TArrayXr;
+	typedef Eigen::Map<TArrayXr> TMapXr;
+	typedef Eigen::Map<const TArrayXr> TConstMapXr;
 
     /**
      * @brief Spectra : Constructor
      */
-    Spectra_T() : TArrayXr()
+    Spectra_T() : TMapXr(nullptr, 0)
 	{
-        _elapsed_livetime = 1.0;
-		_elapsed_realtime = 1.0;
-		_input_counts = 1.0;
-		_output_counts = 1.0;
+        *_elapsed_livetime = 1.0;
+		*_elapsed_realtime = 1.0;
+		*_input_counts = 1.0;
+		*_output_counts = 1.0;
 	}
 
-    Spectra_T(const Spectra_T &spectra) : TArrayXr(spectra)
+    Spectra_T(const Spectra_T &spectra) : TMapXr(nullptr, 0), _owned(spectra)
 	{
-        _elapsed_livetime = spectra._elapsed_livetime;
-		_elapsed_realtime = spectra._elapsed_realtime;
-		_input_counts = spectra._input_counts;
-		_output_counts = spectra._output_counts;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = *spectra._elapsed_livetime;
+		*_elapsed_realtime = *spectra._elapsed_realtime;
+		*_input_counts = *spectra._input_counts;
+		*_output_counts = *spectra._output_counts;
 	}
 
-    Spectra_T(size_t sample_size) : TArrayXr(sample_size)
+    /// a view keeps pointing at the same samples and meta data, owned storage is stolen
+    Spectra_T(Spectra_T &&spectra) noexcept : TMapXr(nullptr, 0)
+    {
+        if (spectra.is_view())
+        {
+            _remap(spectra.data(), spectra.size());
+        }
+        else
+        {
+            _owned.swap(spectra._owned);
+            _remap(_owned.data(), _owned.size());
+            spectra._remap(spectra._owned.data(), spectra._owned.size());
+        }
+        if (false == spectra._has_local_meta())
+        {
+            map_meta_to(spectra._elapsed_livetime, spectra._elapsed_realtime, spectra._input_counts, spectra._output_counts);
+        }
+        *_elapsed_livetime = *spectra._elapsed_livetime;
+        *_elapsed_realtime = *spectra._elapsed_realtime;
+        *_input_counts = *spectra._input_counts;
+        *_output_counts = *spectra._output_counts;
+    }
+
+    /// view of sample_size samples starting at data, the caller keeps ownership of data
+    Spectra_T(_T* data, size_t sample_size) : TMapXr(data, sample_size)
+    {
+        *_elapsed_livetime = 1.0;
+        *_elapsed_realtime = 1.0;
+        *_input_counts = 1.0;
+        *_output_counts = 1.0;
+    }
+
+    Spectra_T(size_t sample_size) : TMapXr(nullptr, 0), _owned(sample_size)
 	{
+        _remap(_owned.data(), _owned.size());
 		this->setZero();
-        _elapsed_livetime = 1.0;
-		_elapsed_realtime = 1.0;
-		_input_counts = 1.0;
-		_output_counts = 1.0;
+        *_elapsed_livetime = 1.0;
+		*_elapsed_realtime = 1.0;
+		*_input_counts = 1.0;
+		*_output_counts = 1.0;
 	}
 
-    Spectra_T(size_t sample_size, _T elt, _T ert, _T incnt, _T outcnt) : TArrayXr(sample_size)
+    Spectra_T(size_t sample_size, _T elt, _T ert, _T incnt, _T outcnt) : TMapXr(nullptr, 0), _owned(sample_size)
     {
+        _remap(_owned.data(), _owned.size());
         this->setZero();
-        _elapsed_livetime = elt;
-        _elapsed_realtime = ert;
-        _input_counts = incnt;
-        _output_counts = outcnt;
+        *_elapsed_livetime = elt;
+        *_elapsed_realtime = ert;
+        *_input_counts = incnt;
+        *_output_counts = outcnt;
     }
 
-    Spectra_T(const TArrayXr& arr) : TArrayXr(arr)
+    Spectra_T(const TArrayXr& arr) : TMapXr(nullptr, 0), _owned(arr)
     {
-        _elapsed_livetime = 1.0;
-        _elapsed_realtime = 1.0;
-        _input_counts = 1.0;
-        _output_counts = 1.0;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = 1.0;
+        *_elapsed_realtime = 1.0;
+        *_input_counts = 1.0;
+        *_output_counts = 1.0;
     }
 
-    Spectra_T(const TArrayXr& arr, _T livetime, _T realtime, _T incnt, _T outnt) : TArrayXr(arr)
+    Spectra_T(const TArrayXr& arr, _T livetime, _T realtime, _T incnt, _T outnt) : TMapXr(nullptr, 0), _owned(arr)
     {
-        _elapsed_livetime = livetime;
-        _elapsed_realtime = realtime;
-        _input_counts = incnt;
-        _output_counts = outnt;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = livetime;
+        *_elapsed_realtime = realtime;
+        *_input_counts = incnt;
+        *_output_counts = outnt;
     }
 
-    Spectra_T(const TArrayXr&& arr) : TArrayXr(arr)
+    /// takes over the storage of arr
+    Spectra_T(TArrayXr&& arr) : TMapXr(nullptr, 0), _owned(std::move(arr))
     {
-        _elapsed_livetime = 1.0;
-        _elapsed_realtime = 1.0;
-        _input_counts = 1.0;
-        _output_counts = 1.0;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = 1.0;
+        *_elapsed_realtime = 1.0;
+        *_input_counts = 1.0;
+        *_output_counts = 1.0;
     }
 
-    Spectra_T(const TArrayXr&& arr, _T livetime, _T realtime, _T incnt, _T outnt) : TArrayXr(arr)
+    Spectra_T(TArrayXr&& arr, _T livetime, _T realtime, _T incnt, _T outnt) : TMapXr(nullptr, 0), _owned(std::move(arr))
     {
-        _elapsed_livetime = livetime;
-        _elapsed_realtime = realtime;
-        _input_counts = incnt;
-        _output_counts = outnt;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = livetime;
+        *_elapsed_realtime = realtime;
+        *_input_counts = incnt;
+        *_output_counts = outnt;
     }
 
-    Spectra_T(Eigen::Index& rows, Eigen::Index& cols) : TArrayXr(rows, cols)
+    Spectra_T(Eigen::Index& rows, Eigen::Index& cols) : TMapXr(nullptr, 0), _owned(rows, cols)
 	{
-        _elapsed_livetime = 1.0;
-        _elapsed_realtime = 1.0;
-        _input_counts = 1.0;
-        _output_counts = 1.0;
+        _remap(_owned.data(), _owned.size());
+        *_elapsed_livetime = 1.0;
+        *_elapsed_realtime = 1.0;
+        *_input_counts = 1.0;
+        *_output_counts = 1.0;
 	}
 
     virtual ~Spectra_T()
@@ -149,70 +200,199 @@ public:
 
     }
 
+    /// copies samples and meta data, a view of a different size is resized first (see resize)
+    Spectra_T& operator=(const Spectra_T& spectra)
+    {
+        if (this != &spectra)
+        {
+            if (this->size() != spectra.size())
+            {
+                resize(spectra.size());
+            }
+            TMapXr::operator=(spectra);
+            _copy_meta(spectra);
+        }
+        return *this;
+    }
+
+    /// steals the storage when both sides own it, otherwise copies the samples so views stay in their buffer
+    Spectra_T& operator=(Spectra_T&& spectra)
+    {
+        if (this != &spectra)
+        {
+            if (false == is_view() && false == spectra.is_view())
+            {
+                _owned.swap(spectra._owned);
+                _remap(_owned.data(), _owned.size());
+                spectra._remap(spectra._owned.data(), spectra._owned.size());
+                _copy_meta(spectra);
+            }
+            else
+            {
+                *this = static_cast<const Spectra_T&>(spectra);
+            }
+        }
+        return *this;
+    }
+
+    Spectra_T& operator=(const _T& val)
+    {
+        TMapXr::operator=(val);
+        return *this;
+    }
+
+    /// true when the samples live in a buffer owned by someone else (Spectra_Volume)
+    bool is_view() const { return this->data() != _owned.data(); }
+
+    /// point this spectra at an external buffer, releasing any storage it owned
+    void map_to(_T* data, size_t sample_size)
+    {
+        _owned.resize(0);
+        _remap(data, sample_size);
+    }
+
+    /// read and write the meta data through external storage, Spectra_Volume points these at its planes
+    void map_meta_to(_T* livetime, _T* realtime, _T* incnt, _T* outcnt)
+    {
+        _elapsed_livetime = livetime;
+        _elapsed_realtime = realtime;
+        _input_counts = incnt;
+        _output_counts = outcnt;
+    }
+
+    /**
+     * @brief resize : Owned storage is reallocated (values are not kept).
+     *  A view shrinks in place, growing a view detaches it into owned storage.
+     */
+    void resize(Eigen::Index sample_size)
+    {
+        if (is_view())
+        {
+            if (sample_size <= this->size())
+            {
+                _remap(this->data(), sample_size);
+                return;
+            }
+        }
+        _owned.resize(sample_size);
+        _remap(_owned.data(), _owned.size());
+    }
+
+    using TMapXr::setZero;
+
+    void setZero(Eigen::Index sample_size)
+    {
+        resize(sample_size);
+        this->setZero();
+    }
+
+    /// swaps the storage when both sides own it, otherwise swaps the samples
+    void swap(Spectra_T& spectra)
+    {
+        if (false == is_view() && false == spectra.is_view())
+        {
+            _owned.swap(spectra._owned);
+            _remap(_owned.data(), _owned.size());
+            spectra._remap(spectra._owned.data(), spectra._owned.size());
+        }
+        else
+        {
+            TMapXr::swap(spectra);
+        }
+    }
+
     void recalc_elapsed_livetime()
     {
-        if(_input_counts == 0 || _output_counts == 0)
+        if((*_input_counts) == 0 || (*_output_counts) == 0)
         {
-            _elapsed_livetime = _elapsed_realtime;
+            *_elapsed_livetime = *_elapsed_realtime;
         }
         else
         {
-            _elapsed_livetime = _elapsed_realtime * _output_counts / _input_counts;
+            *_elapsed_livetime = (*_elapsed_realtime) * (*_output_counts) / (*_input_counts);
         }
     }
 
     void add(const Spectra_T& spectra)
     {
-        *this += (TArrayXr)spectra;
+        *this += spectra;
         real_t val = spectra.elapsed_livetime();
         if(std::isfinite(val))
         {
-            _elapsed_livetime += val;
+            *_elapsed_livetime += val;
         }
         val = spectra.elapsed_realtime();
         if(std::isfinite(val))
         {
-            _elapsed_realtime += val;
+            *_elapsed_realtime += val;
         }
         val = spectra.input_counts();
         if(std::isfinite(val))
         {
-            _input_counts += val;
+            *_input_counts += val;
         }
         val = spectra.output_counts();
         if(std::isfinite(val))
         {
-            _output_counts += val;
+            *_output_counts += val;
         }
     }
 
-    void elapsed_livetime(_T val) { _elapsed_livetime = val; }
+    void elapsed_livetime(_T val) { *_elapsed_livetime = val; }
 
-    const _T elapsed_livetime() const { return _elapsed_livetime; }
+    const _T elapsed_livetime() const { return *_elapsed_livetime; }
 
-    void elapsed_realtime(_T val) { _elapsed_realtime = val; }
+    void elapsed_realtime(_T val) { *_elapsed_realtime = val; }
 
-    const _T elapsed_realtime() const { return _elapsed_realtime; }
+    const _T elapsed_realtime() const { return *_elapsed_realtime; }
 
-    void input_counts(_T val) { _input_counts = val; }
+    void input_counts(_T val) { *_input_counts = val; }
 
-    const _T input_counts() const { return _input_counts; }
+    const _T input_counts() const { return *_input_counts; }
 
-    void output_counts(_T val) { _output_counts = val; }
+    void output_counts(_T val) { *_output_counts = val; }
 
-    const _T output_counts() const { return _output_counts; }
+    const _T output_counts() const { return *_output_counts; }
 
+    /// copy of count samples starting at start with the same meta data
     Spectra_T sub_spectra(size_t start, size_t count) const
 	{
-        return Spectra_T(this->segment(start, count), _elapsed_livetime, _elapsed_realtime, _input_counts, _output_counts);
+        return Spectra_T(TArrayXr(this->segment(start, count)), *_elapsed_livetime, *_elapsed_realtime, *_input_counts, *_output_counts);
 	}
 
+    /// read only view of count samples starting at start, valid as long as the samples of this spectra are
+    TConstMapXr sub_view(size_t start, size_t count) const
+    {
+        return TConstMapXr(this->data() + start, count);
+    }
+
 private:
 
-    _T _elapsed_livetime;
-    _T _elapsed_realtime;
-    _T _input_counts;
-    _T _output_counts;
+    void _remap(_T* data, Eigen::Index sample_size)
+    {
+        // Map has no rebind, placement new is the documented way to change the buffer it points to
+        new (static_cast<TMapXr*>(this)) TMapXr(data, sample_size);
+    }
+
+    bool _has_local_meta() const { return _elapsed_livetime == &_meta[0]; }
+
+    void _copy_meta(const Spectra_T& spectra)
+    {
+        *_elapsed_livetime = *spectra._elapsed_livetime;
+        *_elapsed_realtime = *spectra._elapsed_realtime;
+        *_input_counts = *spectra._input_counts;
+        *_output_counts = *spectra._output_counts;
+    }
+
+    // meta data lives in _meta unless the spectra belongs to a Spectra_Volume, then it points into the volume planes
+    _T _meta[4];
+
+    _T* _elapsed_livetime = &_meta[0];
+    _T* _elapsed_realtime = &_meta[1];
+    _T* _input_counts = &_meta[2];
+    _T* _output_counts = &_meta[3];
+
+    TArrayXr _owned;
 
 };
 
@@ -223,6 +403,94 @@ private:
 #endif
 typedef Spectra_T<float> Spectra;
 
+/**
+ * @brief Spectra_Accumulator_T : running sum of many spectra stored as _T, the samples and meta data are summed as _C
+ *  so integrating millions of float pixels does not lose the small ones.
+ */
+template<typename _T, typename _C>
+class Spectra_Accumulator_T
+{
+public:
+    typedef Eigen::Array<_C, Eigen::Dynamic, Eigen::RowMajor> CArrayXr;
+    typedef Eigen::Array<_T, Eigen::Dynamic, Eigen::RowMajor> TArrayXr;
+
+    Spectra_Accumulator_T()
+    {
+        setZero(0);
+    }
+
+    Spectra_Accumulator_T(size_t sample_size)
+    {
+        setZero(sample_size);
+    }
+
+    void setZero(size_t sample_size)
+    {
+        _sums.setZero(sample_size);
+        _elapsed_livetime = 0.0;
+        _elapsed_realtime = 0.0;
+        _input_counts = 0.0;
+        _output_counts = 0.0;
+    }
+
+    size_t size() const { return _sums.size(); }
+
+    /// add samples without meta data, samples may be shorter than the accumulator
+    template<typename Derived>
+    void add_samples(const Eigen::ArrayBase<Derived>& samples)
+    {
+        _sums.head(samples.size()) += samples.template cast<_C>();
+    }
+
+    /// same as Spectra_T::add, non finite meta data is skipped
+    void add(const Spectra_T<_T>& spectra)
+    {
+        add_samples(spectra);
+        add_meta(spectra.elapsed_livetime(), spectra.elapsed_realtime(), spectra.input_counts(), spectra.output_counts());
+    }
+
+    void add_meta(_C livetime, _C realtime, _C incnt, _C outcnt)
+    {
+        if (std::isfinite(livetime))
+        {
+            _elapsed_livetime += livetime;
+        }
+        if (std::isfinite(realtime))
+        {
+            _elapsed_realtime += realtime;
+        }
+        if (std::isfinite(incnt))
+        {
+            _input_counts += incnt;
+        }
+        if (std::isfinite(outcnt))
+        {
+            _output_counts += outcnt;
+        }
+    }
+
+    CArrayXr& sums() { return _sums; }
+
+    const CArrayXr& sums() const { return _sums; }
+
+    /// the sum rounded back to _T
+    Spectra_T<_T> to_spectra() const
+    {
+        return Spectra_T<_T>(TArrayXr(_sums.template cast<_T>()), (_T)_elapsed_livetime, (_T)_elapsed_realtime, (_T)_input_counts, (_T)_output_counts);
+    }
+
+private:
+
+    CArrayXr _sums;
+
+    _C _elapsed_livetime;
+    _C _elapsed_realtime;
+    _C _input_counts;
+    _C _output_counts;
+};
+
+typedef Spectra_Accumulator_T<float, compute_t> Spectra_Accumulator;
+
 DLL_EXPORT ArrayXr convolve1d(const ArrayXr& arr, size_t boxcar_size);
 DLL_EXPORT ArrayXr convolve1d(const ArrayXr& arr, const ArrayXr& boxcar);
 DLL_EXPORT ArrayXr snip_background(const Spectra * const spectra, real_t energy_offset, real_t energy_linear, real_t energy_quadratic, real_t spectral_binning, real_t width, real_t xmin, real_t xmax);
@@ -232,6 +500,9 @@ DLL_EXPORT void gen_energy_vector(real_t number_channels, real_t energy_offset,
 
 typedef std::function<void(size_t, size_t, size_t, size_t, size_t, data_struct::Spectra*, void*)> IO_Callback_Func_Def;
 
+/// optional allocator for spectra handed to an IO_Callback_Func_Def, must return a zeroed spectra of the given size
+typedef std::function<data_struct::Spectra*(size_t)> IO_Spectra_Alloc_Func_Def;
+
 
 } //namespace data_struct
 
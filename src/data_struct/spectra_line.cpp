@@ -85,6 +85,16 @@ void Spectra_Line::alloc_row_size(size_t n)
     _data_line.resize(n);
 }
 
+void Spectra_Line::map_to_buffer(real_t* data, size_t cols, size_t samples, size_t stride)
+{
+    _data_line.clear();
+    _data_line.reserve(cols);
+    for(size_t i=0; i<cols; i++)
+    {
+        _data_line.emplace_back(data + (i * stride), samples);
+    }
+}
+
 void Spectra_Line::_alloc_spectra_size(size_t n)
 {
     for(size_t i=0; i<_data_line.size(); i++)
@@ -74,6 +74,9 @@ public:
 
     void alloc_row_size(size_t n);
 
+    /// replace the row with cols views of samples each, spectra j starts at data + j * stride
+    void map_to_buffer(real_t* data, size_t cols, size_t samples, size_t stride);
+
     void recalc_elapsed_livetime();
 
     auto size() const { return _data_line.size(); }
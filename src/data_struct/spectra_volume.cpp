@@ -52,9 +52,33 @@ POSSIBILITY OF SUCH DAMAGE.
 namespace data_struct
 {
 
+//-----------------------------------------------------------------------------
+
+template<typename T>
+static void add_compact_counts(const T* counts, size_t samples, Spectra& out)
+{
+    static_cast<Spectra::TMapXr&>(out) += Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1> >(counts, samples).template cast<real_t>();
+}
+
+//-----------------------------------------------------------------------------
+
 Spectra_Volume::Spectra_Volume()
 {
+    _storage = Volume_Storage::REAL;
+    _allow_compact = false;
+    _samples = nullptr;
+    _cols = 0;
+    _stride = 0;
+}
 
+Spectra_Volume::Spectra_Volume(const Spectra_Volume& vol)
+{
+    _storage = Volume_Storage::REAL;
+    _allow_compact = false;
+    _samples = nullptr;
+    _cols = 0;
+    _stride = 0;
+    *this = vol;
 }
 
 Spectra_Volume::~Spectra_Volume()
@@ -62,42 +86,267 @@ Spectra_Volume::~Spectra_Volume()
 
 }
 
-void Spectra_Volume::resize_and_zero(size_t rows, size_t cols, size_t samples)
+Spectra_Volume& Spectra_Volume::operator=(const Spectra_Volume& vol)
+{
+    if (this != &vol && vol._storage != Volume_Storage::REAL)
+    {
+        resize_and_zero(vol.rows(), vol._cols, vol._stride, vol._storage);
+        _counts_u16 = vol._counts_u16;
+        _counts_u32 = vol._counts_u32;
+        _elapsed_livetime = vol._elapsed_livetime;
+        _elapsed_realtime = vol._elapsed_realtime;
+        _input_counts = vol._input_counts;
+        _output_counts = vol._output_counts;
+    }
+    else if (this != &vol)
+    {
+        resize_and_zero(vol.rows(), vol._cols, vol._stride);
+        for(size_t i=0; i<vol.rows(); i++)
+        {
+            if (_data_vol[i].size() != vol[i].size())
+            {
+                _data_vol[i].alloc_row_size(vol[i].size());
+            }
+            for(size_t j=0; j<vol[i].size(); j++)
+            {
+                _data_vol[i][j] = vol[i][j];
+            }
+        }
+    }
+    return *this;
+}
+
+void Spectra_Volume::resize_and_zero(size_t rows, size_t cols, size_t samples, Volume_Storage storage)
 {
+    // drop the views before the buffer they point into goes away
+    _data_vol.clear();
+    _relocate_buffer.resize(0);
+    _storage = storage;
+    _counts_u16.clear();
+    _counts_u16.shrink_to_fit();
+    _counts_u32.clear();
+    _counts_u32.shrink_to_fit();
+    _mapped.unmap();
+    _buffer.resize(0);
+    if (_storage == Volume_Storage::REAL)
+    {
+        if (_scratch_dir.length() > 0 && _mapped.map(_scratch_dir, rows * cols * samples))
+        {
+            _samples = _mapped.data();
+        }
+        else
+        {
+            _buffer.setZero(rows * cols * samples);
+            _samples = _buffer.data();
+        }
+    }
+    else
+    {
+        _samples = nullptr;
+        if (_storage == Volume_Storage::UINT16)
+        {
+            _counts_u16.assign(rows * cols * samples, 0);
+        }
+        else
+        {
+            _counts_u32.assign(rows * cols * samples, 0);
+        }
+    }
+    _cols = cols;
+    _stride = samples;
+    _elapsed_livetime.setConstant(rows, cols, 1.0);
+    _elapsed_realtime.setConstant(rows, cols, 1.0);
+    _input_counts.setConstant(rows, cols, 1.0);
+    _output_counts.setConstant(rows, cols, 1.0);
 
     _data_vol.resize(rows);
     for(size_t i=0; i<_data_vol.size(); i++)
     {
-        _data_vol[i].resize_and_zero(cols, samples);
+        if (_storage == Volume_Storage::REAL)
+        {
+            _data_vol[i].map_to_buffer(_samples + (i * cols * samples), cols, samples, samples);
+        }
+        else
+        {
+            // empty spectra, they only carry the meta data
+            _data_vol[i].map_to_buffer(nullptr, cols, 0, 0);
+        }
+        for(size_t j=0; j<cols; j++)
+        {
+            _data_vol[i][j].map_meta_to(&_elapsed_livetime(i, j), &_elapsed_realtime(i, j), &_input_counts(i, j), &_output_counts(i, j));
+        }
     }
 
 }
 
-Spectra Spectra_Volume::integrate()
+void Spectra_Volume::pixel_spectra(size_t row, size_t col, Spectra& out) const
 {
+    const Spectra& spectra = _data_vol[row][col];
+    if (_storage == Volume_Storage::REAL)
+    {
+        out = spectra;
+        return;
+    }
+    out.setZero(_stride);
+    size_t offset = ((row * _cols) + col) * _stride;
+    if (_storage == Volume_Storage::UINT16)
+    {
+        add_compact_counts(_counts_u16.data() + offset, _stride, out);
+    }
+    else
+    {
+        add_compact_counts(_counts_u32.data() + offset, _stride, out);
+    }
+    out.elapsed_livetime(spectra.elapsed_livetime());
+    out.elapsed_realtime(spectra.elapsed_realtime());
+    out.input_counts(spectra.input_counts());
+    out.output_counts(spectra.output_counts());
+}
 
-    Spectra i_spectra(_data_vol[0][0].size());
-    real_t elt = 0.0;
-    real_t ert = 0.0;
-    real_t in_cnt = 0.0;
-    real_t out_cnt = 0.0;
+bool Spectra_Volume::_is_mapped(size_t row, size_t col) const
+{
+    return _data_vol[row][col].data() == _samples + (((row * _cols) + col) * _stride);
+}
+
+real_t* Spectra_Volume::contiguous_data(size_t rows, size_t cols, size_t samples)
+{
+    if (_data_vol.size() != rows || _cols != cols || _stride != samples || _samples == nullptr)
+    {
+        return nullptr;
+    }
     for(size_t i = 0; i < _data_vol.size(); i++)
     {
-        for(size_t j = 0; j < _data_vol[0].size(); j++)
+        if (_data_vol[i].size() != cols)
+        {
+            return nullptr;
+        }
+        for(size_t j = 0; j < cols; j++)
+        {
+            if (false == _is_mapped(i, j) || (size_t)_data_vol[i][j].size() != samples)
+            {
+                return nullptr;
+            }
+        }
+    }
+    return _samples;
+}
+
+void Spectra_Volume::prefetch_rows(size_t row_start, size_t row_end)
+{
+    if (row_end > _data_vol.size())
+    {
+        row_end = _data_vol.size();
+    }
+    if (is_out_of_core() && row_start < row_end)
+    {
+        _mapped.will_need(row_start * _cols * _stride, (row_end - row_start) * _cols * _stride);
+    }
+}
+
+void Spectra_Volume::release_rows(size_t row_start, size_t row_end)
+{
+    if (row_end > _data_vol.size())
+    {
+        row_end = _data_vol.size();
+    }
+    if (is_out_of_core() && row_start < row_end)
+    {
+        _mapped.dont_need(row_start * _cols * _stride, (row_end - row_start) * _cols * _stride);
+    }
+}
+
+bool Spectra_Volume::begin_relocate()
+{
+    // out of core volumes stay in their scratch file
+    if (_buffer.size() == 0 || is_out_of_core())
+    {
+        return false;
+    }
+    // resize does not initialize, the first write decides which node backs each page
+    _relocate_buffer.resize(_buffer.size());
+    return true;
+}
+
+void Spectra_Volume::relocate_tile(size_t row_start, size_t row_end, size_t col_start, size_t col_end)
+{
+    if (_storage != Volume_Storage::REAL || is_out_of_core())
+    {
+        return;
+    }
+    for(size_t i=row_start; i<row_end; i++)
+    {
+        for(size_t j=col_start; j<col_end; j++)
         {
-            i_spectra += _data_vol[i][j];
-            elt += _data_vol[i][j].elapsed_livetime();
-            ert += _data_vol[i][j].elapsed_realtime();
-            in_cnt += _data_vol[i][j].input_counts();
-            out_cnt += _data_vol[i][j].output_counts();
+            if (_relocate_buffer.size() == _buffer.size() && _is_mapped(i, j))
+            {
+                size_t offset = ((i * _cols) + j) * _stride;
+                _relocate_buffer.segment(offset, _stride) = _buffer.segment(offset, _stride);
+            }
+            else
+            {
+                // spectra was resized out of the volume, it owns its samples
+                Spectra local_spectra(_data_vol[i][j]);
+                _data_vol[i][j].swap(local_spectra);
+            }
         }
     }
+}
 
-    i_spectra.elapsed_livetime(elt);
-    i_spectra.elapsed_realtime(ert);
-    i_spectra.input_counts(in_cnt);
-    i_spectra.output_counts(out_cnt);
+void Spectra_Volume::end_relocate()
+{
+    if (_relocate_buffer.size() == 0 || _relocate_buffer.size() != _buffer.size())
+    {
+        return;
+    }
+    for(size_t i=0; i<_data_vol.size(); i++)
+    {
+        for(size_t j=0; j<_data_vol[i].size(); j++)
+        {
+            if (_is_mapped(i, j))
+            {
+                Spectra& spectra = _data_vol[i][j];
+                spectra.map_to(_relocate_buffer.data() + (((i * _cols) + j) * _stride), spectra.size());
+            }
+        }
+    }
+    _buffer.swap(_relocate_buffer);
+    _relocate_buffer.resize(0);
+    _samples = _buffer.data();
+}
+
+Spectra Spectra_Volume::integrate()
+{
 
+    // float pixels summed in double, see Spectra_Accumulator_T
+    Spectra_Accumulator accumulator(samples_size());
+    if (_storage == Volume_Storage::UINT16)
+    {
+        for(size_t p = 0; p < _data_vol.size() * _cols; p++)
+        {
+            accumulator.add_samples(Eigen::Map<const Eigen::Array<uint16_t, Eigen::Dynamic, 1> >(_counts_u16.data() + (p * _stride), _stride));
+        }
+    }
+    else if (_storage == Volume_Storage::UINT32)
+    {
+        for(size_t p = 0; p < _data_vol.size() * _cols; p++)
+        {
+            accumulator.add_samples(Eigen::Map<const Eigen::Array<uint32_t, Eigen::Dynamic, 1> >(_counts_u32.data() + (p * _stride), _stride));
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < _data_vol.size(); i++)
+        {
+            for(size_t j = 0; j < _data_vol[0].size(); j++)
+            {
+                accumulator.add_samples(_data_vol[i][j]);
+            }
+        }
+    }
+
+    accumulator.add_meta(_elapsed_livetime.cast<compute_t>().sum(), _elapsed_realtime.cast<compute_t>().sum(), _input_counts.cast<compute_t>().sum(), _output_counts.cast<compute_t>().sum());
+
+    Spectra i_spectra = accumulator.to_spectra();
     i_spectra.recalc_elapsed_livetime();
 
     return i_spectra;
@@ -106,10 +355,7 @@ Spectra Spectra_Volume::integrate()
 void Spectra_Volume::recalc_elapsed_livetime()
 {
 
-    for(size_t i=0; i<_data_vol.size(); i++)
-    {
-        _data_vol[i].recalc_elapsed_livetime();
-    }
+    _elapsed_livetime = (_input_counts == 0 || _output_counts == 0).select(_elapsed_realtime, _elapsed_realtime * _output_counts / _input_counts);
 
 }
 
@@ -130,24 +376,12 @@ void Spectra_Volume::generate_scaler_maps(vector<Scaler_Map> *scaler_maps)
         out_cnt_map.unit = "cts/s";
         dead_time_map.unit = "%";
 
-        elt_map.values.resize(_data_vol.size(), _data_vol[0].size());
-        ert_map.values.resize(_data_vol.size(), _data_vol[0].size());
-        in_cnt_map.values.resize(_data_vol.size(), _data_vol[0].size());
-        out_cnt_map.values.resize(_data_vol.size(), _data_vol[0].size());
-        dead_time_map.values.resize(_data_vol.size(), _data_vol[0].size());
+        elt_map.values = _elapsed_livetime;
+        ert_map.values = _elapsed_realtime;
+        in_cnt_map.values = _input_counts;
+        out_cnt_map.values = _output_counts;
+        dead_time_map.values = ((real_t)1.0 - (_output_counts / _input_counts)) * (real_t)100.0;
 
-        for (size_t i = 0; i < _data_vol.size(); i++)
-        {
-            for (size_t j = 0; j < _data_vol[0].size(); j++)
-            {
-                elt_map.values(i, j) = _data_vol[i][j].elapsed_livetime();
-                ert_map.values(i, j) = _data_vol[i][j].elapsed_realtime();
-                in_cnt_map.values(i, j) = _data_vol[i][j].input_counts();
-                out_cnt_map.values(i, j) = _data_vol[i][j].output_counts();
-                dead_time_map.values(i, j) = (1.0 - (out_cnt_map.values(i, j) / in_cnt_map.values(i, j))) * 100.0;
-            }
-        }
-        
         scaler_maps->push_back(elt_map);
         scaler_maps->push_back(ert_map);
         scaler_maps->push_back(in_cnt_map);
@@ -51,26 +51,45 @@ POSSIBILITY OF SUCH DAMAGE.
 #define SPECTRAVOLUME_H
 
 #include "data_struct/spectra_line.h"
+#include "data_struct/mapped_buffer.h"
 #include "scan_info.h"
+#include <cstdint>
 
 namespace data_struct
 {
 
+/// how the samples of a volume are stored. The integer modes keep raw detector counts
+/// and only convert them to real_t one pixel at a time, see Spectra_Volume::pixel_spectra()
+enum class Volume_Storage { REAL, UINT16, UINT32 };
+
 /**
  * @brief The Spectra_Volume class : A volume of spectras
+ *  All samples live in one contiguous rows x cols x samples buffer and every Spectra of the volume is a view into it.
+ *  Acquisition meta data is kept as rows x cols planes, the spectra read and write their meta data through them.
+ *  In compact storage the samples are kept as integer counts instead, the pixel spectra are empty and only carry
+ *  the meta data, read the samples with pixel_spectra().
+ *  Out of core volumes keep the samples in a memory mapped scratch file instead of memory, see set_out_of_core().
  */
 class DLL_EXPORT Spectra_Volume
 {
 public:
 	Spectra_Volume();
 
+	Spectra_Volume(const Spectra_Volume& vol);
+
+	Spectra_Volume(Spectra_Volume&& vol) = default;
+
 	~Spectra_Volume();
 
+	Spectra_Volume& operator=(const Spectra_Volume& vol);
+
+	Spectra_Volume& operator=(Spectra_Volume&& vol) = default;
+
     Spectra_Line& operator [](std::size_t row) { return _data_vol[row]; }
 
     const Spectra_Line& operator [](std::size_t row) const { return _data_vol[row]; }
 
-    void resize_and_zero(size_t rows, size_t cols, size_t samples);
+    void resize_and_zero(size_t rows, size_t cols, size_t samples, Volume_Storage storage = Volume_Storage::REAL);
 
     Spectra integrate();
 
@@ -82,13 +101,112 @@ public:
 
     void recalc_elapsed_livetime();
 
-	size_t samples_size() const { if (_data_vol.size() > 0) return _data_vol[0][0].size(); else return 0; }
+	size_t samples_size() const { if (_storage != Volume_Storage::REAL) return _stride; if (_data_vol.size() > 0) return _data_vol[0][0].size(); else return 0; }
 
     int rank() { return 3; }
 
+    /// rows x cols meta data planes, only resize them through resize_and_zero
+    ArrayXXr& elapsed_livetime() { return _elapsed_livetime; }
+
+    const ArrayXXr& elapsed_livetime() const { return _elapsed_livetime; }
+
+    ArrayXXr& elapsed_realtime() { return _elapsed_realtime; }
+
+    const ArrayXXr& elapsed_realtime() const { return _elapsed_realtime; }
+
+    ArrayXXr& input_counts() { return _input_counts; }
+
+    const ArrayXXr& input_counts() const { return _input_counts; }
+
+    ArrayXXr& output_counts() { return _output_counts; }
+
+    const ArrayXXr& output_counts() const { return _output_counts; }
+
+    Volume_Storage storage() const { return _storage; }
+
+    /// let loaders pick integer storage when the source counts are integers
+    void set_allow_compact(bool val) { _allow_compact = val; }
+
+    bool allow_compact() const { return _allow_compact; }
+
+    /// rows x cols x samples counts for compact storage, nullptr for other storage
+    uint16_t* compact_data_u16() { return (_storage == Volume_Storage::UINT16) ? _counts_u16.data() : nullptr; }
+
+    uint32_t* compact_data_u32() { return (_storage == Volume_Storage::UINT32) ? _counts_u32.data() : nullptr; }
+
+    /// copy pixel (row, col) with its meta data into out, converting compact counts to real_t
+    void pixel_spectra(size_t row, size_t col, Spectra& out) const;
+
+    /// samples of pixel (row, col) start at data() + (row * cols() + col) * stride()
+    real_t* data() { return _samples; }
+
+    const real_t* data() const { return _samples; }
+
+    size_t stride() const { return _stride; }
+
+    /// the buffer if every spectra is still a view laid out as rows x cols x samples, nullptr otherwise
+    real_t* contiguous_data(size_t rows, size_t cols, size_t samples);
+
+    /// back the samples of the next resize_and_zero with a memory mapped scratch file in scratch_dir, empty to keep them in memory
+    void set_out_of_core(const std::string& scratch_dir) { _scratch_dir = scratch_dir; }
+
+    bool is_out_of_core() const { return _mapped.data() != nullptr; }
+
+    /// bytes of samples in one row
+    size_t row_bytes() const { return _cols * _stride * sizeof(real_t); }
+
+    /// out of core volumes : start reading rows [row_start, row_end) in from the scratch file
+    void prefetch_rows(size_t row_start, size_t row_end);
+
+    /// out of core volumes : drop rows [row_start, row_end) from resident memory, they are read back when touched again
+    void release_rows(size_t row_start, size_t row_end);
+
+    /// allocate an untouched buffer to move the volume into, pages land on the node of the thread that copies them
+    bool begin_relocate();
+
+    /// copy a tile into the relocate buffer, safe to call from many threads for disjoint tiles
+    void relocate_tile(size_t row_start, size_t row_end, size_t col_start, size_t col_end);
+
+    /// swap in the relocate buffer and point every view at it
+    void end_relocate();
+
 private:
 
+    bool _is_mapped(size_t row, size_t col) const;
+
     std::vector<Spectra_Line> _data_vol;
+
+    ArrayXr _buffer;
+
+    Mapped_Buffer _mapped;
+
+    /// _buffer or _mapped, whichever holds the samples
+    real_t* _samples;
+
+    std::string _scratch_dir;
+
+    ArrayXr _relocate_buffer;
+
+    ArrayXXr _elapsed_livetime;
+
+    ArrayXXr _elapsed_realtime;
+
+    ArrayXXr _input_counts;
+
+    ArrayXXr _output_counts;
+
+    std::vector<uint16_t> _counts_u16;
+
+    std::vector<uint32_t> _counts_u32;
+
+    Volume_Storage _storage;
+
+    bool _allow_compact;
+
+    size_t _cols;
+
+    size_t _stride;
+
 //    std::vector<std::vector< Spectra* > > array3D;
 
 };
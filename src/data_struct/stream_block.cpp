@@ -64,6 +64,7 @@ Stream_Block::Stream_Block()
     del_str_ptr = false;
 	spectra = nullptr;
     optimize_fit_params_preset = fitting::models::Fit_Params_Preset::BATCH_FIT_NO_TAILS;
+    _fitting_blocks_elements = nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -84,6 +85,7 @@ Stream_Block::Stream_Block(int detector,
     // by default we don't want to delete the string pointers becaues they are shared by stream blocks
     del_str_ptr = false;
     spectra = nullptr;
+    _fitting_blocks_elements = nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -128,6 +130,7 @@ Stream_Block::Stream_Block(const Stream_Block& stream_block)
 	this->spectra = stream_block.spectra;
 	this->elements_to_fit = stream_block.elements_to_fit;
 	this->model = stream_block.model;
+	this->_fitting_blocks_elements = stream_block._fitting_blocks_elements;
 }
 
 
@@ -144,6 +147,7 @@ Stream_Block& Stream_Block::operator=(const Stream_Block& stream_block)
 	this->spectra = stream_block.spectra;
 	this->elements_to_fit = stream_block.elements_to_fit;
 	this->model = stream_block.model;
+	this->_fitting_blocks_elements = stream_block._fitting_blocks_elements;
 	return *this;
 }
 
@@ -159,6 +163,33 @@ void Stream_Block::init_fitting_blocks(std::unordered_map<Fitting_Routines, fitt
         //throw Exception;
     }
 
+    // recycled block with the same routines and elements, only zero the counts
+    bool reuse = (_fitting_blocks_elements == elements_to_fit && fitting_blocks.size() == fit_routines->size());
+    for(const auto &itr : *fit_routines)
+    {
+        if(false == reuse)
+        {
+            break;
+        }
+        auto f_itr = fitting_blocks.find(itr.first);
+        if(f_itr == fitting_blocks.end())
+        {
+            reuse = false;
+            break;
+        }
+        f_itr->second.fit_routine = itr.second;
+        for(auto& c_itr : f_itr->second.fit_counts)
+        {
+            c_itr.second = (real_t)0.0;
+        }
+    }
+    if(reuse)
+    {
+        return;
+    }
+
+    fitting_blocks.clear();
+    _fitting_blocks_elements = elements_to_fit;
     for(const auto &itr : *fit_routines)
     {
         fitting_blocks[itr.first] = Stream_Fitting_Block();
@@ -173,6 +204,35 @@ void Stream_Block::init_fitting_blocks(std::unordered_map<Fitting_Routines, fitt
 
 //-----------------------------------------------------------------------------
 
+void Stream_Block::reset(int detector, size_t row, size_t col, size_t height, size_t width)
+{
+    if(del_str_ptr)
+    {
+        if(dataset_name != nullptr)
+        {
+            delete dataset_name;
+        }
+        if(dataset_directory != nullptr)
+        {
+            delete dataset_directory;
+        }
+    }
+    _row = row;
+    _col = col;
+    _height = height;
+    _width = width;
+    _detector = detector;
+    theta = 0;
+    dataset_directory = nullptr;
+    dataset_name = nullptr;
+    del_str_ptr = false;
+    elements_to_fit = nullptr;
+    model = nullptr;
+    optimize_fit_params_preset = fitting::models::Fit_Params_Preset::BATCH_FIT_NO_TAILS;
+}
+
+//-----------------------------------------------------------------------------
+
 size_t Stream_Block::dataset_hash()
 {
     if (dataset_directory != nullptr && dataset_name != nullptr)
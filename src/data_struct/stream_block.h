@@ -90,6 +90,9 @@ public:
 
     void init_fitting_blocks(std::unordered_map<Fitting_Routines, fitting::routines::Base_Fit_Routine *> *fit_routines, Fit_Element_Map_Dict * elements_to_fit_);
 
+    /// reinitialize a recycled block, keeps spectra and fitting_blocks allocated so they can be reused
+    void reset(int detector, size_t row, size_t col, size_t height, size_t width);
+
     const size_t& row() { return _row; }
 
     const size_t& col() { return _col; }
@@ -139,6 +142,9 @@ protected:
 
     int _detector;
 
+    // elements the fit_counts maps in fitting_blocks were built for
+    Fit_Element_Map_Dict * _fitting_blocks_elements;
+
 };
 
 } //namespace data_struct
@@ -0,0 +1,263 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#include "stream_block_pool.h"
+
+namespace data_struct
+{
+
+Stream_Block_Pool* Stream_Block_Pool::_this_inst(nullptr);
+
+std::mutex Stream_Block_Pool::_inst_mutex;
+
+//-----------------------------------------------------------------------------
+
+Stream_Block_Pool* Stream_Block_Pool::inst()
+{
+    std::lock_guard<std::mutex> lock(_inst_mutex);
+
+    if (_this_inst == nullptr)
+    {
+        _this_inst = new Stream_Block_Pool();
+    }
+    return _this_inst;
+}
+
+//-----------------------------------------------------------------------------
+
+Stream_Block_Pool::Stream_Block_Pool()
+{
+    _max_size = 0;
+    _num_allocated = 0;
+    _num_reused = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+Stream_Block_Pool::~Stream_Block_Pool()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void Stream_Block_Pool::set_max_size(size_t max_size)
+{
+    std::vector<Stream_Block*> del_blocks;
+    std::vector<Spectra*> del_spectra;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _max_size = max_size;
+        while (_max_size > 0 && _free_blocks.size() > _max_size)
+        {
+            del_blocks.push_back(_free_blocks.back());
+            _free_blocks.pop_back();
+        }
+        while (_max_size > 0 && _free_spectra.size() > _max_size)
+        {
+            del_spectra.push_back(_free_spectra.back());
+            _free_spectra.pop_back();
+        }
+    }
+    for (auto itr : del_blocks)
+    {
+        delete itr;
+    }
+    for (auto itr : del_spectra)
+    {
+        delete itr;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Stream_Block_Pool::preallocate(size_t count, size_t spectra_size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_max_size > 0)
+    {
+        count = std::min(count, _max_size);
+    }
+    while (_free_blocks.size() < count)
+    {
+        _free_blocks.push_back(new Stream_Block());
+        _num_allocated++;
+    }
+    while (_free_spectra.size() < count)
+    {
+        _free_spectra.push_back(new Spectra(spectra_size));
+        _num_allocated++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+Stream_Block* Stream_Block_Pool::acquire_block(int detector, size_t row, size_t col, size_t height, size_t width)
+{
+    Stream_Block* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_free_blocks.size() > 0)
+        {
+            block = _free_blocks.back();
+            _free_blocks.pop_back();
+            _num_reused++;
+        }
+        else
+        {
+            _num_allocated++;
+        }
+    }
+    if (block == nullptr)
+    {
+        return new Stream_Block(detector, row, col, height, width);
+    }
+    block->reset(detector, row, col, height, width);
+    return block;
+}
+
+//-----------------------------------------------------------------------------
+
+Spectra* Stream_Block_Pool::acquire_spectra(size_t spectra_size)
+{
+    Spectra* spectra = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_free_spectra.size() > 0)
+        {
+            spectra = _free_spectra.back();
+            _free_spectra.pop_back();
+            _num_reused++;
+        }
+        else
+        {
+            _num_allocated++;
+        }
+    }
+    if (spectra == nullptr)
+    {
+        return new Spectra(spectra_size);
+    }
+    if ((size_t)spectra->size() != spectra_size)
+    {
+        spectra->resize(spectra_size);
+    }
+    spectra->setZero();
+    spectra->elapsed_livetime(1.0);
+    spectra->elapsed_realtime(1.0);
+    spectra->input_counts(1.0);
+    spectra->output_counts(1.0);
+    return spectra;
+}
+
+//-----------------------------------------------------------------------------
+
+void Stream_Block_Pool::release_block(Stream_Block* block)
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+    if (block->spectra != nullptr)
+    {
+        release_spectra(block->spectra);
+        block->spectra = nullptr;
+    }
+    // frees dataset strings owned by end blocks
+    block->reset(-1, -1, -1, -1, -1);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_max_size == 0 || _free_blocks.size() < _max_size)
+        {
+            _free_blocks.push_back(block);
+            return;
+        }
+    }
+    delete block;
+}
+
+//-----------------------------------------------------------------------------
+
+void Stream_Block_Pool::release_spectra(Spectra* spectra)
+{
+    if (spectra == nullptr)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_max_size == 0 || _free_spectra.size() < _max_size)
+        {
+            _free_spectra.push_back(spectra);
+            return;
+        }
+    }
+    delete spectra;
+}
+
+//-----------------------------------------------------------------------------
+
+void Stream_Block_Pool::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto itr : _free_blocks)
+    {
+        delete itr;
+    }
+    _free_blocks.clear();
+    for (auto itr : _free_spectra)
+    {
+        delete itr;
+    }
+    _free_spectra.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace data_struct
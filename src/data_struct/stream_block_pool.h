@@ -0,0 +1,127 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#ifndef Stream_Block_Pool_H
+#define Stream_Block_Pool_H
+
+#include "core/defines.h"
+#include "data_struct/stream_block.h"
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+namespace data_struct
+{
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief The Stream_Block_Pool class : recycles stream blocks and spectra between the sources and sinks
+///        so streaming does not allocate per pixel. The number of idle objects kept is capped
+///        (sources derive the cap from --mem-limit), anything released past the cap is deleted.
+///
+class DLL_EXPORT Stream_Block_Pool
+{
+
+public:
+
+    static Stream_Block_Pool* inst();
+
+    ~Stream_Block_Pool();
+
+    /// max number of idle blocks and spectra kept for reuse, 0 for no limit
+    void set_max_size(size_t max_size);
+
+    size_t max_size() { return _max_size; }
+
+    /// allocate up to count blocks and spectra ahead of the first pixel
+    void preallocate(size_t count, size_t spectra_size);
+
+    Stream_Block* acquire_block(int detector, size_t row, size_t col, size_t height, size_t width);
+
+    /// zeroed spectra of spectra_size channels
+    Spectra* acquire_spectra(size_t spectra_size);
+
+    /// return a block, an attached spectra goes back to the spectra pool
+    void release_block(Stream_Block* block);
+
+    void release_spectra(Spectra* spectra);
+
+    /// delete all idle blocks and spectra
+    void clear();
+
+    size_t num_allocated() { return _num_allocated; }
+
+    size_t num_reused() { return _num_reused; }
+
+private:
+
+    Stream_Block_Pool();
+
+    static Stream_Block_Pool *_this_inst;
+
+    static std::mutex _inst_mutex;
+
+    std::mutex _mutex;
+
+    std::vector<Stream_Block*> _free_blocks;
+
+    std::vector<Spectra*> _free_spectra;
+
+    size_t _max_size;
+
+    size_t _num_allocated;
+
+    size_t _num_reused;
+
+};
+
+} //namespace data_struct
+
+#endif // Stream_Block_Pool_H
@@ -61,6 +61,9 @@ namespace models
 using namespace data_struct;
 using namespace std;
 
+/// d model / d parameter, one column per free parameter, column c belongs to the parameter with opt_array_index c
+typedef Eigen::Array<real_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> JacobianXr;
+
 /*
  1 batch_a: matrix batch fit
  2 batch_b: batch_fit_wo_tails
@@ -117,6 +120,33 @@ public:
                                                  const ArrayXr &ev,
                                                  unordered_map<string, ArrayXr>* labeled_spectras) = 0;
 
+    /**
+     * @brief compile_model_plan : Flatten the lines of elements_to_fit into one table so model_spectrum_mp does no per element setup.
+     *                             Call it once per fit setup, before any thread models spectra.
+     * @param elements_to_fit : elements later passed to model_spectrum_mp
+     * @param fit_params : parameters laid out the way the fits will pass them, used to cache the amplitude indices
+     */
+    virtual void compile_model_plan(const Fit_Element_Map_Dict * const elements_to_fit, const Fit_Parameters * const fit_params) = 0;
+
+    /**
+     * @brief analytic_jacobian_columns : Flag the free parameters model_jacobian derives analytically, the rest need finite differences
+     * @param fit_params : parameters after to_array(), free parameters are flagged at their opt_array_index
+     * @param elements_to_fit : elements passed to model_spectrum_mp
+     * @param analytic : resized to the number of free parameters
+     */
+    virtual void analytic_jacobian_columns(const Fit_Parameters * const fit_params,
+                                           const Fit_Element_Map_Dict * const elements_to_fit,
+                                           vector<bool>& analytic) const = 0;
+
+    /**
+     * @brief model_jacobian : Derivatives of model_spectrum_mp for the columns flagged by analytic_jacobian_columns, other columns are zero.
+     * @param jacobian : resized to energy_range.count() x number of free parameters
+     */
+    virtual void model_jacobian(const Fit_Parameters * const fit_params,
+                                const Fit_Element_Map_Dict * const elements_to_fit,
+                                const struct Range energy_range,
+                                JacobianXr& jacobian) = 0;
+
     virtual const ArrayXr peak(real_t gain, real_t sigma, const ArrayXr& delta_energy) const = 0;
 
     virtual const ArrayXr step(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t peak_E) const = 0;
@@ -48,9 +48,12 @@ POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "gaussian_model.h"
+#include "fitting/models/vector_math.h"
 
 #include <iostream>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <math.h>
 
 #include <string.h>
@@ -71,7 +74,9 @@ namespace models
 
 Gaussian_Model::Gaussian_Model() : Base_Model()
 {
+    _threading = Model_Threading::OPENMP;
     _fit_parameters = _generate_default_fit_parameters();
+    _line_window_sigmas = (real_t)DEFAULT_LINE_WINDOW_SIGMAS;
 }
 
 // ----------------------------------------------------------------------------
@@ -326,6 +331,8 @@ const Spectra Gaussian_Model::model_spectrum(const Fit_Parameters * const fit_pa
 	ArrayXr energy = ArrayXr::LinSpaced(energy_range.count(), energy_range.min, energy_range.max);
     ArrayXr ev = energy_offset + (energy * energy_slope) + (pow(energy, (real_t)2.0) * energy_quad);
 
+    const Param_Handles h = _handles(fit_params);
+
     for(const auto& itr : (*elements_to_fit))
     {
         if(itr.first == STR_COHERENT_SCT_AMPLITUDE || itr.first == STR_COMPTON_AMPLITUDE)
@@ -334,30 +341,30 @@ const Spectra Gaussian_Model::model_spectrum(const Fit_Parameters * const fit_pa
         }
         else
         {
-            agr_spectra += model_spectrum_element(fit_params, itr.second, ev, labeled_spectras);
+            agr_spectra += _model_spectrum_element(fit_params, h, itr.second, ev, labeled_spectras);
         }
     }
 
     if (labeled_spectras != nullptr)
     {
-        tmp_spec = elastic_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
+        tmp_spec = _elastic_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
         (*labeled_spectras)[STR_ELASTIC_LINES] += tmp_spec;
         agr_spectra += tmp_spec;
     }
     else
     {
-        agr_spectra += elastic_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
+        agr_spectra += _elastic_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
     }
 
     if (labeled_spectras != nullptr)
     {
-        tmp_spec = compton_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
+        tmp_spec = _compton_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
         (*labeled_spectras)[STR_COMPTON_LINES] += tmp_spec;
         agr_spectra += tmp_spec;
     }
     else
     {
-        agr_spectra += compton_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
+        agr_spectra += _compton_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
     }
 
  //   agr_spectra += escape_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
@@ -381,30 +388,77 @@ const Spectra Gaussian_Model::model_spectrum_mp(const Fit_Parameters * const fit
     ArrayXr energy = ArrayXr::LinSpaced(energy_range.count(), energy_range.min, energy_range.max);
     ArrayXr ev = energy_offset + (energy * energy_slope) + (pow(energy, (real_t)2.0) * energy_quad);
 
+    const Param_Handles h = _handles(fit_params);
+    const bool use_plan = _plan_matches(elements_to_fit);
     std::vector<std::string> keys;
-    for (const auto& itr : (*elements_to_fit))
+    if (false == use_plan)
     {
-        if(itr.first == STR_COHERENT_SCT_AMPLITUDE || itr.first == STR_COMPTON_AMPLITUDE)
+        for (const auto& itr : (*elements_to_fit))
         {
-            continue;
+            if(itr.first == STR_COHERENT_SCT_AMPLITUDE || itr.first == STR_COMPTON_AMPLITUDE)
+            {
+                continue;
+            }
+            else
+            {
+                keys.push_back(itr.first);
+            }
+        }
+    }
+    const int num_elements = use_plan ? (int)_plan.amp_name.size() : (int)keys.size();
+
+    auto model_element = [&](int i, ArrayXr& counts)
+    {
+        if (use_plan)
+        {
+            _model_spectrum_plan(fit_params, h, ev, i, i + 1, counts);
         }
         else
         {
-            keys.push_back(itr.first);
+            counts += _model_spectrum_element(fit_params, h, elements_to_fit->at(keys[i]), ev, nullptr);
+        }
+    };
+
+    ArrayXr counts;
+    if (_use_openmp(num_elements))
+    {
+        // every thread sums its elements into its own partial, the partials are then added pairwise in log2(threads) rounds
+        std::vector<ArrayXr> partials;
+#pragma omp parallel
+        {
+#pragma omp single
+            {
+                partials.assign(omp_get_num_threads(), ArrayXr::Zero(ev.size()));
+            }
+            ArrayXr& partial = partials[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < num_elements; i++)
+            {
+                model_element(i, partial);
+            }
+            for (int stride = 1; stride < (int)partials.size(); stride *= 2)
+            {
+#pragma omp for
+                for (int i = 0; i < (int)partials.size() - stride; i += 2 * stride)
+                {
+                    partials[i] += partials[i + stride];
+                }
+            }
         }
+        counts.swap(partials[0]);
     }
-#pragma omp parallel for
-    for (int i=0; i < (int)keys.size(); i++)
+    else
     {
-        Spectra tmp = model_spectrum_element(fit_params, elements_to_fit->at(keys[i]), ev, nullptr);
-#pragma omp critical
+        counts = ArrayXr::Zero(ev.size());
+        for (int i = 0; i < num_elements; i++)
         {
-            agr_spectra += tmp;
+            model_element(i, counts);
         }
     }
+    agr_spectra += counts;
 
-    agr_spectra += elastic_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
-    agr_spectra += compton_peak(fit_params, ev, fit_params->at(STR_ENERGY_SLOPE).value);
+    agr_spectra += _elastic_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
+    agr_spectra += _compton_peak(fit_params, h, ev, fit_params->value(h.energy_slope));
 
     return agr_spectra;
 }
@@ -415,15 +469,252 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
                                                      const Fit_Element_Map * const element_to_fit,
                                                      const ArrayXr &ev,
                                                      unordered_map<string, ArrayXr>* labeled_spectras)
+{
+    return _model_spectrum_element(fitp, _handles(fitp), element_to_fit, ev, labeled_spectras);
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::compile_model_plan(const Fit_Element_Map_Dict * const elements_to_fit, const Fit_Parameters * const fit_params)
+{
+    _compile_model_plan(elements_to_fit, fit_params, _plan);
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_compile_model_plan(const Fit_Element_Map_Dict * const elements_to_fit, const Fit_Parameters * const fit_params, Model_Plan& plan) const
+{
+    plan = Model_Plan();
+    if (fit_params != nullptr)
+    {
+        try
+        {
+            plan.handles = _resolve_handles(fit_params);
+            plan.has_handles = true;
+            plan.params_layout = fit_params->layout_hash();
+            plan.params_size = fit_params->size();
+        }
+        catch (std::out_of_range&)
+        {
+            // parameters without the model's defaults, every evaluation resolves them and reports the missing one
+        }
+    }
+    if (elements_to_fit == nullptr)
+    {
+        return;
+    }
+    plan.elements = elements_to_fit;
+    plan.num_elements = elements_to_fit->size();
+    plan.elements_stamp = element_dict_stamp(*elements_to_fit);
+
+    for (const auto& itr : (*elements_to_fit))
+    {
+        if(itr.first == STR_COHERENT_SCT_AMPLITUDE || itr.first == STR_COMPTON_AMPLITUDE)
+        {
+            continue;
+        }
+        const Fit_Element_Map* element = itr.second;
+        plan.amp_name.push_back(element->full_name());
+        plan.amp_index.push_back((fit_params != nullptr) ? fit_params->param_index(element->full_name()) : -1);
+        plan.width_multi.push_back(element->width_multi());
+        plan.line_begin.push_back((int)plan.energy.size());
+
+        const vector<Element_Energy_Ratio>& energy_ratios = element->energy_ratios();
+        for (int idx = 0; idx < (int)energy_ratios.size(); idx++)
+        {
+            const Element_Energy_Ratio& er_struct = energy_ratios[idx];
+            real_t binding_energy = element->binding_energy(idx);
+            // lines _model_spectrum_element skips or scales by 0 at any incident energy
+            if (er_struct.ratio == 0.0 || er_struct.energy <= 0.0 || binding_energy == std::numeric_limits<real_t>::max())
+            {
+                continue;
+            }
+
+            int shape = PLAN_PLAIN;
+            switch (er_struct.ptype)
+            {
+            case Element_Param_Type::Kb1_Line:
+            case Element_Param_Type::Kb2_Line:
+                shape = PLAN_KB;
+                break;
+            case Element_Param_Type::Ka1_Line:
+            case Element_Param_Type::Ka2_Line:
+            case Element_Param_Type::La1_Line:
+            case Element_Param_Type::La2_Line:
+            case Element_Param_Type::Lb1_Line:
+            case Element_Param_Type::Lb2_Line:
+            case Element_Param_Type::Lb3_Line:
+            case Element_Param_Type::Lb4_Line:
+            case Element_Param_Type::Lg1_Line:
+            case Element_Param_Type::Lg2_Line:
+            case Element_Param_Type::Lg3_Line:
+            case Element_Param_Type::Lg4_Line:
+            case Element_Param_Type::Ll_Line:
+            case Element_Param_Type::Ln_Line:
+                shape = PLAN_KA_L;
+                break;
+            default:
+                break;
+            }
+
+            plan.energy.push_back(er_struct.energy);
+            plan.ratio.push_back(er_struct.ratio);
+            plan.mu_fraction.push_back(er_struct.mu_fraction);
+            plan.binding_energy.push_back(binding_energy);
+            plan.shape.push_back(shape);
+        }
+    }
+    plan.line_begin.push_back((int)plan.energy.size());
+}
+
+// ----------------------------------------------------------------------------
+
+bool Gaussian_Model::_plan_matches(const Fit_Element_Map_Dict * const elements_to_fit) const
+{
+    // same dict object is not enough, it can be edited in place between initialize calls
+    return elements_to_fit != nullptr
+        && _plan.elements == elements_to_fit
+        && _plan.num_elements == elements_to_fit->size()
+        && _plan.elements_stamp == element_dict_stamp(*elements_to_fit);
+}
+
+// ----------------------------------------------------------------------------
+
+int Gaussian_Model::_plan_amp_index(const Model_Plan& plan, const Fit_Parameters * const fitp, int e) const
+{
+    // the cached index only holds for the parameter layout the plan was compiled against
+    int amp_idx = plan.amp_index[e];
+    if (amp_idx < 0 || amp_idx >= (int)fitp->size() || fitp->name_at(amp_idx) != plan.amp_name[e])
+    {
+        amp_idx = fitp->param_index(plan.amp_name[e]);
+    }
+    return amp_idx;
+}
+
+// ----------------------------------------------------------------------------
+
+Gaussian_Model::Param_Handles Gaussian_Model::_resolve_handles(const Fit_Parameters * const fitp) const
+{
+    // same contract as Fit_Parameters::at(name), a missing parameter throws std::out_of_range
+    auto index_of = [fitp](const std::string& name)
+    {
+        int idx = fitp->param_index(name);
+        if (idx < 0)
+        {
+            throw std::out_of_range("Missing fit parameter " + name);
+        }
+        return idx;
+    };
+
+    Param_Handles h;
+    h.energy_slope = index_of(STR_ENERGY_SLOPE);
+    h.fwhm_offset = index_of(STR_FWHM_OFFSET);
+    h.fwhm_fanoprime = index_of(STR_FWHM_FANOPRIME);
+    h.f_step_offset = index_of(STR_F_STEP_OFFSET);
+    h.f_step_linear = index_of(STR_F_STEP_LINEAR);
+    h.f_tail_offset = index_of(STR_F_TAIL_OFFSET);
+    h.f_tail_linear = index_of(STR_F_TAIL_LINEAR);
+    h.kb_f_tail_offset = index_of(STR_KB_F_TAIL_OFFSET);
+    h.kb_f_tail_linear = index_of(STR_KB_F_TAIL_LINEAR);
+    h.gamma_offset = index_of(STR_GAMMA_OFFSET);
+    h.gamma_linear = index_of(STR_GAMMA_LINEAR);
+    h.coherent_sct_energy = index_of(STR_COHERENT_SCT_ENERGY);
+    h.coherent_sct_amplitude = index_of(STR_COHERENT_SCT_AMPLITUDE);
+    h.compton_angle = index_of(STR_COMPTON_ANGLE);
+    h.compton_fwhm_corr = index_of(STR_COMPTON_FWHM_CORR);
+    h.compton_f_step = index_of(STR_COMPTON_F_STEP);
+    h.compton_f_tail = index_of(STR_COMPTON_F_TAIL);
+    h.compton_hi_f_tail = index_of(STR_COMPTON_HI_F_TAIL);
+    h.compton_gamma = index_of(STR_COMPTON_GAMMA);
+    h.compton_hi_gamma = index_of(STR_COMPTON_HI_GAMMA);
+    h.compton_amplitude = index_of(STR_COMPTON_AMPLITUDE);
+    return h;
+}
+
+// ----------------------------------------------------------------------------
+
+Gaussian_Model::Param_Handles Gaussian_Model::_handles(const Fit_Parameters * const fitp) const
+{
+    if (_plan.has_handles && fitp->size() == _plan.params_size && fitp->layout_hash() == _plan.params_layout)
+    {
+        return _plan.handles;
+    }
+    return _resolve_handles(fitp);
+}
+
+// ----------------------------------------------------------------------------
+
+real_t Gaussian_Model::line_window_error(real_t n_sigma)
+{
+    if (n_sigma <= (real_t)0.0)
+    {
+        return (real_t)0.0;
+    }
+    // the gaussian outside +-n sigma is erfc(n / sqrt(2)) of its area, the step beyond n sigma is erfc(n / sqrt(2)) of its height
+    // and the tail is cut at n^2 / 2 decay lengths, exp(-n^2 / 2) bounds all three
+    return std::exp((real_t)-0.5 * n_sigma * n_sigma);
+}
+
+// ----------------------------------------------------------------------------
+
+bool Gaussian_Model::_use_openmp(int num_elements) const
+{
+    // inside a parallel region the threads are already busy, a nested team would only oversubscribe the cores
+    return (_threading == Model_Threading::OPENMP && num_elements > 1 && omp_get_max_threads() > 1 && false == omp_in_parallel());
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_line_window(const ArrayXr& ev, real_t energy_lo, real_t energy_hi, int& start, int& count) const
+{
+    start = 0;
+    count = (int)ev.size();
+    // a negative quadratic term can fold the energy axis over, the search needs it increasing
+    if (_line_window_sigmas <= (real_t)0.0 || false == std::is_sorted(ev.data(), ev.data() + ev.size()))
+    {
+        return;
+    }
+    const real_t* first = std::lower_bound(ev.data(), ev.data() + ev.size(), energy_lo);
+    const real_t* last = std::upper_bound(first, ev.data() + ev.size(), energy_hi);
+    start = (int)(first - ev.data());
+    count = (int)(last - first);
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_fluorescence_line_window(const ArrayXr& ev, real_t energy, real_t sigma, bool has_step, bool has_tail, real_t gamma, int& start, int& count) const
+{
+    // only the channels the line reaches, the step is flat below the peak and the tail decays as exp(v / (gamma * sigma))
+    real_t energy_lo = energy - _line_window_sigmas * sigma;
+    real_t energy_hi = energy + _line_window_sigmas * sigma;
+    if (has_step)
+    {
+        energy_lo = std::numeric_limits<real_t>::lowest();
+    }
+    else if (has_tail)
+    {
+        energy_lo = std::min(energy_lo, energy - (real_t)0.5 * _line_window_sigmas * _line_window_sigmas * gamma * sigma);
+    }
+    _line_window(ev, energy_lo, energy_hi, start, count);
+}
+
+// ----------------------------------------------------------------------------
+
+const Spectra Gaussian_Model::_model_spectrum_element(const Fit_Parameters * const fitp,
+                                                      const Param_Handles& h,
+                                                      const Fit_Element_Map * const element_to_fit,
+                                                      const ArrayXr &ev,
+                                                      unordered_map<string, ArrayXr>* labeled_spectras) const
 {
     Spectra spectra_model(ev.size());
 
-    if(false == fitp->contains(element_to_fit->full_name()))
+    int amp_idx = fitp->param_index(element_to_fit->full_name());
+    if(amp_idx < 0)
     {
         return spectra_model;
     }
 
-    real_t pre_faktor = std::pow((real_t)10.0 , fitp->at(element_to_fit->full_name()).value);
+    real_t pre_faktor = std::pow((real_t)10.0 , fitp->value(amp_idx));
 
     if(false == std::isfinite(pre_faktor))
         return spectra_model;
@@ -435,10 +726,10 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
     for (int idx = 0; idx < energy_ratios.size(); idx++)
     {
         const Element_Energy_Ratio& er_struct = energy_ratios.at(idx);
-        real_t sigma = std::sqrt( std::pow((fitp->at(STR_FWHM_OFFSET).value / (real_t)2.3548), (real_t)2.0) + (er_struct.energy) * (real_t)2.96 * fitp->at(STR_FWHM_FANOPRIME).value );
-        real_t f_step =  std::abs( er_struct.mu_fraction * ( fitp->at(STR_F_STEP_OFFSET).value + (fitp->at(STR_F_STEP_LINEAR).value * er_struct.energy)));
-        real_t f_tail = std::abs( fitp->at(STR_F_TAIL_OFFSET).value + (fitp->at(STR_F_TAIL_LINEAR).value * er_struct.mu_fraction));
-        real_t kb_f_tail = std::abs(  fitp->at(STR_KB_F_TAIL_OFFSET).value + (fitp->at(STR_KB_F_TAIL_LINEAR).value * er_struct.mu_fraction));
+        real_t sigma = std::sqrt( std::pow((fitp->value(h.fwhm_offset) / (real_t)2.3548), (real_t)2.0) + (er_struct.energy) * (real_t)2.96 * fitp->value(h.fwhm_fanoprime) );
+        real_t f_step =  std::abs( er_struct.mu_fraction * ( fitp->value(h.f_step_offset) + (fitp->value(h.f_step_linear) * er_struct.energy)));
+        real_t f_tail = std::abs( fitp->value(h.f_tail_offset) + (fitp->value(h.f_tail_linear) * er_struct.mu_fraction));
+        real_t kb_f_tail = std::abs(  fitp->value(h.kb_f_tail_offset) + (fitp->value(h.kb_f_tail_linear) * er_struct.mu_fraction));
         real_t value = 1.0;
 
         //don't process if energy is 0
@@ -447,12 +738,20 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
         if (er_struct.energy <= 0.0)
             continue;
 
+        real_t gamma = std::abs(fitp->value(h.gamma_offset) + fitp->value(h.gamma_linear) * (er_struct.energy)) * element_to_fit->width_multi();
+        bool has_tail = (er_struct.ptype == Element_Param_Type::Kb1_Line || er_struct.ptype == Element_Param_Type::Kb2_Line);
+
+        int start, count;
+        _fluorescence_line_window(ev, er_struct.energy, sigma, f_step > 0.0, has_tail, gamma, start, count);
+        if (count <= 0)
+            continue;
+
         // gaussian peak shape
-		ArrayXr delta_energy = ev - er_struct.energy;
+		ArrayXr delta_energy = ev.segment(start, count) - er_struct.energy;
 
         string label = "";
 
-        real_t incident_energy = fitp->at(STR_COHERENT_SCT_ENERGY).value;
+        real_t incident_energy = fitp->value(h.coherent_sct_energy);
 
         real_t faktor = real_t(er_struct.ratio * pre_faktor);
 		if (element_to_fit->check_binding_energy(incident_energy, idx))
@@ -497,9 +796,9 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
 
         if (labeled_spectras != nullptr && label.length() > 0)
         {
-            Spectra tmp_spec(ev.size());
+            ArrayXr tmp_spec = ArrayXr::Zero(count);
             // peak, gauss
-            tmp_spec += faktor * this->peak(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy);
+            tmp_spec += faktor * this->peak(fitp->value(h.energy_slope), sigma, delta_energy);
             ////spectra_model += faktor * (fitp->at(STR_ENERGY_SLOPE).value / ( sigma * SQRT_2xPI ) *  Eigen::exp((real_t)-0.5 * Eigen::pow((delta_energy / sigma), (real_t)2.0) ) );
 
             //  peak, step
@@ -507,33 +806,32 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
             {
                 value = faktor * f_step;
                 //value = value * this->step(gain, sigma, delta_energy, er_struct.energy);
-                tmp_spec += value * this->step(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy, er_struct.energy);
+                tmp_spec += value * this->step(fitp->value(h.energy_slope), sigma, delta_energy, er_struct.energy);
                 //counts_arr->step = fit_counts.step + value;
             }
             //  peak, tail;; use different tail for K beta vs K alpha lines
-            if (er_struct.ptype == Element_Param_Type::Kb1_Line || er_struct.ptype == Element_Param_Type::Kb2_Line)
+            if (has_tail)
             {
-                real_t gamma = std::abs(fitp->at(STR_GAMMA_OFFSET).value + fitp->at(STR_GAMMA_LINEAR).value * (er_struct.energy)) * element_to_fit->width_multi();
                 value = faktor * kb_f_tail;
-                tmp_spec += value * this->tail(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy, gamma);
+                tmp_spec += value * this->tail(fitp->value(h.energy_slope), sigma, delta_energy, gamma);
                 //fit_counts.tail = fit_counts.tail + value;
             }
 
             if (element_to_fit->pileup_element() != nullptr) // check if it is pileup 
             {
-                (*labeled_spectras)[STR_PILEUP_LINES] += tmp_spec;
+                (*labeled_spectras)[STR_PILEUP_LINES].segment(start, count) += tmp_spec;
             }
             else
             {
-                (*labeled_spectras)[label] += tmp_spec;
+                (*labeled_spectras)[label].segment(start, count) += tmp_spec;
             }
-            spectra_model += tmp_spec;
+            spectra_model.segment(start, count) += tmp_spec;
 
         }
         else
         {
             // peak, gauss
-            spectra_model += faktor * this->peak(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy);
+            spectra_model.segment(start, count) += faktor * this->peak(fitp->value(h.energy_slope), sigma, delta_energy);
             ////spectra_model += faktor * (fitp->at(STR_ENERGY_SLOPE).value / ( sigma * SQRT_2xPI ) *  Eigen::exp((real_t)-0.5 * Eigen::pow((delta_energy / sigma), (real_t)2.0) ) );
 
             //  peak, step
@@ -541,15 +839,14 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
             {
                 value = faktor * f_step;
                 //value = value * this->step(gain, sigma, delta_energy, er_struct.energy);
-                spectra_model += value * this->step(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy, er_struct.energy);
+                spectra_model.segment(start, count) += value * this->step(fitp->value(h.energy_slope), sigma, delta_energy, er_struct.energy);
                 //counts_arr->step = fit_counts.step + value;
             }
             //  peak, tail;; use different tail for K beta vs K alpha lines
-            if (er_struct.ptype == Element_Param_Type::Kb1_Line || er_struct.ptype == Element_Param_Type::Kb2_Line)
+            if (has_tail)
             {
-                real_t gamma = std::abs(fitp->at(STR_GAMMA_OFFSET).value + fitp->at(STR_GAMMA_LINEAR).value * (er_struct.energy)) * element_to_fit->width_multi();
                 value = faktor * kb_f_tail;
-                spectra_model += value * this->tail(fitp->at(STR_ENERGY_SLOPE).value, sigma, delta_energy, gamma);
+                spectra_model.segment(start, count) += value * this->tail(fitp->value(h.energy_slope), sigma, delta_energy, gamma);
                 //fit_counts.tail = fit_counts.tail + value;
             }
         }
@@ -559,24 +856,102 @@ const Spectra Gaussian_Model::model_spectrum_element(const Fit_Parameters * cons
 
 // ----------------------------------------------------------------------------
 
+void Gaussian_Model::_model_spectrum_plan(const Fit_Parameters * const fitp,
+                                          const Param_Handles& h,
+                                          const ArrayXr &ev,
+                                          int element_begin,
+                                          int element_end,
+                                          ArrayXr& counts) const
+{
+    const real_t gain = fitp->value(h.energy_slope);
+    const real_t fwhm_offset = fitp->value(h.fwhm_offset);
+    const real_t fwhm_fanoprime = fitp->value(h.fwhm_fanoprime);
+    const real_t f_step_offset = fitp->value(h.f_step_offset);
+    const real_t f_step_linear = fitp->value(h.f_step_linear);
+    const real_t f_tail_offset = fitp->value(h.f_tail_offset);
+    const real_t f_tail_linear = fitp->value(h.f_tail_linear);
+    const real_t kb_f_tail_offset = fitp->value(h.kb_f_tail_offset);
+    const real_t kb_f_tail_linear = fitp->value(h.kb_f_tail_linear);
+    const real_t gamma_offset = fitp->value(h.gamma_offset);
+    const real_t gamma_linear = fitp->value(h.gamma_linear);
+    const real_t incident_energy = fitp->value(h.coherent_sct_energy);
+
+    for (int e = element_begin; e < element_end; e++)
+    {
+        int amp_idx = _plan_amp_index(_plan, fitp, e);
+        if (amp_idx < 0)
+        {
+            continue;
+        }
+
+        real_t pre_faktor = std::pow((real_t)10.0 , fitp->value(amp_idx));
+        if(false == std::isfinite(pre_faktor))
+        {
+            continue;
+        }
+
+        for (int l = _plan.line_begin[e]; l < _plan.line_begin[e + 1]; l++)
+        {
+            if (false == (_plan.binding_energy[l] < incident_energy))
+            {
+                continue;
+            }
+            const real_t energy = _plan.energy[l];
+            const real_t mu_fraction = _plan.mu_fraction[l];
+            real_t sigma = std::sqrt( std::pow((fwhm_offset / (real_t)2.3548), (real_t)2.0) + energy * (real_t)2.96 * fwhm_fanoprime );
+            real_t f_step = std::abs( mu_fraction * ( f_step_offset + (f_step_linear * energy)));
+            real_t faktor = _plan.ratio[l] * pre_faktor;
+            real_t kb_f_tail = (real_t)0.0;
+            real_t gamma = (real_t)0.0;
+            if (_plan.shape[l] == PLAN_KB)
+            {
+                kb_f_tail = std::abs( kb_f_tail_offset + (kb_f_tail_linear * mu_fraction));
+                gamma = std::abs(gamma_offset + gamma_linear * energy) * _plan.width_multi[e];
+                faktor = faktor / ((real_t)1.0 + kb_f_tail + f_step);
+            }
+            else if (_plan.shape[l] == PLAN_KA_L)
+            {
+                faktor = faktor / ((real_t)1.0 + std::abs( f_tail_offset + (f_tail_linear * mu_fraction)) + f_step);
+            }
+
+            int start, count;
+            _fluorescence_line_window(ev, energy, sigma, f_step > 0.0, _plan.shape[l] == PLAN_KB, gamma, start, count);
+            if (count <= 0)
+            {
+                continue;
+            }
+
+            // peak(), written out so the gaussian is evaluated straight into counts
+            counts.segment(start, count) += (faktor * gain / (sigma * (real_t)(SQRT_2xPI))) * Eigen::exp((real_t)-0.5 * ((ev.segment(start, count) - energy) / sigma).square());
+            if (f_step > 0.0 || _plan.shape[l] == PLAN_KB)
+            {
+                ArrayXr delta_energy = ev.segment(start, count) - energy;
+                if (f_step > 0.0)
+                {
+                    counts.segment(start, count) += (faktor * f_step) * this->step(gain, sigma, delta_energy, energy);
+                }
+                if (_plan.shape[l] == PLAN_KB)
+                {
+                    counts.segment(start, count) += (faktor * kb_f_tail) * this->tail(gain, sigma, delta_energy, gamma);
+                }
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
 const ArrayXr Gaussian_Model::peak(real_t gain, real_t sigma, const ArrayXr& delta_energy) const
 {
     // gain / (sigma * sqrt( 2.0 * M_PI) ) * exp( -0.5 * ( (delta_energy / sigma) ** 2 )
-    return gain / ( sigma * (real_t)(SQRT_2xPI) ) *  Eigen::exp((real_t)-0.5 * Eigen::pow((delta_energy / sigma), (real_t)2.0) );
+    return gain / ( sigma * (real_t)(SQRT_2xPI) ) *  Eigen::exp((real_t)-0.5 * (delta_energy / sigma).square() );
 }
 
 // ----------------------------------------------------------------------------
 
 const ArrayXr Gaussian_Model::step(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t peak_E) const
 {
-    //delta_energy = delta_energy.unaryExpr([sigma](real_t v) { return  (real_t)std::erfc(v  /( M_SQRT2*sigma)); } );
-    //return (gain / (real_t)2.0 / peak_E * delta_energy );
-    ArrayXr counts(delta_energy.size());
-	for (unsigned int i = 0; i < delta_energy.size(); i++)
-	{
-        counts[i] = gain / (real_t)2.0 / peak_E * std::erfc((real_t)delta_energy[i] / ((real_t)(M_SQRT2) * sigma));
-	}
-    return counts;
+    return (gain / (real_t)2.0 / peak_E) * erfc_approx(delta_energy / ((real_t)(M_SQRT2) * sigma));
 
 }
 
@@ -584,32 +959,42 @@ const ArrayXr Gaussian_Model::step(real_t gain, real_t sigma, const ArrayXr& del
 
 const ArrayXr Gaussian_Model::tail(real_t gain, real_t sigma, ArrayXr delta_energy, real_t gamma) const
 {
-    delta_energy = delta_energy.unaryExpr([sigma,gamma](real_t v) { return  (v < (real_t)0.0) ? std::exp(v/ (gamma * sigma)) * std::erfc(v / ((real_t)(M_SQRT2)*sigma) + ((real_t)1.0/(gamma*(real_t)(M_SQRT2)))) : std::erfc(v / ((real_t)(M_SQRT2)*sigma) + ((real_t)1.0/(gamma*(real_t)(M_SQRT2)))); } );
+    // exp(v / (gamma * sigma)) only applies below the peak, min() keeps it branch free: exp(0) = 1 above
+    delta_energy = Eigen::exp(delta_energy.min((real_t)0.0) / (gamma * sigma)) * erfc_approx(delta_energy / ((real_t)(M_SQRT2)*sigma) + ((real_t)1.0/(gamma*(real_t)(M_SQRT2))));
     return( gain / (real_t)2.0 / gamma / sigma / exp((real_t)-0.5/pow(gamma, (real_t)2.0)) * delta_energy);
 }
 
 // ----------------------------------------------------------------------------
 
 const ArrayXr Gaussian_Model::elastic_peak(const Fit_Parameters * const fitp, const ArrayXr& ev, real_t gain) const
+{
+    return _elastic_peak(fitp, _handles(fitp), ev, gain);
+}
+
+// ----------------------------------------------------------------------------
+
+const ArrayXr Gaussian_Model::_elastic_peak(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, real_t gain) const
 {
     Spectra counts(ev.size());
 	counts.setZero();
-    real_t sigma = std::sqrt( std::pow( (fitp->at(STR_FWHM_OFFSET).value / (real_t)2.3548), (real_t)2.0 ) + fitp->at(STR_COHERENT_SCT_ENERGY).value * (real_t)2.96 * fitp->at(STR_FWHM_FANOPRIME).value  );
+    real_t sigma = std::sqrt( std::pow( (fitp->value(h.fwhm_offset) / (real_t)2.3548), (real_t)2.0 ) + fitp->value(h.coherent_sct_energy) * (real_t)2.96 * fitp->value(h.fwhm_fanoprime)  );
     if(false == std::isfinite(sigma))
     {
         return counts;
     }
-	ArrayXr delta_energy = ev - fitp->at(STR_COHERENT_SCT_ENERGY).value;
+    int start, count;
+    _line_window(ev, fitp->value(h.coherent_sct_energy) - _line_window_sigmas * sigma, fitp->value(h.coherent_sct_energy) + _line_window_sigmas * sigma, start, count);
+	ArrayXr delta_energy = ev.segment(start, count) - fitp->value(h.coherent_sct_energy);
 
 
     // elastic peak, gaussian
     real_t fvalue = (real_t)1.0;
 
-    fvalue = fvalue * std::pow((real_t)10.0, fitp->at(STR_COHERENT_SCT_AMPLITUDE).value);
+    fvalue = fvalue * std::pow((real_t)10.0, fitp->value(h.coherent_sct_amplitude));
 
     //Spectra value = fvalue * this->peak(gain, *sigma, delta_energy);
     //counts = counts + value;
-    counts += ( fvalue * this->peak(gain, sigma, delta_energy) );
+    counts.segment(start, count) += ( fvalue * this->peak(gain, sigma, delta_energy) );
     ////counts += fvalue * (gain / ( sigma * (real_t)(SQRT_2xPI) ) * Eigen::exp((real_t)-0.5 * Eigen::pow((delta_energy / sigma), (real_t)2.0) ) );
 
     return counts;
@@ -618,48 +1003,526 @@ const ArrayXr Gaussian_Model::elastic_peak(const Fit_Parameters * const fitp, co
 // ----------------------------------------------------------------------------
 
 const ArrayXr Gaussian_Model::compton_peak(const Fit_Parameters * const fitp, const ArrayXr& ev, real_t  gain) const
+{
+    return _compton_peak(fitp, _handles(fitp), ev, gain);
+}
+
+// ----------------------------------------------------------------------------
+
+const ArrayXr Gaussian_Model::_compton_peak(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, real_t  gain) const
 {
 	ArrayXr counts(ev.size());
 	counts.setZero();
 
-    real_t compton_E = fitp->at(STR_COHERENT_SCT_ENERGY).value/((real_t)1.0 +(fitp->at(STR_COHERENT_SCT_ENERGY).value / (real_t)511.0 ) * ((real_t)1.0 -std::cos( fitp->at(STR_COMPTON_ANGLE).value * (real_t)2.0 * (real_t)(M_PI) / (real_t)360.0 )));
+    real_t compton_E = fitp->value(h.coherent_sct_energy)/((real_t)1.0 +(fitp->value(h.coherent_sct_energy) / (real_t)511.0 ) * ((real_t)1.0 -std::cos( fitp->value(h.compton_angle) * (real_t)2.0 * (real_t)(M_PI) / (real_t)360.0 )));
 
-    real_t sigma = std::sqrt( std::pow( (fitp->at(STR_FWHM_OFFSET).value/(real_t)2.3548), (real_t)62.0) + compton_E * (real_t)2.96 * fitp->at(STR_FWHM_FANOPRIME).value );
+    real_t sigma = std::sqrt( std::pow( (fitp->value(h.fwhm_offset)/(real_t)2.3548), (real_t)62.0) + compton_E * (real_t)2.96 * fitp->value(h.fwhm_fanoprime) );
     if(false == std::isfinite(sigma))
     {
         return counts;
     }
     //real_t local_sigma = (*sigma) * p[14];
 
-	ArrayXr delta_energy = ev - compton_E;
+    // the peak is widened by the fwhm correction, the step is flat below the peak and the tails decay as exp(-|v| / (gamma * sigma)) on either side
+    real_t reach = _line_window_sigmas * std::max(sigma, sigma * std::abs(fitp->value(h.compton_fwhm_corr)));
+    real_t energy_lo = compton_E - reach;
+    real_t energy_hi = compton_E + reach;
+    if (fitp->value(h.compton_f_step) > 0.0)
+    {
+        energy_lo = std::numeric_limits<real_t>::lowest();
+    }
+    else if (fitp->value(h.compton_f_tail) != 0.0)
+    {
+        energy_lo = std::min(energy_lo, compton_E - (real_t)0.5 * _line_window_sigmas * _line_window_sigmas * std::abs(fitp->value(h.compton_gamma)) * sigma);
+    }
+    if (fitp->value(h.compton_hi_f_tail) != 0.0)
+    {
+        energy_hi = std::max(energy_hi, compton_E + (real_t)0.5 * _line_window_sigmas * _line_window_sigmas * std::abs(fitp->value(h.compton_hi_gamma)) * sigma);
+    }
+    int start, count;
+    _line_window(ev, energy_lo, energy_hi, start, count);
+	ArrayXr delta_energy = ev.segment(start, count) - compton_E;
 
     // compton peak, gaussian
-    real_t faktor = (real_t)1.0 / ((real_t)1.0 + fitp->at(STR_COMPTON_F_STEP).value + fitp->at(STR_COMPTON_F_TAIL).value + fitp->at(STR_COMPTON_HI_F_TAIL).value);
+    real_t faktor = (real_t)1.0 / ((real_t)1.0 + fitp->value(h.compton_f_step) + fitp->value(h.compton_f_tail) + fitp->value(h.compton_hi_f_tail));
 
-    faktor = faktor * std::pow((real_t)10.0, fitp->at(STR_COMPTON_AMPLITUDE).value) ;
+    faktor = faktor * std::pow((real_t)10.0, fitp->value(h.compton_amplitude)) ;
 
-    counts += faktor * this->peak(gain, sigma * fitp->at(STR_COMPTON_FWHM_CORR).value, delta_energy);
+    counts.segment(start, count) += faktor * this->peak(gain, sigma * fitp->value(h.compton_fwhm_corr), delta_energy);
     ////counts += faktor * (gain / ( (sigma * fitp->at(STR_COMPTON_FWHM_CORR).value) * (real_t)(SQRT_2xPI) ) *  Eigen::exp((real_t)-0.5 * Eigen::pow((delta_energy / (sigma*fitp->at(STR_COMPTON_FWHM_CORR).value)), (real_t)2.0) ) );
 
     // compton peak, step
-    if ( fitp->at(STR_COMPTON_F_STEP).value > 0.0 )
+    if ( fitp->value(h.compton_f_step) > 0.0 )
     {
-        real_t fvalue = faktor * fitp->at(STR_COMPTON_F_STEP).value;
-		counts += fvalue * this->step(gain, sigma, delta_energy, compton_E);
+        real_t fvalue = faktor * fitp->value(h.compton_f_step);
+		counts.segment(start, count) += fvalue * this->step(gain, sigma, delta_energy, compton_E);
     }
     // compton peak, tail on the low side
-    real_t fvalue = faktor * fitp->at(STR_COMPTON_F_TAIL).value;
-    counts += fvalue * this->tail(gain, sigma, delta_energy, fitp->at(STR_COMPTON_GAMMA).value);
+    real_t fvalue = faktor * fitp->value(h.compton_f_tail);
+    counts.segment(start, count) += fvalue * this->tail(gain, sigma, delta_energy, fitp->value(h.compton_gamma));
 
     // compton peak, tail on the high side
-    fvalue = faktor * fitp->at(STR_COMPTON_HI_F_TAIL).value;
+    fvalue = faktor * fitp->value(h.compton_hi_f_tail);
     delta_energy *= (real_t)-1.0;
-    counts += ( fvalue * this->tail(gain, sigma, delta_energy, fitp->at(STR_COMPTON_HI_GAMMA).value) );
+    counts.segment(start, count) += ( fvalue * this->tail(gain, sigma, delta_energy, fitp->value(h.compton_hi_gamma)) );
     return counts;
 }
 
 // ----------------------------------------------------------------------------
 
+/// add d to rows [start, start + d.size()) of a jacobian column, column -1 is a fixed parameter
+static inline void add_jacobian_column(JacobianXr& jacobian, int column, int start, const ArrayXr& d)
+{
+    if (column > -1)
+    {
+        jacobian.col(column).segment(start, d.size()) += d;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::analytic_jacobian_columns(const Fit_Parameters * const fit_params,
+                                               const Fit_Element_Map_Dict * const elements_to_fit,
+                                               vector<bool>& analytic) const
+{
+    analytic.assign(_num_jacobian_columns(fit_params), false);
+    for (const auto& itr : (*fit_params))
+    {
+        const Fit_Param& param = itr.second;
+        if (param.bound_type <= E_Bound_Type::FIXED || param.opt_array_index < 0 || param.opt_array_index >= (int)analytic.size())
+        {
+            continue;
+        }
+        // the model's own parameters, parameters it does not read have a zero column. the snip width only shapes the background
+        bool model_param = _fit_parameters.contains(itr.first) && itr.first != STR_SNIP_WIDTH;
+        bool amplitude = (elements_to_fit != nullptr && elements_to_fit->count(itr.first) > 0);
+        analytic[param.opt_array_index] = (model_param || amplitude);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::model_jacobian(const Fit_Parameters * const fit_params,
+                                    const Fit_Element_Map_Dict * const elements_to_fit,
+                                    const struct Range energy_range,
+                                    JacobianXr& jacobian)
+{
+    jacobian.setZero(energy_range.count(), _num_jacobian_columns(fit_params));
+    if (jacobian.rows() == 0 || jacobian.cols() == 0)
+    {
+        return;
+    }
+
+    real_t energy_offset = fit_params->value(STR_ENERGY_OFFSET);
+    real_t energy_slope = fit_params->value(STR_ENERGY_SLOPE);
+    real_t energy_quad = fit_params->value(STR_ENERGY_QUADRATIC);
+
+    ArrayXr energy = ArrayXr::LinSpaced(energy_range.count(), energy_range.min, energy_range.max);
+    ArrayXr ev = energy_offset + (energy * energy_slope) + (pow(energy, (real_t)2.0) * energy_quad);
+
+    const Param_Handles h = _handles(fit_params);
+
+    // the same lines model_spectrum_mp evaluates, compile them here if the plan is for other elements
+    Model_Plan local_plan;
+    const Model_Plan* plan = &_plan;
+    if (false == _plan_matches(elements_to_fit))
+    {
+        _compile_model_plan(elements_to_fit, fit_params, local_plan);
+        plan = &local_plan;
+    }
+
+    ArrayXr values = ArrayXr::Zero(ev.size());
+    ArrayXr d_ev = ArrayXr::Zero(ev.size());
+    _fluorescence_jacobian(fit_params, h, *plan, ev, values, d_ev, jacobian);
+    _elastic_jacobian(fit_params, h, ev, values, d_ev, jacobian);
+    _compton_jacobian(fit_params, h, ev, values, d_ev, jacobian);
+
+    // ev = energy_offset + energy_slope * energy + energy_quad * energy^2, and every line also scales with gain = energy_slope
+    add_jacobian_column(jacobian, _jacobian_column(fit_params, fit_params->param_index(STR_ENERGY_OFFSET)), 0, d_ev);
+    add_jacobian_column(jacobian, _jacobian_column(fit_params, h.energy_slope), 0, d_ev * energy + values / energy_slope);
+    add_jacobian_column(jacobian, _jacobian_column(fit_params, fit_params->param_index(STR_ENERGY_QUADRATIC)), 0, d_ev * energy.square());
+
+    // the residuals drop counts that are not finite, drop their derivatives as well
+    jacobian = jacobian.unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
+}
+
+// ----------------------------------------------------------------------------
+
+int Gaussian_Model::_jacobian_column(const Fit_Parameters * const fitp, int param_idx)
+{
+    if (param_idx < 0 || fitp->at(param_idx).bound_type <= E_Bound_Type::FIXED)
+    {
+        return -1;
+    }
+    return fitp->at(param_idx).opt_array_index;
+}
+
+// ----------------------------------------------------------------------------
+
+int Gaussian_Model::_num_jacobian_columns(const Fit_Parameters * const fitp)
+{
+    int columns = 0;
+    for (const auto& itr : (*fitp))
+    {
+        if (itr.second.bound_type > E_Bound_Type::FIXED)
+        {
+            columns = std::max(columns, itr.second.opt_array_index + 1);
+        }
+    }
+    return columns;
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_peak_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma) const
+{
+    value = this->peak(gain, sigma, delta_energy);
+    d_delta = -value * delta_energy / (sigma * sigma);
+    d_sigma = value * (delta_energy.square() / (sigma * sigma * sigma) - (real_t)1.0 / sigma);
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_step_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t peak_E, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma) const
+{
+    value = this->step(gain, sigma, delta_energy, peak_E);
+    // d erfc(x) / dx = -2 / sqrt(pi) * exp(-x^2)
+    d_delta = -(gain / (peak_E * sigma * (real_t)(SQRT_2xPI))) * Eigen::exp((real_t)-0.5 * (delta_energy / sigma).square());
+    d_sigma = -d_delta * delta_energy / sigma;
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_tail_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t gamma, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma, ArrayXr& d_gamma) const
+{
+    // tail = c * exp(min(v, 0) / (gamma * sigma)) * erfc(w), w = v / (sqrt(2) * sigma) + 1 / (sqrt(2) * gamma)
+    const real_t c = gain / (real_t)2.0 / gamma / sigma / std::exp((real_t)-0.5 / (gamma * gamma));
+    const ArrayXr below = delta_energy.min((real_t)0.0);
+    const ArrayXr w = delta_energy / ((real_t)(M_SQRT2) * sigma) + ((real_t)1.0 / (gamma * (real_t)(M_SQRT2)));
+    const ArrayXr x = c * Eigen::exp(below / (gamma * sigma));
+    const ArrayXr r = erfc_approx(w);
+    const ArrayXr d_r = (real_t)(-M_2_SQRTPI) * Eigen::exp(-w.square());
+
+    value = x * r;
+    d_delta = x * ((delta_energy < (real_t)0.0).select(r / (gamma * sigma), (real_t)0.0) + d_r / ((real_t)(M_SQRT2) * sigma));
+    d_sigma = -value / sigma - x * (r * below / (gamma * sigma * sigma) + d_r * delta_energy / ((real_t)(M_SQRT2) * sigma * sigma));
+    d_gamma = -value * ((real_t)1.0 / gamma + (real_t)1.0 / (gamma * gamma * gamma))
+              - x * (r * below / (gamma * gamma * sigma) + d_r / ((real_t)(M_SQRT2) * gamma * gamma));
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_fluorescence_jacobian(const Fit_Parameters * const fitp,
+                                            const Param_Handles& h,
+                                            const Model_Plan& plan,
+                                            const ArrayXr& ev,
+                                            ArrayXr& values,
+                                            ArrayXr& d_ev,
+                                            JacobianXr& jacobian) const
+{
+    const real_t gain = fitp->value(h.energy_slope);
+    const real_t fwhm_offset = fitp->value(h.fwhm_offset);
+    const real_t fwhm_fanoprime = fitp->value(h.fwhm_fanoprime);
+    const real_t f_step_offset = fitp->value(h.f_step_offset);
+    const real_t f_step_linear = fitp->value(h.f_step_linear);
+    const real_t f_tail_offset = fitp->value(h.f_tail_offset);
+    const real_t f_tail_linear = fitp->value(h.f_tail_linear);
+    const real_t kb_f_tail_offset = fitp->value(h.kb_f_tail_offset);
+    const real_t kb_f_tail_linear = fitp->value(h.kb_f_tail_linear);
+    const real_t gamma_offset = fitp->value(h.gamma_offset);
+    const real_t gamma_linear = fitp->value(h.gamma_linear);
+    const real_t incident_energy = fitp->value(h.coherent_sct_energy);
+
+    const int c_fwhm_offset = _jacobian_column(fitp, h.fwhm_offset);
+    const int c_fwhm_fanoprime = _jacobian_column(fitp, h.fwhm_fanoprime);
+    const int c_f_step_offset = _jacobian_column(fitp, h.f_step_offset);
+    const int c_f_step_linear = _jacobian_column(fitp, h.f_step_linear);
+    const int c_f_tail_offset = _jacobian_column(fitp, h.f_tail_offset);
+    const int c_f_tail_linear = _jacobian_column(fitp, h.f_tail_linear);
+    const int c_kb_f_tail_offset = _jacobian_column(fitp, h.kb_f_tail_offset);
+    const int c_kb_f_tail_linear = _jacobian_column(fitp, h.kb_f_tail_linear);
+    const int c_gamma_offset = _jacobian_column(fitp, h.gamma_offset);
+    const int c_gamma_linear = _jacobian_column(fitp, h.gamma_linear);
+    const bool step_free = (c_f_step_offset > -1 || c_f_step_linear > -1);
+
+    for (int e = 0; e < (int)plan.amp_name.size(); e++)
+    {
+        int amp_idx = _plan_amp_index(plan, fitp, e);
+        if (amp_idx < 0)
+        {
+            continue;
+        }
+        real_t pre_faktor = std::pow((real_t)10.0 , fitp->value(amp_idx));
+        if(false == std::isfinite(pre_faktor))
+        {
+            continue;
+        }
+        const int c_amplitude = _jacobian_column(fitp, amp_idx);
+
+        for (int l = plan.line_begin[e]; l < plan.line_begin[e + 1]; l++)
+        {
+            if (false == (plan.binding_energy[l] < incident_energy))
+            {
+                continue;
+            }
+            const real_t energy = plan.energy[l];
+            const real_t mu_fraction = plan.mu_fraction[l];
+            const int shape = plan.shape[l];
+            real_t sigma = std::sqrt( std::pow((fwhm_offset / (real_t)2.3548), (real_t)2.0) + energy * (real_t)2.96 * fwhm_fanoprime );
+
+            // |x| has no derivative at 0, take the side a forward difference sees
+            real_t step_arg = mu_fraction * ( f_step_offset + (f_step_linear * energy));
+            real_t f_step = std::abs(step_arg);
+            real_t step_sign = (step_arg < (real_t)0.0) ? (real_t)-1.0 : (real_t)1.0;
+            real_t tail_arg = (real_t)0.0;
+            real_t gamma_arg = (real_t)0.0;
+            real_t gamma = (real_t)0.0;
+            if (shape == PLAN_KB)
+            {
+                tail_arg = kb_f_tail_offset + (kb_f_tail_linear * mu_fraction);
+                gamma_arg = gamma_offset + gamma_linear * energy;
+                gamma = std::abs(gamma_arg) * plan.width_multi[e];
+            }
+            else if (shape == PLAN_KA_L)
+            {
+                tail_arg = f_tail_offset + (f_tail_linear * mu_fraction);
+            }
+            real_t f_tail = std::abs(tail_arg);
+            real_t tail_sign = (tail_arg < (real_t)0.0) ? (real_t)-1.0 : (real_t)1.0;
+            real_t gamma_sign = (gamma_arg < (real_t)0.0) ? (real_t)-1.0 : (real_t)1.0;
+            real_t denom = (shape == PLAN_PLAIN) ? (real_t)1.0 : ((real_t)1.0 + f_tail + f_step);
+            real_t faktor = plan.ratio[l] * pre_faktor / denom;
+
+            // a free step needs its derivative while it is still 0
+            bool with_step = (f_step > 0.0 || (step_free && mu_fraction != 0.0));
+            int start, count;
+            _fluorescence_line_window(ev, energy, sigma, with_step, shape == PLAN_KB, gamma, start, count);
+            if (count <= 0)
+            {
+                continue;
+            }
+            ArrayXr delta_energy = ev.segment(start, count) - energy;
+
+            ArrayXr line_value, line_d_delta, line_d_sigma;
+            _peak_partials(gain, sigma, delta_energy, line_value, line_d_delta, line_d_sigma);
+            ArrayXr step_value, step_d_delta, step_d_sigma;
+            if (with_step)
+            {
+                _step_partials(gain, sigma, delta_energy, energy, step_value, step_d_delta, step_d_sigma);
+                line_value += f_step * step_value;
+                line_d_delta += f_step * step_d_delta;
+                line_d_sigma += f_step * step_d_sigma;
+            }
+            ArrayXr tail_value, tail_d_delta, tail_d_sigma, tail_d_gamma;
+            if (shape == PLAN_KB)
+            {
+                _tail_partials(gain, sigma, delta_energy, gamma, tail_value, tail_d_delta, tail_d_sigma, tail_d_gamma);
+                line_value += f_tail * tail_value;
+                line_d_delta += f_tail * tail_d_delta;
+                line_d_sigma += f_tail * tail_d_sigma;
+            }
+
+            const ArrayXr counts = faktor * line_value;
+            values.segment(start, count) += counts;
+            d_ev.segment(start, count) += faktor * line_d_delta;
+            add_jacobian_column(jacobian, c_amplitude, start, (real_t)(M_LN10) * counts);
+
+            // sigma^2 = (fwhm_offset / 2.3548)^2 + energy * 2.96 * fwhm_fanoprime
+            const ArrayXr d_sigma = faktor * line_d_sigma;
+            add_jacobian_column(jacobian, c_fwhm_offset, start, d_sigma * (fwhm_offset / ((real_t)2.3548 * (real_t)2.3548 * sigma)));
+            add_jacobian_column(jacobian, c_fwhm_fanoprime, start, d_sigma * (energy * (real_t)2.96 / ((real_t)2.0 * sigma)));
+
+            // f_step and f_tail also scale the line down through denom
+            const ArrayXr d_denom = (shape == PLAN_PLAIN) ? ArrayXr(ArrayXr::Zero(count)) : ArrayXr(-counts / denom);
+            if (with_step)
+            {
+                const ArrayXr d_f_step = faktor * step_value + d_denom;
+                add_jacobian_column(jacobian, c_f_step_offset, start, d_f_step * (step_sign * mu_fraction));
+                add_jacobian_column(jacobian, c_f_step_linear, start, d_f_step * (step_sign * mu_fraction * energy));
+            }
+            if (shape == PLAN_KB)
+            {
+                const ArrayXr d_f_tail = faktor * tail_value + d_denom;
+                add_jacobian_column(jacobian, c_kb_f_tail_offset, start, d_f_tail * tail_sign);
+                add_jacobian_column(jacobian, c_kb_f_tail_linear, start, d_f_tail * (tail_sign * mu_fraction));
+                const ArrayXr d_gamma = (faktor * f_tail) * tail_d_gamma;
+                add_jacobian_column(jacobian, c_gamma_offset, start, d_gamma * (gamma_sign * plan.width_multi[e]));
+                add_jacobian_column(jacobian, c_gamma_linear, start, d_gamma * (gamma_sign * plan.width_multi[e] * energy));
+            }
+            else if (shape == PLAN_KA_L)
+            {
+                add_jacobian_column(jacobian, c_f_tail_offset, start, d_denom * tail_sign);
+                add_jacobian_column(jacobian, c_f_tail_linear, start, d_denom * (tail_sign * mu_fraction));
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_elastic_jacobian(const Fit_Parameters * const fitp,
+                                       const Param_Handles& h,
+                                       const ArrayXr& ev,
+                                       ArrayXr& values,
+                                       ArrayXr& d_ev,
+                                       JacobianXr& jacobian) const
+{
+    const real_t gain = fitp->value(h.energy_slope);
+    const real_t fwhm_offset = fitp->value(h.fwhm_offset);
+    const real_t fwhm_fanoprime = fitp->value(h.fwhm_fanoprime);
+    const real_t energy = fitp->value(h.coherent_sct_energy);
+    real_t sigma = std::sqrt( std::pow( (fwhm_offset / (real_t)2.3548), (real_t)2.0 ) + energy * (real_t)2.96 * fwhm_fanoprime );
+    if(false == std::isfinite(sigma))
+    {
+        return;
+    }
+    int start, count;
+    _line_window(ev, energy - _line_window_sigmas * sigma, energy + _line_window_sigmas * sigma, start, count);
+    if (count <= 0)
+    {
+        return;
+    }
+    ArrayXr delta_energy = ev.segment(start, count) - energy;
+    real_t faktor = std::pow((real_t)10.0, fitp->value(h.coherent_sct_amplitude));
+
+    ArrayXr peak_value, peak_d_delta, peak_d_sigma;
+    _peak_partials(gain, sigma, delta_energy, peak_value, peak_d_delta, peak_d_sigma);
+
+    const ArrayXr counts = faktor * peak_value;
+    const ArrayXr d_delta = faktor * peak_d_delta;
+    const ArrayXr d_sigma = faktor * peak_d_sigma;
+    values.segment(start, count) += counts;
+    d_ev.segment(start, count) += d_delta;
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.coherent_sct_amplitude), start, (real_t)(M_LN10) * counts);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.fwhm_offset), start, d_sigma * (fwhm_offset / ((real_t)2.3548 * (real_t)2.3548 * sigma)));
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.fwhm_fanoprime), start, d_sigma * (energy * (real_t)2.96 / ((real_t)2.0 * sigma)));
+    // the incident energy moves the peak and widens it
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.coherent_sct_energy), start, d_sigma * ((real_t)2.96 * fwhm_fanoprime / ((real_t)2.0 * sigma)) - d_delta);
+}
+
+// ----------------------------------------------------------------------------
+
+void Gaussian_Model::_compton_jacobian(const Fit_Parameters * const fitp,
+                                       const Param_Handles& h,
+                                       const ArrayXr& ev,
+                                       ArrayXr& values,
+                                       ArrayXr& d_ev,
+                                       JacobianXr& jacobian) const
+{
+    const real_t gain = fitp->value(h.energy_slope);
+    const real_t fwhm_offset = fitp->value(h.fwhm_offset);
+    const real_t fwhm_fanoprime = fitp->value(h.fwhm_fanoprime);
+    const real_t incident_energy = fitp->value(h.coherent_sct_energy);
+    const real_t angle = fitp->value(h.compton_angle) * (real_t)2.0 * (real_t)(M_PI) / (real_t)360.0;
+    const real_t fwhm_corr = fitp->value(h.compton_fwhm_corr);
+    const real_t f_step = fitp->value(h.compton_f_step);
+    const real_t f_tail = fitp->value(h.compton_f_tail);
+    const real_t hi_f_tail = fitp->value(h.compton_hi_f_tail);
+    const real_t gamma = fitp->value(h.compton_gamma);
+    const real_t hi_gamma = fitp->value(h.compton_hi_gamma);
+
+    const int c_f_step = _jacobian_column(fitp, h.compton_f_step);
+    const int c_f_tail = _jacobian_column(fitp, h.compton_f_tail);
+    const int c_hi_f_tail = _jacobian_column(fitp, h.compton_hi_f_tail);
+
+    real_t compton_E = incident_energy / ((real_t)1.0 + (incident_energy / (real_t)511.0) * ((real_t)1.0 - std::cos(angle)));
+    real_t d_compton_E_d_incident = (compton_E * compton_E) / (incident_energy * incident_energy);
+    real_t d_compton_E_d_angle = -(compton_E * compton_E) / (real_t)511.0 * std::sin(angle) * (real_t)2.0 * (real_t)(M_PI) / (real_t)360.0;
+
+    real_t sigma = std::sqrt( std::pow( (fwhm_offset / (real_t)2.3548), (real_t)62.0) + compton_E * (real_t)2.96 * fwhm_fanoprime );
+    if(false == std::isfinite(sigma))
+    {
+        return;
+    }
+    real_t d_sigma_d_offset = (real_t)62.0 * std::pow( (fwhm_offset / (real_t)2.3548), (real_t)61.0) / ((real_t)2.3548 * (real_t)2.0 * sigma);
+    real_t d_sigma_d_fanoprime = compton_E * (real_t)2.96 / ((real_t)2.0 * sigma);
+    real_t d_sigma_d_compton_E = (real_t)2.96 * fwhm_fanoprime / ((real_t)2.0 * sigma);
+
+    // _compton_peak() window, also widened for the step and tails that are free but still 0
+    bool with_step = (f_step > 0.0 || (c_f_step > -1 && f_step == 0.0));
+    real_t reach = _line_window_sigmas * std::max(sigma, sigma * std::abs(fwhm_corr));
+    real_t energy_lo = compton_E - reach;
+    real_t energy_hi = compton_E + reach;
+    if (with_step)
+    {
+        energy_lo = std::numeric_limits<real_t>::lowest();
+    }
+    else if (f_tail != 0.0 || c_f_tail > -1)
+    {
+        energy_lo = std::min(energy_lo, compton_E - (real_t)0.5 * _line_window_sigmas * _line_window_sigmas * std::abs(gamma) * sigma);
+    }
+    if (hi_f_tail != 0.0 || c_hi_f_tail > -1)
+    {
+        energy_hi = std::max(energy_hi, compton_E + (real_t)0.5 * _line_window_sigmas * _line_window_sigmas * std::abs(hi_gamma) * sigma);
+    }
+    int start, count;
+    _line_window(ev, energy_lo, energy_hi, start, count);
+    if (count <= 0)
+    {
+        return;
+    }
+    ArrayXr delta_energy = ev.segment(start, count) - compton_E;
+
+    real_t denom = (real_t)1.0 + f_step + f_tail + hi_f_tail;
+    real_t faktor = std::pow((real_t)10.0, fitp->value(h.compton_amplitude)) / denom;
+
+    // the peak is widened by fwhm_corr, the high side tail is mirrored
+    ArrayXr shape_value, shape_d_delta, peak_d_sigma;
+    _peak_partials(gain, sigma * fwhm_corr, delta_energy, shape_value, shape_d_delta, peak_d_sigma);
+    ArrayXr shape_d_sigma = peak_d_sigma * fwhm_corr;
+    ArrayXr shape_d_compton_E = ArrayXr::Zero(count);
+    ArrayXr step_value, step_d_delta, step_d_sigma;
+    if (with_step)
+    {
+        _step_partials(gain, sigma, delta_energy, compton_E, step_value, step_d_delta, step_d_sigma);
+        if (f_step > 0.0)
+        {
+            shape_value += f_step * step_value;
+            shape_d_delta += f_step * step_d_delta;
+            shape_d_sigma += f_step * step_d_sigma;
+            shape_d_compton_E -= f_step * step_value / compton_E;
+        }
+    }
+    ArrayXr tail_value, tail_d_delta, tail_d_sigma, tail_d_gamma;
+    _tail_partials(gain, sigma, delta_energy, gamma, tail_value, tail_d_delta, tail_d_sigma, tail_d_gamma);
+    shape_value += f_tail * tail_value;
+    shape_d_delta += f_tail * tail_d_delta;
+    shape_d_sigma += f_tail * tail_d_sigma;
+    ArrayXr hi_tail_value, hi_tail_d_delta, hi_tail_d_sigma, hi_tail_d_gamma;
+    _tail_partials(gain, sigma, -delta_energy, hi_gamma, hi_tail_value, hi_tail_d_delta, hi_tail_d_sigma, hi_tail_d_gamma);
+    shape_value += hi_f_tail * hi_tail_value;
+    shape_d_delta -= hi_f_tail * hi_tail_d_delta;
+    shape_d_sigma += hi_f_tail * hi_tail_d_sigma;
+
+    const ArrayXr counts = faktor * shape_value;
+    const ArrayXr d_delta = faktor * shape_d_delta;
+    const ArrayXr d_sigma = faktor * shape_d_sigma;
+    values.segment(start, count) += counts;
+    d_ev.segment(start, count) += d_delta;
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.compton_amplitude), start, (real_t)(M_LN10) * counts);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.fwhm_offset), start, d_sigma * d_sigma_d_offset);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.fwhm_fanoprime), start, d_sigma * d_sigma_d_fanoprime);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.compton_fwhm_corr), start, (faktor * sigma) * peak_d_sigma);
+
+    // the compton energy moves with the incident energy and the angle
+    const ArrayXr d_compton_E = d_sigma * d_sigma_d_compton_E - d_delta + faktor * shape_d_compton_E;
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.coherent_sct_energy), start, d_compton_E * d_compton_E_d_incident);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.compton_angle), start, d_compton_E * d_compton_E_d_angle);
+
+    // the step and tail fractions also scale the peak down through denom
+    const ArrayXr d_denom = -counts / denom;
+    if (c_f_step > -1)
+    {
+        add_jacobian_column(jacobian, c_f_step, start, with_step ? ArrayXr(faktor * step_value + d_denom) : d_denom);
+    }
+    add_jacobian_column(jacobian, c_f_tail, start, faktor * tail_value + d_denom);
+    add_jacobian_column(jacobian, c_hi_f_tail, start, faktor * hi_tail_value + d_denom);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.compton_gamma), start, (faktor * f_tail) * tail_d_gamma);
+    add_jacobian_column(jacobian, _jacobian_column(fitp, h.compton_hi_gamma), start, (faktor * hi_f_tail) * hi_tail_d_gamma);
+}
+
+// ----------------------------------------------------------------------------
+
 const ArrayXr Gaussian_Model::escape_peak(const Fit_Parameters* const fitp, const ArrayXr& ev, real_t  gain) const
 {
     ArrayXr counts(ev.size());
@@ -54,6 +54,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "fitting/optimizers/optimizer.h"
 #include "data_struct/fit_parameters.h"
 
+/// lines are evaluated within +-8 sigma, the truncated fraction exp(-32) is below real_t resolution
+#define DEFAULT_LINE_WINDOW_SIGMAS 8.0
+
 namespace fitting
 {
 namespace models
@@ -62,6 +65,9 @@ namespace models
 	using namespace data_struct;
 	using namespace fitting::optimizers;
 
+/// OPENMP splits model_spectrum_mp over the elements, SINGLE keeps it on the calling thread for models evaluated from pool workers
+enum class Model_Threading { OPENMP, SINGLE };
+
 class DLL_EXPORT Gaussian_Model: public Base_Model
 {
 public:
@@ -87,6 +93,17 @@ public:
                                                  const ArrayXr &ev,
                                                  unordered_map<string, ArrayXr>* labeled_spectras);
 
+    virtual void compile_model_plan(const Fit_Element_Map_Dict * const elements_to_fit, const Fit_Parameters * const fit_params);
+
+    virtual void analytic_jacobian_columns(const Fit_Parameters * const fit_params,
+                                           const Fit_Element_Map_Dict * const elements_to_fit,
+                                           vector<bool>& analytic) const;
+
+    virtual void model_jacobian(const Fit_Parameters * const fit_params,
+                                const Fit_Element_Map_Dict * const elements_to_fit,
+                                const struct Range energy_range,
+                                JacobianXr& jacobian);
+
     void set_fit_params_preset(Fit_Params_Preset lock_macro);
 
     /**
@@ -124,12 +141,153 @@ public:
 
     void update_and_add_fit_params_values_gt_zero(Fit_Parameters *fit_params) { _fit_parameters.update_and_add_values_gt_zero(fit_params); }
 
+    /// evaluate every line only on the channels within +-n_sigma of its energy, widened to cover its step and tail. 0 evaluates the whole fit range
+    void set_line_window(real_t n_sigma) { _line_window_sigmas = n_sigma; }
+
+    real_t line_window() const { return _line_window_sigmas; }
+
+    /// upper bound on the fraction of a line's peak, step or tail dropped by a +-n_sigma window
+    static real_t line_window_error(real_t n_sigma);
+
+    void set_threading(Model_Threading threading) { _threading = threading; }
+
+    Model_Threading threading() const { return _threading; }
+
 protected:
 
+    /// indices of the parameters read for every line, resolved once per parameter layout when the plan is compiled
+    struct Param_Handles
+    {
+        int energy_slope;
+        int fwhm_offset;
+        int fwhm_fanoprime;
+        int f_step_offset;
+        int f_step_linear;
+        int f_tail_offset;
+        int f_tail_linear;
+        int kb_f_tail_offset;
+        int kb_f_tail_linear;
+        int gamma_offset;
+        int gamma_linear;
+        int coherent_sct_energy;
+        int coherent_sct_amplitude;
+        int compton_angle;
+        int compton_fwhm_corr;
+        int compton_f_step;
+        int compton_f_tail;
+        int compton_hi_f_tail;
+        int compton_gamma;
+        int compton_hi_gamma;
+        int compton_amplitude;
+    };
+
+    Param_Handles _resolve_handles(const Fit_Parameters * const fitp) const;
+
+    /// the plan's handles if fitp has the layout the plan was compiled with, resolved by name otherwise
+    Param_Handles _handles(const Fit_Parameters * const fitp) const;
+
+    /// how a line's factor is normalized and whether it has a tail
+    enum Plan_Line_Shape { PLAN_PLAIN, PLAN_KA_L, PLAN_KB };
+
+    /**
+     * @brief The Model_Plan struct : every active line of the fitted elements as flat arrays, lines of element e are [line_begin[e], line_begin[e + 1])
+     */
+    struct Model_Plan
+    {
+        Model_Plan() : elements(nullptr), num_elements(0), elements_stamp(0), has_handles(false), params_layout(0), params_size(0) {}
+
+        /// dict the plan was compiled from and its element_dict_stamp(), evaluation falls back to the elements for any other or once it changed
+        const Fit_Element_Map_Dict* elements;
+        size_t num_elements;
+        size_t elements_stamp;
+
+        /// parameter indices for fit parameters with layout_hash() params_layout and size() params_size
+        Param_Handles handles;
+        bool has_handles;
+        size_t params_layout;
+        size_t params_size;
+
+        // per element
+        std::vector<std::string> amp_name;
+        std::vector<int> amp_index;
+        std::vector<real_t> width_multi;
+        std::vector<int> line_begin;
+
+        // per line
+        std::vector<real_t> energy;
+        std::vector<real_t> ratio;
+        std::vector<real_t> mu_fraction;
+        std::vector<real_t> binding_energy;
+        std::vector<int> shape;
+    };
+
+    void _compile_model_plan(const Fit_Element_Map_Dict * const elements_to_fit, const Fit_Parameters * const fit_params, Model_Plan& plan) const;
+
+    /// true if _plan was compiled from elements_to_fit as it is now
+    bool _plan_matches(const Fit_Element_Map_Dict * const elements_to_fit) const;
+
+    /// index of the amplitude of plan element e, -1 if fitp does not have it
+    int _plan_amp_index(const Model_Plan& plan, const Fit_Parameters * const fitp, int e) const;
+
+    /// add the lines of plan elements [element_begin, element_end) into counts
+    void _model_spectrum_plan(const Fit_Parameters * const fitp,
+                              const Param_Handles& h,
+                              const ArrayXr &ev,
+                              int element_begin,
+                              int element_end,
+                              ArrayXr& counts) const;
+
+    const Spectra _model_spectrum_element(const Fit_Parameters * const fitp,
+                                          const Param_Handles& h,
+                                          const Fit_Element_Map * const element_to_fit,
+                                          const ArrayXr &ev,
+                                          unordered_map<string, ArrayXr>* labeled_spectras) const;
+
+    const ArrayXr _elastic_peak(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, real_t gain) const;
+
+    const ArrayXr _compton_peak(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, real_t gain) const;
+
+    /// true when model_spectrum_mp should split num_elements over an OpenMP team
+    bool _use_openmp(int num_elements) const;
+
+    /// channels [start, start + count) of ev within [energy_lo, energy_hi], the whole range if windowing is off or ev is not increasing
+    void _line_window(const ArrayXr& ev, real_t energy_lo, real_t energy_hi, int& start, int& count) const;
+
+    /// _line_window() of a fluorescence line at energy, widened for its step and its tail of slope gamma
+    void _fluorescence_line_window(const ArrayXr& ev, real_t energy, real_t sigma, bool has_step, bool has_tail, real_t gamma, int& start, int& count) const;
+
+    /// opt_array_index of the parameter at param_idx, -1 if it is fixed
+    static int _jacobian_column(const Fit_Parameters * const fitp, int param_idx);
+
+    /// number of columns of the jacobian, the free parameters after to_array()
+    static int _num_jacobian_columns(const Fit_Parameters * const fitp);
+
+    /// peak() and its derivatives by delta_energy and sigma
+    void _peak_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma) const;
+
+    /// step() and its derivatives by delta_energy and sigma, the derivative by peak_E is -value / peak_E
+    void _step_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t peak_E, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma) const;
+
+    /// tail() and its derivatives by delta_energy, sigma and gamma
+    void _tail_partials(real_t gain, real_t sigma, const ArrayXr& delta_energy, real_t gamma, ArrayXr& value, ArrayXr& d_delta, ArrayXr& d_sigma, ArrayXr& d_gamma) const;
+
+    /// jacobian columns of the plan lines, their counts go to values and their derivative by ev to d_ev
+    void _fluorescence_jacobian(const Fit_Parameters * const fitp, const Param_Handles& h, const Model_Plan& plan, const ArrayXr& ev, ArrayXr& values, ArrayXr& d_ev, JacobianXr& jacobian) const;
+
+    void _elastic_jacobian(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, ArrayXr& values, ArrayXr& d_ev, JacobianXr& jacobian) const;
+
+    void _compton_jacobian(const Fit_Parameters * const fitp, const Param_Handles& h, const ArrayXr& ev, ArrayXr& values, ArrayXr& d_ev, JacobianXr& jacobian) const;
+
     Fit_Parameters _generate_default_fit_parameters();
 
     Fit_Parameters _fit_parameters;
 
+    real_t _line_window_sigmas;
+
+    Model_Threading _threading;
+
+    Model_Plan _plan;
+
 };
 
 DLL_EXPORT ArrayXr generate_ev_array(Range energy_range, Fit_Parameters& fit_params);
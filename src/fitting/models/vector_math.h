@@ -0,0 +1,88 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+
+
+#ifndef Vector_Math_H
+#define Vector_Math_H
+
+#include "core/defines.h"
+#include "data_struct/spectra.h"
+
+namespace fitting
+{
+namespace models
+{
+
+using namespace data_struct;
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief erfc_approx : erfc(x) for a whole array, written as one Eigen expression so Eigen vectorizes it
+ *  (exp included) with whatever the build enables (SSE / AVX2 / AVX-512, see the AVX options in CMakeLists.txt)
+ *  and falls back to scalar code otherwise. Chebyshev fit from Numerical Recipes (erfcc), relative error
+ *  below 1.2e-7 in exact arithmetic. In float the rounding of -x*x adds about x*x*FLT_EPSILON of relative error:
+ *  absolute error stays below 5e-7 and relative error below 1e-5 for |x| < 10
+ *  (checked by test/erfc_approx).
+ */
+inline ArrayXr erfc_approx(const ArrayXr& x)
+{
+    const ArrayXr t = (real_t)1.0 / ((real_t)1.0 + (real_t)0.5 * x.abs());
+    const ArrayXr ans = t * Eigen::exp(-x.square() - (real_t)1.26551223 + t * ((real_t)1.00002368 + t * ((real_t)0.37409196 + t * ((real_t)0.09678418
+                        + t * ((real_t)-0.18628806 + t * ((real_t)0.27886807 + t * ((real_t)-1.13520398 + t * ((real_t)1.48851587
+                        + t * ((real_t)-0.82215223 + t * (real_t)0.17087277)))))))));
+    return (x >= (real_t)0.0).select(ans, (real_t)2.0 - ans);
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace models
+
+} //namespace fitting
+
+#endif // Vector_Math_H
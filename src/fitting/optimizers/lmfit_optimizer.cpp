@@ -60,7 +60,7 @@ namespace optimizers
 {
 
 
-void residuals_lmfit( const real_t *par, int m_dat, const void *data, real_t *fvec, int *userbreak )
+void residuals_lmfit( const compute_t *par, int m_dat, const void *data, compute_t *fvec, int *userbreak )
 {
     User_Data* ud = (User_Data*)(data);
 
@@ -76,7 +76,7 @@ void residuals_lmfit( const real_t *par, int m_dat, const void *data, real_t *fv
     // Calculate residuals
     for (int i = 0; i < m_dat; i++ )
     {
-		fvec[i] = (ud->spectra[i] - ud->spectra_model[i]) * ud->weights[i];
+		fvec[i] = ((compute_t)ud->spectra[i] - (compute_t)ud->spectra_model[i]) * (compute_t)ud->weights[i];
     }
     ud->cur_itr++;
     if (ud->status_callback != nullptr)
@@ -85,8 +85,30 @@ void residuals_lmfit( const real_t *par, int m_dat, const void *data, real_t *fv
     }
 }
 
+//-----------------------------------------------------------------------------
 
-void general_residuals_lmfit( const real_t *par, int m_dat, const void *data, real_t *fvec, int *userbreak )
+void jacobian_lmfit( const compute_t *par, int m_dat, const void *data, compute_t *fjac, int *analytic, int *userbreak )
+{
+    User_Data* ud = (User_Data*)(data);
+
+    ud->fit_parameters->from_array(par, m_dat);
+    ud->fit_model->model_jacobian(ud->fit_parameters, ud->elements, ud->energy_range, ud->jacobian);
+    // d fvec / d param = -weights * d model / d param, column j at fjac[j * m_dat]
+    for (int j = 0; j < (int)ud->analytic_columns.size() && j < (int)ud->jacobian.cols(); j++)
+    {
+        if (ud->analytic_columns[j])
+        {
+            for (int i = 0; i < m_dat; i++)
+            {
+                fjac[j * m_dat + i] = -(compute_t)ud->jacobian(i, j) * (compute_t)ud->weights[i];
+            }
+            analytic[j] = 1;
+        }
+    }
+}
+
+
+void general_residuals_lmfit( const compute_t *par, int m_dat, const void *data, compute_t *fvec, int *userbreak )
 {
 
     Gen_User_Data* ud = (Gen_User_Data*)(data);
@@ -102,7 +124,7 @@ void general_residuals_lmfit( const real_t *par, int m_dat, const void *data, re
     // Calculate residuals
     for (int i = 0; i < m_dat; i++ )
     {
-        fvec[i] = ( ud->spectra[i] - ud->spectra_model[i] ) * ud->weights[i];
+        fvec[i] = ( (compute_t)ud->spectra[i] - (compute_t)ud->spectra_model[i] ) * (compute_t)ud->weights[i];
     }
 
 }
@@ -110,7 +132,7 @@ void general_residuals_lmfit( const real_t *par, int m_dat, const void *data, re
 
 //-----------------------------------------------------------------------------
 
-void quantification_residuals_lmfit( const real_t *par, int m_dat, const void *data, real_t *fvec, int *userbreak )
+void quantification_residuals_lmfit( const compute_t *par, int m_dat, const void *data, compute_t *fvec, int *userbreak )
 {
     ///(std::valarray<real_t> p, std::valarray<real_t> y, std::valarray<real_t> x)
 
@@ -134,7 +156,7 @@ void quantification_residuals_lmfit( const real_t *par, int m_dat, const void *d
         fvec[idx] = itr.second.e_cal_ratio - result_map[itr.first];
         if (std::isfinite(fvec[idx]) == false)
         {
-            fvec[idx] = std::numeric_limits<real_t>::max();
+            fvec[idx] = std::numeric_limits<compute_t>::max();
         }
         idx++;
     }
@@ -235,13 +257,13 @@ OPTIMIZER_OUTCOME LMFit_Optimizer::minimize(Fit_Parameters *fit_params,
 {
 
     User_Data ud;
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
 
     size_t total_itr = _options.patience * (fitp_arr.size() + 1);
     fill_user_data(ud, fit_params, spectra, elements_to_fit, model, energy_range, status_callback, total_itr);
 
-    lm_status_struct<real_t> status;
+    lm_status_struct<compute_t> status;
 
 //    control.ftol = 1.0e-10;
 //    /* Relative error desired in the sum of squares.
@@ -284,7 +306,19 @@ OPTIMIZER_OUTCOME LMFit_Optimizer::minimize(Fit_Parameters *fit_params,
     //control.verbosity = 3;
 
     /* perform the fit */
-    lmmin( fitp_arr.size(), &fitp_arr[0], energy_range.count(), (const void*) &ud, residuals_lmfit, &_options, &status );
+    if (_jacobian_mode == Jacobian_Mode::ANALYTIC)
+    {
+        fill_analytic_columns(ud);
+        lmmin( fitp_arr.size(), &fitp_arr[0], energy_range.count(), (const void*) &ud, residuals_lmfit, &_options, &status, jacobian_lmfit );
+    }
+    else
+    {
+        if (_jacobian_mode == Jacobian_Mode::CHECK)
+        {
+            check_analytic_jacobian(ud);
+        }
+        lmmin( fitp_arr.size(), &fitp_arr[0], energy_range.count(), (const void*) &ud, residuals_lmfit, &_options, &status );
+    }
     logI<< "Status after "<<status.nfev<<" function evaluations:\n  "<<lm_infmsg[status.outcome]<<"\r\n";
 
     fit_params->from_array(fitp_arr);
@@ -316,19 +350,42 @@ OPTIMIZER_OUTCOME LMFit_Optimizer::minimize_func(Fit_Parameters *fit_params,
                                                 const Spectra * const spectra,
                                                 const Range energy_range,
                                                 const ArrayXr *background,
-                                                Gen_Func_Def gen_func)
+                                                Gen_Func_Def gen_func,
+                                                const Optimizer_Options* options)
 {
 
     Gen_User_Data ud;
 
     fill_gen_user_data(ud, fit_params, spectra, energy_range, background, gen_func);
 
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
+
+    lm_status_struct<compute_t> status;
 
-    lm_status_struct<real_t> status;
+    // local copy so concurrent calls never write shared optimizer state
+    lm_control_struct<compute_t> control = _options;
+    if (options != nullptr)
+    {
+        if (options->max_iter >= 0)
+        {
+            control.patience = options->max_iter;
+        }
+        if (options->ftol >= 0)
+        {
+            control.ftol = options->ftol;
+        }
+        if (options->xtol >= 0)
+        {
+            control.xtol = options->xtol;
+        }
+        if (options->gtol >= 0)
+        {
+            control.gtol = options->gtol;
+        }
+    }
 
-    lmmin( fitp_arr.size(), &fitp_arr[0], energy_range.count(), (const void*) &ud, general_residuals_lmfit, &_options, &status );
+    lmmin( fitp_arr.size(), &fitp_arr[0], energy_range.count(), (const void*) &ud, general_residuals_lmfit, &control, &status );
 
     fit_params->from_array(fitp_arr);
 
@@ -369,10 +426,10 @@ OPTIMIZER_OUTCOME LMFit_Optimizer::minimize_quantification(Fit_Parameters *fit_p
     ud.quantification_model = quantification_model;
     ud.fit_parameters = fit_params;
 
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
 
-    lm_status_struct<real_t> status;
+    lm_status_struct<compute_t> status;
     lmmin( fitp_arr.size(), &fitp_arr[0], quant_map->size(), (const void*) &ud, quantification_residuals_lmfit, &_options, &status );
     logI<<lm_infmsg[status.outcome]<<"\n";
 
@@ -83,7 +83,8 @@ public:
                                            const Spectra * const spectra,
                                            const Range energy_range,
                                            const ArrayXr* background,
-                                           Gen_Func_Def gen_func);
+                                           Gen_Func_Def gen_func,
+                                           const Optimizer_Options* options = nullptr);
 
     virtual OPTIMIZER_OUTCOME minimize_quantification(Fit_Parameters *fit_params,
                                                     std::unordered_map<std::string, Element_Quant*> * quant_map,
@@ -95,7 +96,7 @@ public:
 
 private:
 
-    struct lm_control_struct<real_t> _options;
+    struct lm_control_struct<compute_t> _options;
 };
 
 } //namespace optimizers
@@ -64,7 +64,7 @@ namespace optimizers
 
 //-----------------------------------------------------------------------------
 
-int residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real_t **dvec, void *usr_data)
+int residuals_mpfit(int m, int params_size, compute_t *params, compute_t *dy, compute_t **dvec, void *usr_data)
 {
     // Get user passed data
     User_Data* ud = static_cast<User_Data*>(usr_data);
@@ -83,7 +83,23 @@ int residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real_t *
     //Calculate residuals
     for (int i=0; i<m; i++)
     {
-		dy[i] = (ud->spectra[i] - ud->spectra_model[i]) * ud->weights[i];
+		dy[i] = ((compute_t)ud->spectra[i] - (compute_t)ud->spectra_model[i]) * (compute_t)ud->weights[i];
+    }
+
+    // mpfit asks for the side = 3 columns through non null dvec[j], d dy / d param = -weights * d model / d param
+    if (dvec != nullptr)
+    {
+        ud->fit_model->model_jacobian(ud->fit_parameters, ud->elements, ud->energy_range, ud->jacobian);
+        for (int j = 0; j < params_size && j < (int)ud->jacobian.cols(); j++)
+        {
+            if (dvec[j] != nullptr)
+            {
+                for (int i = 0; i < m; i++)
+                {
+                    dvec[j][i] = -(compute_t)ud->jacobian(i, j) * (compute_t)ud->weights[i];
+                }
+            }
+        }
     }
 	
     ud->cur_itr++;
@@ -97,7 +113,7 @@ int residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real_t *
 
 //-----------------------------------------------------------------------------
 
-int gen_residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real_t **dvec, void *usr_data)
+int gen_residuals_mpfit(int m, int params_size, compute_t *params, compute_t *dy, compute_t **dvec, void *usr_data)
 {
     // Get user passed data
     Gen_User_Data* ud = static_cast<Gen_User_Data*>(usr_data);
@@ -114,7 +130,7 @@ int gen_residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real
     // Calculate residuals
     for (int i=0; i<m; i++)
     {
-        dy[i] = ( ud->spectra[i] - ud->spectra_model[i] ) * ud->weights[i];
+        dy[i] = ( (compute_t)ud->spectra[i] - (compute_t)ud->spectra_model[i] ) * (compute_t)ud->weights[i];
     }
 
     return 0;
@@ -123,7 +139,7 @@ int gen_residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real
 
 //-----------------------------------------------------------------------------
 
-int quantification_residuals_mpfit(int m, int params_size, real_t *params, real_t *dy, real_t **dvec, void *usr_data)
+int quantification_residuals_mpfit(int m, int params_size, compute_t *params, compute_t *dy, compute_t **dvec, void *usr_data)
 {
     ///(std::valarray<real_t> p, std::valarray<real_t> y, std::valarray<real_t> x)
 
@@ -253,23 +269,23 @@ void MPFit_Optimizer::set_options(unordered_map<string, real_t> opt)
 
 
 
-void MPFit_Optimizer::_fill_limits(Fit_Parameters *fit_params , vector<struct mp_par<real_t> > &par)
+void MPFit_Optimizer::_fill_limits(Fit_Parameters *fit_params , vector<struct mp_par<compute_t> > &par)
 {
 	for (auto itr = fit_params->begin(); itr != fit_params->end(); itr++)
 	{
-		Fit_Param fit = (*fit_params)[itr->first];
+		Fit_Param fit = itr->second;
 		if (fit.opt_array_index > -1)
 		{
 
 			if (fit.value > fit.max_val)
 			{
 				fit.max_val = fit.value + (real_t)1.0;
-				(*fit_params)[itr->first].max_val = fit.value + (real_t)1.0;
+				itr->second.max_val = fit.value + (real_t)1.0;
 			}
 			if (fit.value < fit.min_val)
 			{
 				fit.min_val = fit.value - (real_t)1.0;
-				(*fit_params)[itr->first].min_val = fit.value - (real_t)1.0;
+				itr->second.min_val = fit.value - (real_t)1.0;
 			}
 			if (fit.bound_type == E_Bound_Type::LIMITED_HI
 				|| fit.bound_type == E_Bound_Type::LIMITED_LO
@@ -279,8 +295,8 @@ void MPFit_Optimizer::_fill_limits(Fit_Parameters *fit_params , vector<struct mp
 				{
 					fit.max_val += (real_t)1.0;
 					fit.min_val -= (real_t)1.0;
-					(*fit_params)[itr->first].max_val += (real_t)1.0;
-					(*fit_params)[itr->first].min_val -= (real_t)1.0;
+					itr->second.max_val += (real_t)1.0;
+					itr->second.min_val -= (real_t)1.0;
 				}
 			}
 
@@ -392,9 +408,9 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize(Fit_Parameters *fit_params,
     User_Data ud;
     size_t num_itr = _options.maxiter;
 
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
-    std::vector<real_t> resid(energy_range.count());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
+    std::vector<compute_t> resid(energy_range.count());
 
     size_t total_itr = num_itr * (fitp_arr.size() + 1);
     fill_user_data(ud, fit_params, spectra, elements_to_fit, model, energy_range, status_callback, total_itr);
@@ -402,7 +418,7 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize(Fit_Parameters *fit_params,
     int info;
     /*
     /////// init config ////////////
-    struct mp_config<real_t> config;
+    struct mp_config<compute_t> config;
     config.ftol = 1e-10;       // Relative chi-square convergence criterium  Default: 1e-10
     config.xtol = 1e-10;       // Relative parameter convergence criterium   Default: 1e-10
     config.gtol = 1e-10;       // Orthogonality convergence criterium        Default: 1e-10
@@ -430,19 +446,36 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize(Fit_Parameters *fit_params,
 
     */
     /////////////// init params limits /////////////////////////
-	vector<struct mp_par<real_t> > par;
+	vector<struct mp_par<compute_t> > par;
 	par.resize(fitp_arr.size());
 
-    _options.maxfev = _options.maxiter * (fitp_arr.size() + 1);
+    mp_config<compute_t> config = _options;
+    config.maxfev = config.maxiter * (fitp_arr.size() + 1);
 
 	_fill_limits(fit_params, par);
 
-    mp_result<real_t> result;
+    if (_jacobian_mode == Jacobian_Mode::ANALYTIC)
+    {
+        fill_analytic_columns(ud);
+        for (size_t j = 0; j < par.size() && j < ud.analytic_columns.size(); j++)
+        {
+            if (ud.analytic_columns[j])
+            {
+                par[j].side = 3;
+            }
+        }
+    }
+    else if (_jacobian_mode == Jacobian_Mode::CHECK)
+    {
+        check_analytic_jacobian(ud);
+    }
+
+    mp_result<compute_t> result;
     memset(&result,0,sizeof(result));
     result.xerror = &perror[0];
     result.resid = &resid[0];
 
-    info = mpfit(residuals_mpfit, energy_range.count(), fitp_arr.size(), &fitp_arr[0], &par[0], &_options, (void *) &ud, &result);
+    info = mpfit(residuals_mpfit, energy_range.count(), fitp_arr.size(), &fitp_arr[0], &par[0], &config, (void *) &ud, &result);
 
 	_print_info(info);
 
@@ -453,7 +486,7 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize(Fit_Parameters *fit_params,
     }
     if (fit_params->contains(STR_RESIDUAL))
     {
-        real_t sum_resid = 0.0;
+        compute_t sum_resid = 0.0;
         for (int i = 0; i < energy_range.count(); i++)
         {
             sum_resid += resid[i];
@@ -473,19 +506,20 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_func(Fit_Parameters *fit_params,
                                                 const Spectra * const spectra,
                                                 const Range energy_range,
                                                 const ArrayXr* background,
-									            Gen_Func_Def gen_func)
+									            Gen_Func_Def gen_func,
+                                                const Optimizer_Options* options)
 {
     Gen_User_Data ud;
     fill_gen_user_data(ud, fit_params, spectra, energy_range, background, gen_func);
 
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
-    std::vector<real_t> resid(energy_range.count());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
+    std::vector<compute_t> resid(energy_range.count());
 
     int info;
     /*
     /////// init config ////////////
-    struct mp_config<real_t> mp_config;
+    struct mp_config<compute_t> mp_config;
     mp_config.ftol = 1e-10;       // Relative chi-square convergence criterium  Default: 1e-10
     mp_config.xtol = 1e-10;       // Relative parameter convergence criterium   Default: 1e-10
     mp_config.gtol = 1e-10;       // Orthogonality convergence criterium        Default: 1e-10
@@ -512,19 +546,40 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_func(Fit_Parameters *fit_params,
     mp_config.iterproc = 0;         // Placeholder pointer - must set to 0
     */
 
-    _options.maxfev = _options.maxiter * (fitp_arr.size() + 1);
+    // local copy so concurrent calls never write shared optimizer state
+    mp_config<compute_t> config = _options;
+    if (options != nullptr)
+    {
+        if (options->max_iter >= 0)
+        {
+            config.maxiter = options->max_iter;
+        }
+        if (options->ftol >= 0)
+        {
+            config.ftol = options->ftol;
+        }
+        if (options->xtol >= 0)
+        {
+            config.xtol = options->xtol;
+        }
+        if (options->gtol >= 0)
+        {
+            config.gtol = options->gtol;
+        }
+    }
+    config.maxfev = config.maxiter * (fitp_arr.size() + 1);
 
-	struct mp_par<real_t> *mp_par = nullptr;
-	//vector<struct mp_par<real_t> > par;
+	struct mp_par<compute_t> *mp_par = nullptr;
+	//vector<struct mp_par<compute_t> > par;
 	//par.resize(fitp_arr.size());
 	//_fill_limits(fit_params, par);
 
-    mp_result<real_t> result;
+    mp_result<compute_t> result;
     memset(&result,0,sizeof(result));
     result.xerror = &perror[0];
     result.resid = &resid[0];
 
-    info = mpfit(gen_residuals_mpfit, energy_range.count(), fitp_arr.size(), &fitp_arr[0], mp_par, &_options, (void *) &ud, &result);
+    info = mpfit(gen_residuals_mpfit, energy_range.count(), fitp_arr.size(), &fitp_arr[0], mp_par, &config, (void *) &ud, &result);
 /*
     
 */
@@ -536,7 +591,7 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_func(Fit_Parameters *fit_params,
     }
     if (fit_params->contains(STR_RESIDUAL))
     {
-        real_t sum_resid = 0.0;
+        compute_t sum_resid = 0.0;
         for (int i = 0; i< energy_range.count(); i++)
         {
              sum_resid += std::abs(resid[i]);
@@ -568,14 +623,14 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_quantification(Fit_Parameters *fit_p
     ud.quantification_model = quantification_model;
     ud.fit_parameters = fit_params;
 
-    std::vector<real_t> fitp_arr = fit_params->to_array();
-    std::vector<real_t> perror(fitp_arr.size());
-    std::vector<real_t> resid(quant_map->size());
+    std::vector<compute_t> fitp_arr = fit_params->to_array();
+    std::vector<compute_t> perror(fitp_arr.size());
+    std::vector<compute_t> resid(quant_map->size());
 
     int info;
     /*
     /////// init config ////////////
-    struct mp_config<real_t> mp_config;
+    struct mp_config<compute_t> mp_config;
     mp_config.ftol = 1e-10;       // Relative chi-square convergence criterium  Default: 1e-10
     mp_config.xtol = 1e-10;       // Relative parameter convergence criterium   Default: 1e-10
     mp_config.gtol = 1e-10;       // Orthogonality convergence criterium        Default: 1e-10
@@ -603,21 +658,22 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_quantification(Fit_Parameters *fit_p
     mp_config.iterproc = 0;         // Placeholder pointer - must set to 0
     */
 
-    _options.maxfev = _options.maxiter * (fitp_arr.size() + 1);
+    mp_config<compute_t> config = _options;
+    config.maxfev = config.maxiter * (fitp_arr.size() + 1);
 
-    mp_result<real_t> result;
+    mp_result<compute_t> result;
     memset(&result,0,sizeof(result));
     result.xerror = &perror[0];
     result.resid = &resid[0];
-//    struct mp_par<real_t> *mp_par = nullptr;
+//    struct mp_par<compute_t> *mp_par = nullptr;
 //	info = mpfit(quantification_residuals_mpfit, quant_map->size(), fitp_arr.size(), &fitp_arr[0], mp_par, &mp_config, (void *)&ud, &result);
 
 	
-	vector<struct mp_par<real_t> > par;
+	vector<struct mp_par<compute_t> > par;
 	par.resize(fitp_arr.size());
 	_fill_limits(fit_params, par);
 
-    info = mpfit(quantification_residuals_mpfit, quant_map->size(), fitp_arr.size(), &fitp_arr[0], &par[0], &_options, (void *) &ud, &result);
+    info = mpfit(quantification_residuals_mpfit, quant_map->size(), fitp_arr.size(), &fitp_arr[0], &par[0], &config, (void *) &ud, &result);
 
 	_print_info(info);
 
@@ -629,7 +685,7 @@ OPTIMIZER_OUTCOME MPFit_Optimizer::minimize_quantification(Fit_Parameters *fit_p
     }
     if (fit_params->contains(STR_RESIDUAL))
     {
-        real_t sum_resid = 0.0;
+        compute_t sum_resid = 0.0;
         for (int i = 0; i < quant_map->size(); i++)
         {
             sum_resid += resid[i];
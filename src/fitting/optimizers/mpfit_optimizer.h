@@ -81,7 +81,8 @@ public:
                                             const Spectra * const spectra,
                                             const Range energy_range,
                                             const ArrayXr* background,
-                                            Gen_Func_Def gen_func);
+                                            Gen_Func_Def gen_func,
+                                            const Optimizer_Options* options = nullptr);
 
     virtual OPTIMIZER_OUTCOME minimize_quantification(Fit_Parameters *fit_params,
                                                      std::unordered_map<std::string, Element_Quant*> * quant_map,
@@ -93,11 +94,11 @@ public:
 
 private:
 
-	void _fill_limits(Fit_Parameters *fit_params, vector<struct mp_par<real_t> > &par);
+	void _fill_limits(Fit_Parameters *fit_params, vector<struct mp_par<compute_t> > &par);
 	
     inline void _print_info(int info);
 
-    struct mp_config<real_t> _options;
+    struct mp_config<compute_t> _options;
 
 };
 
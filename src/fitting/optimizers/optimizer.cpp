@@ -49,12 +49,20 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "optimizer.h"
 
+#include <limits>
+
 
 namespace fitting
 {
 namespace optimizers
 {
 
+    void set_spectra_view(Spectra::TConstMapXr& view, const Spectra* const spectra, const Range energy_range)
+    {
+        //not allocating memory. see https://eigen.tuxfamily.org/dox/group__TutorialMapClass.html
+        new (&view) Spectra::TConstMapXr(spectra->sub_view(energy_range.min, energy_range.count()));
+    }
+
     void fill_user_data(User_Data& ud,
                         Fit_Parameters* fit_params,
                         const Spectra* const spectra,
@@ -67,9 +75,7 @@ namespace optimizers
 	{
 		ud.fit_model = (Base_Model*)model;
 		// set spectra to fit
-        ud.spectra = spectra->sub_spectra(energy_range.min, energy_range.count());
-        //not allocating memory. see https://eigen.tuxfamily.org/dox/group__TutorialMapClass.html
-        //new (&(ud.spectra)) Eigen::Map<const ArrayXr>(spectra->data() + energy_range.min, energy_range.count());
+        set_spectra_view(ud.spectra, spectra, energy_range);
         ud.orig_spectra = spectra;
 		ud.fit_parameters = fit_params;
 		ud.elements = (Fit_Element_Map_Dict *)elements_to_fit;
@@ -94,12 +100,10 @@ namespace optimizers
             ud.weights.fill(1.0);
         }
 
-        ArrayXr background(spectra->size());
-        background.setZero(spectra->size());
         if(fit_params->contains(STR_SNIP_WIDTH))
         {
             real_t spectral_binning = 0.0;
-            background = snip_background(spectra,
+            ArrayXr background = snip_background(spectra,
                                          fit_params->value(STR_ENERGY_OFFSET),
                                          fit_params->value(STR_ENERGY_SLOPE),
                                          fit_params->value(STR_ENERGY_QUADRATIC),
@@ -107,9 +111,12 @@ namespace optimizers
                                          fit_params->value(STR_SNIP_WIDTH),
                                          energy_range.min,
                                          energy_range.max);
+            ud.spectra_background = background.segment(energy_range.min, energy_range.count()).unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
+        }
+        else
+        {
+            ud.spectra_background.setZero(energy_range.count());
         }
-        ud.spectra_background = background.segment(energy_range.min, energy_range.count());
-        ud.spectra_background = ud.spectra_background.unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
 		ud.spectra_model.resize(energy_range.count());
 	}
 
@@ -123,9 +130,7 @@ namespace optimizers
 	{
 		ud.func = gen_func;
 		// set spectra to fit
-        ud.spectra = spectra->sub_spectra(energy_range.min, energy_range.count());;
-        //not allocating memory. see https://eigen.tuxfamily.org/dox/group__TutorialMapClass.html
-        //new (&ud.spectra) Eigen::Map<const ArrayXr>(spectra->data() + energy_range.min, energy_range.count());
+        set_spectra_view(ud.spectra, spectra, energy_range);
 		ud.fit_parameters = fit_params;
         ud.energy_range.min = energy_range.min;
         ud.energy_range.max = energy_range.max;
@@ -143,8 +148,7 @@ namespace optimizers
             ud.weights.resize(energy_range.count());
             ud.weights.fill(1.0);
         }
-        ud.spectra_background = *background;
-        ud.spectra_background = ud.spectra_background.unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
+        ud.spectra_background = background->unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
         
 		ud.spectra_model.resize(energy_range.count());
 	}
@@ -167,8 +171,7 @@ namespace optimizers
                                              ud->energy_range.min,
                                              ud->energy_range.max);
 
-				ud->spectra_background = background.segment(ud->energy_range.min, ud->energy_range.count());
-                ud->spectra_background = ud->spectra_background.unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
+				ud->spectra_background = background.segment(ud->energy_range.min, ud->energy_range.count()).unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
 				
             }
         }
@@ -176,5 +179,85 @@ namespace optimizers
 
     }
 
+    void fill_analytic_columns(User_Data &ud)
+    {
+        ud.fit_model->analytic_jacobian_columns(ud.fit_parameters, ud.elements, ud.analytic_columns);
+
+        int snip_idx = ud.fit_parameters->param_index(STR_SNIP_WIDTH);
+        if (snip_idx > -1 && ud.fit_parameters->at(snip_idx).bound_type > E_Bound_Type::FIXED)
+        {
+            for (const std::string& name : { STR_ENERGY_OFFSET, STR_ENERGY_SLOPE, STR_ENERGY_QUADRATIC, STR_SNIP_WIDTH })
+            {
+                int idx = ud.fit_parameters->param_index(name);
+                if (idx > -1 && ud.fit_parameters->at(idx).bound_type > E_Bound_Type::FIXED)
+                {
+                    int column = ud.fit_parameters->at(idx).opt_array_index;
+                    if (column > -1 && column < (int)ud.analytic_columns.size())
+                    {
+                        ud.analytic_columns[column] = false;
+                    }
+                }
+            }
+        }
+    }
+
+    void check_analytic_jacobian(User_Data &ud)
+    {
+        fill_analytic_columns(ud);
+        ud.fit_model->model_jacobian(ud.fit_parameters, ud.elements, ud.energy_range, ud.jacobian);
+
+        for (auto& itr : (*ud.fit_parameters))
+        {
+            Fit_Param& param = itr.second;
+            int column = param.opt_array_index;
+            if (param.bound_type <= E_Bound_Type::FIXED || column < 0 || column >= (int)ud.analytic_columns.size() || column >= ud.jacobian.cols())
+            {
+                continue;
+            }
+            if (false == ud.analytic_columns[column])
+            {
+                logI << itr.first << " : finite differences\n";
+                continue;
+            }
+
+            // no single step suits every parameter in real_t, a shift of the energy calibration moves the last channels
+            // a long way while amplitudes are in log10. Take the step of 10^-1 .. 10^-8 of the parameter's scale that agrees best
+            real_t value = param.value;
+            real_t base = std::abs(value);
+            if (std::isfinite(param.max_val - param.min_val))
+            {
+                base = std::max(base, std::abs(param.max_val - param.min_val));
+            }
+            if (base <= (real_t)0.0)
+            {
+                base = (real_t)1.0;
+            }
+            const auto col = ud.jacobian.col(column);
+            const real_t scale = col.abs().maxCoeff();
+            real_t error = std::numeric_limits<real_t>::max();
+            for (int k = 1; k <= 8; k++)
+            {
+                real_t step = base * std::pow((real_t)10.0, (real_t)-k);
+                param.value = value + step;
+                ArrayXr model_hi = ud.fit_model->model_spectrum_mp(ud.fit_parameters, ud.elements, ud.energy_range);
+                param.value = value - step;
+                ArrayXr model_lo = ud.fit_model->model_spectrum_mp(ud.fit_parameters, ud.elements, ud.energy_range);
+                param.value = value;
+
+                ArrayXr numeric = ((model_hi - model_lo) / ((real_t)2.0 * step)).unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
+                error = std::min(error, (real_t)(numeric - col).abs().maxCoeff());
+            }
+            real_t rel_error = (scale > (real_t)0.0) ? error / scale : error;
+            if (rel_error > (real_t)0.01)
+            {
+                logW << itr.first << " : analytic derivative is off by " << rel_error << " of its largest value " << scale << "\n";
+            }
+            else
+            {
+                logI << itr.first << " : analytic derivative within " << rel_error << " of its largest value " << scale << "\n";
+            }
+        }
+    }
+
 } //namespace optimizers
 } //namespace fitting
@@ -84,14 +84,18 @@ typedef std::function<void(const Fit_Parameters * const, const Range * const, Sp
 
 enum class OPTIMIZER_OUTCOME{ FOUND_ZERO, CONVERGED, TRAPPED,  EXHAUSTED, FAILED, CRASHED, EXPLODED, STOPPED, FOUND_NAN, F_TOL_LT_TOL, X_TOL_LT_TOL, G_TOL_LT_TOL};
 
+/// how minimize() gets the derivatives of the residuals. ANALYTIC takes the columns the model derives from Base_Model::model_jacobian()
+/// and finite differences for the rest, CHECK logs the analytic columns against finite differences before fitting with finite differences
+enum class Jacobian_Mode { NUMERIC, ANALYTIC, CHECK };
+
 /**
  * @brief The User_Data struct : Structure used by minimize function for optimizers
  */
 struct User_Data
 {
     Base_Model* fit_model;
-    //Eigen::Map<ArrayXr> spectra;
-    Spectra spectra;
+    //view of the fitted energy range of orig_spectra, see set_spectra_view()
+    Spectra::TConstMapXr spectra{nullptr, 0};
 	ArrayXr weights;
     Fit_Parameters *fit_parameters;
 	ArrayXr spectra_background;
@@ -102,12 +106,15 @@ struct User_Data
     Callback_Func_Status_Def* status_callback;
     size_t cur_itr;
     size_t total_itr;
+    //free parameters taken from the model's jacobian, by opt_array_index. see fill_analytic_columns()
+    std::vector<bool> analytic_columns;
+    JacobianXr jacobian;
 };
 
 struct Gen_User_Data
 {
-    //Eigen::Map<ArrayXr> spectra;
-    Spectra spectra;
+    //view of the fitted energy range of the spectra passed to minimize_func
+    Spectra::TConstMapXr spectra{nullptr, 0};
 	ArrayXr weights;
     Fit_Parameters *fit_parameters;
 	ArrayXr spectra_background;
@@ -123,6 +130,9 @@ struct Quant_User_Data
     std::unordered_map<std::string, Element_Quant> quant_map;
 };
 
+/// point view at the energy_range samples of spectra without copying them
+void set_spectra_view(Spectra::TConstMapXr& view, const Spectra * const spectra, const Range energy_range);
+
 void fill_user_data(User_Data &ud,
                     Fit_Parameters *fit_params,
                     const Spectra * const spectra,
@@ -143,13 +153,35 @@ void fill_gen_user_data(Gen_User_Data &ud,
 
 void update_background_user_data(User_Data *ud);
 
+/// flag the free parameters of ud the model derives analytically. While the snip width is fitted the background
+/// moves with the energy calibration, those columns stay finite differences
+void fill_analytic_columns(User_Data &ud);
+
+/// log how far each analytic column of the model's jacobian is from central differences at the current parameters
+void check_analytic_jacobian(User_Data &ud);
+
+/**
+ * @brief The Optimizer_Options struct : Per call overrides for an optimizer's configuration.
+ *        Values less than 0 keep the optimizer's own setting. Passed by const pointer so
+ *        one optimizer can be shared between threads without set_options() calls per pixel.
+ */
+struct DLL_EXPORT Optimizer_Options
+{
+    Optimizer_Options() : max_iter(-1), ftol(-1.0), xtol(-1.0), gtol(-1.0) {}
+
+    int max_iter;
+    real_t ftol;
+    real_t xtol;
+    real_t gtol;
+};
+
 /**
  * @brief The Optimizer class : Base class for error minimization to find optimal specta model
  */
 class DLL_EXPORT Optimizer
 {
 public:
-    Optimizer(){}
+    Optimizer() : _jacobian_mode(Jacobian_Mode::NUMERIC) {}
 
     ~Optimizer(){}
 
@@ -164,7 +196,8 @@ public:
                                const Spectra * const spectra,
                                const Range energy_range,
                                const ArrayXr* background,
-                               Gen_Func_Def gen_func) = 0;
+                               Gen_Func_Def gen_func,
+                               const Optimizer_Options* options = nullptr) = 0;
 
 
     virtual OPTIMIZER_OUTCOME minimize_quantification(Fit_Parameters *fit_params,
@@ -175,9 +208,15 @@ public:
 
     virtual void set_options(unordered_map<string, real_t> opt) = 0;
 
+    void set_jacobian_mode(Jacobian_Mode mode) { _jacobian_mode = mode; }
+
+    Jacobian_Mode jacobian_mode() const { return _jacobian_mode; }
+
 protected:
     map<int, OPTIMIZER_OUTCOME> _outcome_map;
 
+    Jacobian_Mode _jacobian_mode;
+
 };
 
 } //namespace optimizers
@@ -53,6 +53,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "fitting/optimizers/optimizer.h"
 #include "data_struct/spectra.h"
+#include "data_struct/sparse_spectra.h"
 #include "fitting/models/base_model.h"
 #include "data_struct/fit_element_map.h"
 
@@ -95,6 +96,52 @@ public:
                                                       const Fit_Element_Map_Dict * const elements_to_fit,
                                                       std::unordered_map<std::string, real_t>& out_counts) = 0;
 
+    /// true if fit_sparse_spectra() does less work than fit_spectra() for sparse pixels
+    virtual bool supports_sparse() const { return false; }
+
+    /**
+     * @brief fit_sparse_spectra : Fit a spectra whose nonzero channels are also given in sparse form.
+     *  Routines that don't support sparse spectra fit the dense spectra.
+     */
+    virtual optimizers::OPTIMIZER_OUTCOME fit_sparse_spectra(const models::Base_Model * const model,
+                                                             const Spectra * const spectra,
+                                                             const Sparse_Spectra * const /*sparse_spectra*/,
+                                                             const Fit_Element_Map_Dict * const elements_to_fit,
+                                                             std::unordered_map<std::string, real_t>& out_counts)
+    {
+        return fit_spectra(model, spectra, elements_to_fit, out_counts);
+    }
+
+    /**
+     * @brief fit_spectra_counts : Fit a single spectra and write the counts by index instead of by name.
+     *  out_counts holds elements_to_fit->size() + 2 values : the element counts in the dict's iteration order,
+     *  then the number of iterations and the residual. Values the routine does not produce are left as they are.
+     *  Routines without a faster path go through fit_spectra().
+     */
+    virtual optimizers::OPTIMIZER_OUTCOME fit_spectra_counts(const models::Base_Model * const model,
+                                                             const Spectra * const spectra,
+                                                             const Fit_Element_Map_Dict * const elements_to_fit,
+                                                             real_t* out_counts)
+    {
+        std::unordered_map<std::string, real_t> counts_dict;
+        optimizers::OPTIMIZER_OUTCOME ret = fit_spectra(model, spectra, elements_to_fit, counts_dict);
+        _counts_from_dict(elements_to_fit, counts_dict, out_counts);
+        return ret;
+    }
+
+    /// fit_sparse_spectra() with the counts written like fit_spectra_counts()
+    virtual optimizers::OPTIMIZER_OUTCOME fit_sparse_spectra_counts(const models::Base_Model * const model,
+                                                                    const Spectra * const spectra,
+                                                                    const Sparse_Spectra * const sparse_spectra,
+                                                                    const Fit_Element_Map_Dict * const elements_to_fit,
+                                                                    real_t* out_counts)
+    {
+        std::unordered_map<std::string, real_t> counts_dict;
+        optimizers::OPTIMIZER_OUTCOME ret = fit_sparse_spectra(model, spectra, sparse_spectra, elements_to_fit, counts_dict);
+        _counts_from_dict(elements_to_fit, counts_dict, out_counts);
+        return ret;
+    }
+
     /**
      * @brief get_name : Returns fit routine name
      * @return
@@ -115,6 +162,46 @@ public:
 
 protected:
 
+    /// copy a fit_spectra() dict into a fit_spectra_counts() buffer
+    static void _counts_from_dict(const Fit_Element_Map_Dict * const elements_to_fit, const std::unordered_map<std::string, real_t>& counts_dict, real_t* out_counts)
+    {
+        size_t k = 0;
+        for (const auto& itr : *elements_to_fit)
+        {
+            auto c_itr = counts_dict.find(itr.first);
+            if (c_itr != counts_dict.end())
+            {
+                out_counts[k] = c_itr->second;
+            }
+            k++;
+        }
+        auto c_itr = counts_dict.find(STR_NUM_ITR);
+        if (c_itr != counts_dict.end())
+        {
+            out_counts[k] = c_itr->second;
+        }
+        c_itr = counts_dict.find(STR_RESIDUAL);
+        if (c_itr != counts_dict.end())
+        {
+            out_counts[k + 1] = c_itr->second;
+        }
+    }
+
+    /// copy a fit_spectra_counts() buffer into a fit_spectra() dict, the iteration count and residual only if the routine has them
+    static void _counts_to_dict(const Fit_Element_Map_Dict * const elements_to_fit, const real_t* counts, bool has_iterations, std::unordered_map<std::string, real_t>& out_counts)
+    {
+        size_t k = 0;
+        for (const auto& itr : *elements_to_fit)
+        {
+            out_counts[itr.first] = counts[k];
+            k++;
+        }
+        if (has_iterations)
+        {
+            out_counts[STR_NUM_ITR] = counts[k];
+            out_counts[STR_RESIDUAL] = counts[k + 1];
+        }
+    }
 
 private:
 
@@ -53,12 +53,17 @@ namespace fitting
 namespace routines
 {
 
-std::mutex Matrix_Optimized_Fit_Routine::_int_spec_mutex;
+std::atomic<size_t> Matrix_Optimized_Fit_Routine::_next_accumulator_generation(1);
 
 // ----------------------------------------------------------------------------
 
 Matrix_Optimized_Fit_Routine::Matrix_Optimized_Fit_Routine() : Param_Optimized_Fit_Routine()
 {
+    _accumulator_generation = _next_accumulator_generation++;
+
+    _pixel_fit_options.max_iter = 300;
+    _pixel_fit_options.ftol = 1.0e-11;
+    _pixel_fit_options.gtol = 1.0e-11;
 
 }
 
@@ -211,12 +216,75 @@ void Matrix_Optimized_Fit_Routine::initialize(models::Base_Model * const model,
     //logI<<"-------- Generating element models ---------"<<"\n";
     _element_models = _generate_element_models(model, elements_to_fit, energy_range);
 
+    _reset_accumulators();
+
+}
+
+// ----------------------------------------------------------------------------
+
+void Matrix_Optimized_Fit_Routine::_reset_accumulators()
+{
+    std::lock_guard<std::mutex> lock(_accumulator_mutex);
+    _accumulators.clear();
+    _accumulator_generation = _next_accumulator_generation++;
+    _integrated_fitted_spectra.setZero(_energy_range.count());
+    _integrated_background.setZero(_energy_range.count());
+    _max_channels_spectra.setZero(0);
+    _max_10_channels_spectra.setZero(0);
+}
+
+// ----------------------------------------------------------------------------
+
+Integrated_Spectra_Accumulator* Matrix_Optimized_Fit_Routine::_thread_accumulator()
+{
+    // routine -> (generation, accumulator) for this thread
+    static thread_local std::unordered_map<const Matrix_Optimized_Fit_Routine*, std::pair<size_t, Integrated_Spectra_Accumulator*> > thread_cache;
+
+    auto itr = thread_cache.find(this);
+    if (itr != thread_cache.end() && itr->second.first == _accumulator_generation)
     {
-        std::lock_guard<std::mutex> lock(_int_spec_mutex);
-        _integrated_fitted_spectra.setZero(energy_range.count());
-        _integrated_background.setZero(energy_range.count());
+        return itr->second.second;
     }
 
+    std::lock_guard<std::mutex> lock(_accumulator_mutex);
+    Integrated_Spectra_Accumulator* accumulator = new Integrated_Spectra_Accumulator();
+    accumulator->fitted_spectra.setZero(_energy_range.count());
+    accumulator->background.setZero(_energy_range.count());
+    accumulator->coefficients.setZero(_element_models.size());
+    _accumulators.emplace_back(accumulator);
+    thread_cache[this] = { _accumulator_generation, accumulator };
+    return accumulator;
+}
+
+// ----------------------------------------------------------------------------
+
+void Matrix_Optimized_Fit_Routine::finalize_integrated_spectra()
+{
+    std::lock_guard<std::mutex> lock(_accumulator_mutex);
+    size_t max_size = 0;
+    for (const auto& accumulator : _accumulators)
+    {
+        max_size = std::max(max_size, (size_t)accumulator->max_channels_spectra.size());
+    }
+    ArrayXc fitted_spectra = ArrayXc::Zero(_energy_range.count());
+    ArrayXc background = ArrayXc::Zero(_energy_range.count());
+    ArrayXc max_channels_spectra = ArrayXc::Zero(max_size);
+    ArrayXc max_10_channels_spectra = ArrayXc::Zero(max_size);
+    // always reduce in the order the accumulators were created
+    for (const auto& accumulator : _accumulators)
+    {
+        fitted_spectra += accumulator->fitted_spectra;
+        background += accumulator->background;
+        if (accumulator->max_channels_spectra.size() > 0)
+        {
+            max_channels_spectra.head(accumulator->max_channels_spectra.size()) += accumulator->max_channels_spectra;
+            max_10_channels_spectra.head(accumulator->max_10_channels_spectra.size()) += accumulator->max_10_channels_spectra;
+        }
+    }
+    _integrated_fitted_spectra = ArrayXr(fitted_spectra.cast<real_t>());
+    _integrated_background = ArrayXr(background.cast<real_t>());
+    _max_channels_spectra = ArrayXr(max_channels_spectra.cast<real_t>());
+    _max_10_channels_spectra = ArrayXr(max_10_channels_spectra.cast<real_t>());
 }
 
 // ----------------------------------------------------------------------------
@@ -262,13 +330,7 @@ OPTIMIZER_OUTCOME Matrix_Optimized_Fit_Routine:: fit_spectra(const models::Base_
 
         std::function<void(const Fit_Parameters* const, const  Range* const, Spectra*)> gen_func = std::bind(&Matrix_Optimized_Fit_Routine::model_spectrum, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
 
-        //set num iter to 300;
-        unordered_map<string, real_t> opt_options{ {STR_OPT_MAXITER, 300.}, {STR_OPT_FTOL, 1.0e-11 }, {STR_OPT_GTOL, 1.0e-11 } };
-        unordered_map<string, real_t> saved_options = _optimizer->get_options();        
-        _optimizer->set_options(opt_options);
-
-
-        ret_val = _optimizer->minimize_func(&fit_params, spectra, _energy_range, &background, gen_func);
+        ret_val = _optimizer->minimize_func(&fit_params, spectra, _energy_range, &background, gen_func, &_pixel_fit_options);
         //Save the counts from fit parameters into fit count dict for each element
         for (auto el_itr : *elements_to_fit)
         {
@@ -299,31 +361,29 @@ OPTIMIZER_OUTCOME Matrix_Optimized_Fit_Routine:: fit_spectra(const models::Base_
         model_spectra += background;
         model_spectra = (ArrayXr)model_spectra.unaryExpr([](real_t v) { return std::isfinite(v) ? v : (real_t)0.0; });
 
-		//lock and integrate results
+		//integrate results into this thread's accumulator
 		{
-            std::lock_guard<std::mutex> lock(_int_spec_mutex);
-            _integrated_fitted_spectra.add(model_spectra);
-            _integrated_background.add(background);
+            Integrated_Spectra_Accumulator* accumulator = _thread_accumulator();
+            accumulator->fitted_spectra += model_spectra.cast<compute_t>();
+            accumulator->background += background.cast<compute_t>();
 
 			//we don't know the spectra size during initlaize() will have to resize here
-			if (_max_channels_spectra.size() < spectra->size())
+			if (accumulator->max_channels_spectra.size() < spectra->size())
 			{
-				_max_channels_spectra.setZero(spectra->size());
+				accumulator->max_channels_spectra.setZero(spectra->size());
 			}
-			if (_max_10_channels_spectra.size() < spectra->size())
+			if (accumulator->max_10_channels_spectra.size() < spectra->size())
 			{
-				_max_10_channels_spectra.setZero(spectra->size());
+				accumulator->max_10_channels_spectra.setZero(spectra->size());
 			}
 
-			_max_channels_spectra[max_map[0].first] += max_map[0].second;
+			accumulator->max_channels_spectra[max_map[0].first] += max_map[0].second;
 
 			for (auto &itr : max_map)
 			{
-				_max_10_channels_spectra[itr.first] += itr.second;
+				accumulator->max_10_channels_spectra[itr.first] += itr.second;
 			}
         }
-
-        _optimizer->set_options(saved_options);
     }
 
     return ret_val;
@@ -51,6 +51,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #define Matrix_Optimized_Fit_Routine_H
 
 #include <mutex>
+#include <memory>
+#include <atomic>
 
 #include "fitting/routines/param_optimized_fit_routine.h"
 #include "data_struct/fit_parameters.h"
@@ -63,6 +65,20 @@ namespace routines
 using namespace data_struct;
 using namespace std;
 
+/**
+ * @brief Integrated spectra summed by one fitting thread, reduced after all pixels are fit
+ */
+struct Integrated_Spectra_Accumulator
+{
+    //summed over every pixel a thread fits, so kept in compute_t
+    ArrayXc fitted_spectra;
+    ArrayXc background;
+    ArrayXc max_channels_spectra;
+    ArrayXc max_10_channels_spectra;
+    /// element coefficients of pixels that were not expanded into fitted_spectra, see NNLS_Fit_Routine
+    ArrayXc coefficients;
+};
+
 /**
  * @brief The Matrix_Optimized_Fit_Routine class : Matrix fit model
  */
@@ -88,6 +104,9 @@ public:
                         const struct Range * const energy_range,
 					    Spectra* spectra_model);
 
+    /// sum the per thread accumulators into the integrated spectra, call after all pixels are fit
+    virtual void finalize_integrated_spectra();
+
     const Spectra& fitted_integrated_spectra() {return _integrated_fitted_spectra;}
 
     const Spectra& fitted_integrated_background() { return _integrated_background; }
@@ -107,9 +126,25 @@ protected:
 	data_struct::Spectra _max_channels_spectra;
 	data_struct::Spectra _max_10_channels_spectra;
 
+    /// accumulator owned by the calling thread, created on first use
+    Integrated_Spectra_Accumulator* _thread_accumulator();
+
+    void _reset_accumulators();
+
     unordered_map<string, Spectra> _element_models;
 
-    static std::mutex _int_spec_mutex;
+    //one per fitting thread, only locked when a thread gets its accumulator
+    std::vector<std::unique_ptr<Integrated_Spectra_Accumulator> > _accumulators;
+
+    std::mutex _accumulator_mutex;
+
+    //changes on every reset so threads drop cached accumulators
+    size_t _accumulator_generation;
+
+    static std::atomic<size_t> _next_accumulator_generation;
+
+    //per pixel optimizer settings, passed to each minimize_func call instead of set_options
+    optimizers::Optimizer_Options _pixel_fit_options;
 
 };
 
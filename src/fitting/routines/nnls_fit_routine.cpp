@@ -60,6 +60,7 @@ NNLS_Fit_Routine::NNLS_Fit_Routine() : Matrix_Optimized_Fit_Routine()
 {
 
     _max_iter = 200;
+    _element_columns_dict = nullptr;
 
 }
 
@@ -69,6 +70,7 @@ NNLS_Fit_Routine::NNLS_Fit_Routine(size_t max_iter) : Matrix_Optimized_Fit_Routi
 {
 
     _max_iter = max_iter;
+    _element_columns_dict = nullptr;
 
 }
 
@@ -100,15 +102,53 @@ void NNLS_Fit_Routine::_generate_fitmatrix()
         _element_row_index[itr.first] = i;
         i++;
     }
+    _gram = _fitmatrix.transpose() * _fitmatrix;
 
 }
 
 // ----------------------------------------------------------------------------
 
+void NNLS_Fit_Routine::_map_element_columns(const Fit_Element_Map_Dict * const elements_to_fit, std::vector<int>& columns) const
+{
+    columns.clear();
+    for(const auto& itr : *elements_to_fit)
+    {
+        auto c_itr = _element_row_index.find(itr.first);
+        columns.push_back(c_itr != _element_row_index.end() ? c_itr->second : -1);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+const std::vector<int>& NNLS_Fit_Routine::_element_columns_of(const Fit_Element_Map_Dict * const elements_to_fit, std::vector<int>& scratch) const
+{
+    if (elements_to_fit == _element_columns_dict && elements_to_fit->size() == _element_columns.size())
+    {
+        return _element_columns;
+    }
+    _map_element_columns(elements_to_fit, scratch);
+    return scratch;
+}
+
+// ----------------------------------------------------------------------------
+
 OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra(const models::Base_Model * const model,
                                                 const Spectra * const spectra,
                                                 const Fit_Element_Map_Dict * const elements_to_fit,
                                                 std::unordered_map<std::string, real_t>& out_counts)
+{
+    std::vector<real_t> counts(elements_to_fit->size() + 2, (real_t)0.0);
+    OPTIMIZER_OUTCOME ret = fit_spectra_counts(model, spectra, elements_to_fit, counts.data());
+    _counts_to_dict(elements_to_fit, counts.data(), true, out_counts);
+    return ret;
+}
+
+// ----------------------------------------------------------------------------
+
+OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra_counts(const models::Base_Model * const model,
+                                                       const Spectra * const spectra,
+                                                       const Fit_Element_Map_Dict * const elements_to_fit,
+                                                       real_t* out_counts)
 {
 	data_struct::ArrayXr* result;
     int num_iter;
@@ -135,9 +175,7 @@ OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra(const models::Base_Model * const
         background.setZero(_energy_range.count());
     }
 
-    ArrayXr spectra_sub_background = spectra->segment(_energy_range.min, _energy_range.count());
-    spectra_sub_background -= background;
-    spectra_sub_background = spectra_sub_background.unaryExpr([](real_t v) { return v>0.0 ? v : (real_t)0.0; });
+    ArrayXr spectra_sub_background = (spectra->sub_view(_energy_range.min, _energy_range.count()) - background).unaryExpr([](real_t v) { return v>0.0 ? v : (real_t)0.0; });
     nsNNLS::nnls<real_t> solver(&_fitmatrix, &spectra_sub_background, _max_iter);
 
     Spectra spectra_model = background;
@@ -154,13 +192,20 @@ OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra(const models::Base_Model * const
 
     result = solver.getSolution();
 
-    for(const auto& itr : *elements_to_fit)
+    std::vector<int> scratch;
+    const std::vector<int>& columns = _element_columns_of(elements_to_fit, scratch);
+    for(size_t k = 0; k < columns.size(); k++)
     {
-        out_counts[itr.first] = (*result)[_element_row_index[itr.first]];
+        int col = columns[k];
+        if (col < 0)
+        {
+            continue;
+        }
+        out_counts[k] = (*result)[col];
 
 		for (int j = 0; j < _energy_range.count(); j++)
 		{
-			real_t val = _fitmatrix(j, _element_row_index[itr.first]) * (*result)[_element_row_index[itr.first]];
+			real_t val = _fitmatrix(j, col) * (*result)[col];
 			if (std::isfinite(val))
 			{
 				spectra_model[j] += val;
@@ -168,14 +213,14 @@ OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra(const models::Base_Model * const
 		}
     }
 
-    out_counts[STR_NUM_ITR] = static_cast<real_t>(num_iter);
-    out_counts[STR_RESIDUAL] = npg;
+    out_counts[columns.size()] = static_cast<real_t>(num_iter);
+    out_counts[columns.size() + 1] = npg;
 
-	//lock and integrate results
+	//integrate results into this thread's accumulator
 	{
-		std::lock_guard<std::mutex> lock(_int_spec_mutex);
-		_integrated_fitted_spectra.add(spectra_model);
-        _integrated_background.add(background);
+		Integrated_Spectra_Accumulator* accumulator = _thread_accumulator();
+		accumulator->fitted_spectra += spectra_model.cast<compute_t>();
+        accumulator->background += background.cast<compute_t>();
 	}
 
     if (num_iter == solver.getMaxit())
@@ -188,12 +233,150 @@ OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_spectra(const models::Base_Model * const
 
 // ----------------------------------------------------------------------------
 
+OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_sparse_spectra(const models::Base_Model * const model,
+                                                       const Spectra * const spectra,
+                                                       const Sparse_Spectra * const sparse_spectra,
+                                                       const Fit_Element_Map_Dict * const elements_to_fit,
+                                                       std::unordered_map<std::string, real_t>& out_counts)
+{
+    std::vector<real_t> counts(elements_to_fit->size() + 2, (real_t)0.0);
+    OPTIMIZER_OUTCOME ret = fit_sparse_spectra_counts(model, spectra, sparse_spectra, elements_to_fit, counts.data());
+    _counts_to_dict(elements_to_fit, counts.data(), true, out_counts);
+    return ret;
+}
+
+// ----------------------------------------------------------------------------
+
+OPTIMIZER_OUTCOME NNLS_Fit_Routine::fit_sparse_spectra_counts(const models::Base_Model * const model,
+                                                              const Spectra * const spectra,
+                                                              const Sparse_Spectra * const sparse_spectra,
+                                                              const Fit_Element_Map_Dict * const elements_to_fit,
+                                                              real_t* out_counts)
+{
+    if (sparse_spectra == nullptr || false == sparse_spectra->is_valid() || _gram.cols() != _fitmatrix.cols())
+    {
+        return fit_spectra_counts(model, spectra, elements_to_fit, out_counts);
+    }
+
+    data_struct::ArrayXr* result;
+    int num_iter;
+    real_t npg;
+    const Fit_Parameters& fit_params = model->fit_parameters();
+    bool has_background = fit_params.contains(STR_SNIP_WIDTH);
+    ArrayXr background;
+    if (has_background)
+    {
+        real_t spectral_binning = 0.0;
+        ArrayXr bkg = snip_background(spectra,
+            fit_params.value(STR_ENERGY_OFFSET),
+            fit_params.value(STR_ENERGY_SLOPE),
+            fit_params.value(STR_ENERGY_QUADRATIC),
+            spectral_binning,
+            fit_params.value(STR_SNIP_WIDTH),
+            _energy_range.min,
+            _energy_range.max);
+
+        background = bkg.segment(_energy_range.min, _energy_range.count());
+    }
+
+    // A'b and b'b over the nonzero channels of the energy range, the rhs is clipped at 0 like the dense fit
+    ArrayXr atb = ArrayXr::Zero(_fitmatrix.cols());
+    real_t btb = 0.0;
+    for (size_t idx = sparse_spectra->lower_index(_energy_range.min); idx < sparse_spectra->nnz(); idx++)
+    {
+        size_t row = sparse_spectra->channel(idx) - _energy_range.min;
+        if (row >= _energy_range.count())
+        {
+            break;
+        }
+        real_t val = sparse_spectra->value(idx);
+        if (has_background)
+        {
+            val -= background[row];
+        }
+        if (val > 0.0)
+        {
+            atb += _fitmatrix.row(row).transpose().array() * val;
+            btb += val * val;
+        }
+    }
+
+    nsNNLS::nnls<real_t> solver(&_gram, &atb, btb, _max_iter);
+    solver.optimize(num_iter, npg);
+    if (num_iter < 0)
+    {
+        logE<<"NNLS_Fit_Routine::fit_sparse_spectra: in optimization routine"<<"\n";
+    }
+
+    result = solver.getSolution();
+
+    std::vector<int> scratch;
+    const std::vector<int>& columns = _element_columns_of(elements_to_fit, scratch);
+    for(size_t k = 0; k < columns.size(); k++)
+    {
+        if (columns[k] > -1)
+        {
+            out_counts[k] = (*result)[columns[k]];
+        }
+    }
+
+    out_counts[columns.size()] = static_cast<real_t>(num_iter);
+    out_counts[columns.size() + 1] = npg;
+
+    //the fitted spectra is linear in the coefficients, sum them and expand once in finalize_integrated_spectra()
+    {
+        Integrated_Spectra_Accumulator* accumulator = _thread_accumulator();
+        if (result->allFinite() && accumulator->coefficients.size() == result->size())
+        {
+            accumulator->coefficients += result->cast<compute_t>();
+        }
+        if (has_background)
+        {
+            accumulator->fitted_spectra += background.cast<compute_t>();
+            accumulator->background += background.cast<compute_t>();
+        }
+    }
+
+    if (num_iter == solver.getMaxit())
+    {
+        return OPTIMIZER_OUTCOME::EXHAUSTED;
+    }
+    return OPTIMIZER_OUTCOME::CONVERGED;
+}
+
+// ----------------------------------------------------------------------------
+
+void NNLS_Fit_Routine::finalize_integrated_spectra()
+{
+    Matrix_Optimized_Fit_Routine::finalize_integrated_spectra();
+
+    ArrayXc coefficients = ArrayXc::Zero(_fitmatrix.cols());
+    {
+        std::lock_guard<std::mutex> lock(_accumulator_mutex);
+        for (const auto& accumulator : _accumulators)
+        {
+            if (accumulator->coefficients.size() == coefficients.size())
+            {
+                coefficients += accumulator->coefficients;
+            }
+        }
+    }
+    if (coefficients.size() > 0 && _integrated_fitted_spectra.size() == _fitmatrix.rows())
+    {
+        _integrated_fitted_spectra += (_fitmatrix.cast<compute_t>() * coefficients.matrix()).array().cast<real_t>();
+    }
+}
+
+// ----------------------------------------------------------------------------
+
 void NNLS_Fit_Routine::initialize(models::Base_Model * const model,
                                   const Fit_Element_Map_Dict * const elements_to_fit,
                                   const struct Range energy_range)
 {
     Matrix_Optimized_Fit_Routine::initialize(model, elements_to_fit, energy_range);
     _generate_fitmatrix();
+    _map_element_columns(elements_to_fit, _element_columns);
+    _element_columns_dict = elements_to_fit;
 }
 
 // ----------------------------------------------------------------------------
@@ -76,6 +76,29 @@ public:
                                         const Fit_Element_Map_Dict* const elements_to_fit,
                                         std::unordered_map<std::string, real_t>& out_counts);
 
+    virtual bool supports_sparse() const { return true; }
+
+    /// builds A'b from the nonzero channels and solves the normal equations
+    virtual OPTIMIZER_OUTCOME fit_sparse_spectra(const models::Base_Model * const model,
+                                                 const Spectra * const spectra,
+                                                 const Sparse_Spectra * const sparse_spectra,
+                                                 const Fit_Element_Map_Dict * const elements_to_fit,
+                                                 std::unordered_map<std::string, real_t>& out_counts);
+
+    virtual OPTIMIZER_OUTCOME fit_spectra_counts(const models::Base_Model * const model,
+                                                 const Spectra * const spectra,
+                                                 const Fit_Element_Map_Dict * const elements_to_fit,
+                                                 real_t* out_counts);
+
+    virtual OPTIMIZER_OUTCOME fit_sparse_spectra_counts(const models::Base_Model * const model,
+                                                        const Spectra * const spectra,
+                                                        const Sparse_Spectra * const sparse_spectra,
+                                                        const Fit_Element_Map_Dict * const elements_to_fit,
+                                                        real_t* out_counts);
+
+    /// also expands the coefficients summed by sparse pixels with the fit matrix
+    virtual void finalize_integrated_spectra();
+
     virtual std::string get_name() { return STR_FIT_NNLS; }
 
     virtual void initialize(models::Base_Model * const model,
@@ -86,14 +109,27 @@ protected:
 
     void _generate_fitmatrix();
 
+    /// _fitmatrix column of every element of elements_to_fit in iteration order, -1 for elements without a model
+    void _map_element_columns(const Fit_Element_Map_Dict * const elements_to_fit, std::vector<int>& columns) const;
+
+    /// the columns mapped in initialize() if elements_to_fit is that dict, otherwise mapped into scratch
+    const std::vector<int>& _element_columns_of(const Fit_Element_Map_Dict * const elements_to_fit, std::vector<int>& scratch) const;
+
 private:
 
     size_t _max_iter;
 
     Eigen::Matrix<real_t, Eigen::Dynamic, Eigen::Dynamic> _fitmatrix;
 
+    /// _fitmatrix' * _fitmatrix
+    Eigen::Matrix<real_t, Eigen::Dynamic, Eigen::Dynamic> _gram;
+
     std::unordered_map<std::string, int> _element_row_index;
 
+    std::vector<int> _element_columns;
+
+    const Fit_Element_Map_Dict* _element_columns_dict;
+
 };
 
 } //namespace routines
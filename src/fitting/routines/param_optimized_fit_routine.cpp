@@ -279,6 +279,15 @@ void Param_Optimized_Fit_Routine::initialize(models::Base_Model * const model,
                                              const struct Range energy_range)
 {
     _energy_range = energy_range;
+
+    if (model != nullptr && elements_to_fit != nullptr)
+    {
+        // same layout fit_spectra() builds, so the plan's parameter indices hit without lookups
+        Fit_Parameters fit_params = model->fit_parameters();
+        fit_params.add_parameter(Fit_Param(STR_NUM_ITR));
+        _add_elements_to_fit_parameters(&fit_params, nullptr, elements_to_fit);
+        model->compile_model_plan(elements_to_fit, &fit_params);
+    }
 }
 
 // ----------------------------------------------------------------------------
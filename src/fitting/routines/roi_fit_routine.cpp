@@ -74,37 +74,100 @@ optimizers::OPTIMIZER_OUTCOME ROI_Fit_Routine::fit_spectra(const models::Base_Mo
                                                             const Spectra * const spectra,
                                                             const Fit_Element_Map_Dict * const elements_to_fit,
                                                             std::unordered_map<std::string, real_t>& out_counts)
- {    
-    Fit_Parameters fitp = model->fit_parameters();
+{
+    std::vector<real_t> counts(elements_to_fit->size() + 2, (real_t)0.0);
+    optimizers::OPTIMIZER_OUTCOME ret = fit_spectra_counts(model, spectra, elements_to_fit, counts.data());
+    _counts_to_dict(elements_to_fit, counts.data(), false, out_counts);
+    return ret;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+optimizers::OPTIMIZER_OUTCOME ROI_Fit_Routine::fit_spectra_counts(const models::Base_Model * const model,
+                                                                   const Spectra * const spectra,
+                                                                   const Fit_Element_Map_Dict * const elements_to_fit,
+                                                                   real_t* out_counts)
+{
+    const Fit_Parameters& fitp = model->fit_parameters();
     unsigned int n_mca_channels = spectra->size();
 
     real_t energy_offset = fitp.value(STR_ENERGY_OFFSET);
     real_t energy_slope = fitp.value(STR_ENERGY_SLOPE);
+    size_t k = 0;
     for(const auto& e_itr : *elements_to_fit)
     {
         unsigned int left_roi = 0;
         unsigned int right_roi = 0;
-        Fit_Element_Map* element = e_itr.second;
-        left_roi = static_cast<unsigned int>(std::round( ( (element->center() - element->width()) - energy_offset) / energy_slope));
-        right_roi = static_cast<unsigned int>(std::round( ( (element->center() + element->width()) - energy_offset) / energy_slope));
-
-        if (right_roi >= n_mca_channels)
-        {
-            right_roi = n_mca_channels - 2;
-        }
-        if (left_roi > right_roi)
-        {
-            left_roi = right_roi - 1;
-        }
+        _roi_channels(e_itr.second, energy_offset, energy_slope, n_mca_channels, left_roi, right_roi);
 
         size_t spec_size = (right_roi - left_roi) + 1;
-        out_counts[e_itr.first] = spectra->segment(left_roi, spec_size).sum();
+        out_counts[k++] = spectra->segment(left_roi, spec_size).sum();
+    }
+    return optimizers::OPTIMIZER_OUTCOME::CONVERGED;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+optimizers::OPTIMIZER_OUTCOME ROI_Fit_Routine::fit_sparse_spectra(const models::Base_Model * const model,
+                                                                   const Spectra * const spectra,
+                                                                   const Sparse_Spectra * const sparse_spectra,
+                                                                   const Fit_Element_Map_Dict * const elements_to_fit,
+                                                                   std::unordered_map<std::string, real_t>& out_counts)
+{
+    std::vector<real_t> counts(elements_to_fit->size() + 2, (real_t)0.0);
+    optimizers::OPTIMIZER_OUTCOME ret = fit_sparse_spectra_counts(model, spectra, sparse_spectra, elements_to_fit, counts.data());
+    _counts_to_dict(elements_to_fit, counts.data(), false, out_counts);
+    return ret;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+optimizers::OPTIMIZER_OUTCOME ROI_Fit_Routine::fit_sparse_spectra_counts(const models::Base_Model * const model,
+                                                                          const Spectra * const spectra,
+                                                                          const Sparse_Spectra * const sparse_spectra,
+                                                                          const Fit_Element_Map_Dict * const elements_to_fit,
+                                                                          real_t* out_counts)
+{
+    if (sparse_spectra == nullptr || false == sparse_spectra->is_valid())
+    {
+        return fit_spectra_counts(model, spectra, elements_to_fit, out_counts);
+    }
+
+    const Fit_Parameters& fitp = model->fit_parameters();
+    unsigned int n_mca_channels = sparse_spectra->size();
+
+    real_t energy_offset = fitp.value(STR_ENERGY_OFFSET);
+    real_t energy_slope = fitp.value(STR_ENERGY_SLOPE);
+    size_t k = 0;
+    for(const auto& e_itr : *elements_to_fit)
+    {
+        unsigned int left_roi = 0;
+        unsigned int right_roi = 0;
+        _roi_channels(e_itr.second, energy_offset, energy_slope, n_mca_channels, left_roi, right_roi);
+        out_counts[k++] = sparse_spectra->sum(left_roi, right_roi);
     }
     return optimizers::OPTIMIZER_OUTCOME::CONVERGED;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 
+void ROI_Fit_Routine::_roi_channels(const Fit_Element_Map * const element, real_t energy_offset, real_t energy_slope, unsigned int n_mca_channels, unsigned int &left_roi, unsigned int &right_roi) const
+{
+    left_roi = static_cast<unsigned int>(std::round( ( (element->center() - element->width()) - energy_offset) / energy_slope));
+    right_roi = static_cast<unsigned int>(std::round( ( (element->center() + element->width()) - energy_offset) / energy_slope));
+
+    if (right_roi >= n_mca_channels)
+    {
+        right_roi = n_mca_channels - 2;
+    }
+    if (left_roi > right_roi)
+    {
+        left_roi = right_roi - 1;
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
 void ROI_Fit_Routine::initialize(models::Base_Model * const model,
                                  const Fit_Element_Map_Dict * const elements_to_fit,
                                  const struct Range energy_range)
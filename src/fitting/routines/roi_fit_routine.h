@@ -72,6 +72,26 @@ public:
                                                       std::unordered_map<std::string, real_t>& out_counts);
 
 
+    virtual bool supports_sparse() const { return true; }
+
+    /// sums only the nonzero channels of each roi
+    virtual optimizers::OPTIMIZER_OUTCOME fit_sparse_spectra(const models::Base_Model * const model,
+                                                             const Spectra * const spectra,
+                                                             const Sparse_Spectra * const sparse_spectra,
+                                                             const Fit_Element_Map_Dict * const elements_to_fit,
+                                                             std::unordered_map<std::string, real_t>& out_counts);
+
+    virtual optimizers::OPTIMIZER_OUTCOME fit_spectra_counts(const models::Base_Model * const model,
+                                                             const Spectra * const spectra,
+                                                             const Fit_Element_Map_Dict * const elements_to_fit,
+                                                             real_t* out_counts);
+
+    virtual optimizers::OPTIMIZER_OUTCOME fit_sparse_spectra_counts(const models::Base_Model * const model,
+                                                                    const Spectra * const spectra,
+                                                                    const Sparse_Spectra * const sparse_spectra,
+                                                                    const Fit_Element_Map_Dict * const elements_to_fit,
+                                                                    real_t* out_counts);
+
     virtual std::string get_name() { return STR_FIT_ROI; }
 
     virtual void initialize(models::Base_Model * const model,
@@ -80,8 +100,8 @@ public:
 
 protected:
 
-
-
+    /// first and last channel of the element roi
+    void _roi_channels(const Fit_Element_Map * const element, real_t energy_offset, real_t energy_slope, unsigned int n_mca_channels, unsigned int &left_roi, unsigned int &right_roi) const;
 
 private:
 
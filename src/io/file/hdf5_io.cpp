@@ -262,6 +262,119 @@ void HDF5_IO::_close_h5_objects(std::stack<std::pair<hid_t, H5_OBJECTS> >  &clos
 
 //-----------------------------------------------------------------------------
 
+bool HDF5_IO::_load_volume_contiguous(hid_t dset_id, hid_t dataspace_id, const hsize_t* dims_in, data_struct::Spectra_Volume* spec_vol)
+{
+    real_t* vol_data = spec_vol->contiguous_data(dims_in[0], dims_in[1], dims_in[2]);
+    if (vol_data == nullptr)
+    {
+        return false;
+    }
+
+    hid_t memoryspace_id = H5Screate_simple(3, dims_in, nullptr);
+    H5Sselect_all(dataspace_id);
+    herr_t error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, vol_data);
+    H5Sclose(memoryspace_id);
+    if (error < 0)
+    {
+        logW << "Could not read volume in one pass, reading row by row\n";
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool HDF5_IO::_load_volume_compact(hid_t dset_id, hid_t dataspace_id, const hsize_t* dims_in, data_struct::Spectra_Volume* spec_vol)
+{
+    if (false == spec_vol->allow_compact())
+    {
+        return false;
+    }
+
+    hid_t dtype_id = H5Dget_type(dset_id);
+    if (dtype_id < 0)
+    {
+        return false;
+    }
+    H5T_class_t dclass = H5Tget_class(dtype_id);
+    size_t dsize = H5Tget_size(dtype_id);
+    // signed counts can be negative (offset or background corrected), they would wrap in unsigned storage
+    H5T_sign_t dsign = (dclass == H5T_INTEGER) ? H5Tget_sign(dtype_id) : H5T_SGN_ERROR;
+    H5Tclose(dtype_id);
+    if (dclass != H5T_INTEGER || dsize > 4 || dsign != H5T_SGN_NONE)
+    {
+        return false;
+    }
+
+    data_struct::Volume_Storage storage = (dsize <= 2) ? data_struct::Volume_Storage::UINT16 : data_struct::Volume_Storage::UINT32;
+    spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2], storage);
+
+    hid_t memoryspace_id = H5Screate_simple(3, dims_in, nullptr);
+    H5Sselect_all(dataspace_id);
+    herr_t error;
+    if (storage == data_struct::Volume_Storage::UINT16)
+    {
+        error = H5Dread(dset_id, H5T_NATIVE_USHORT, memoryspace_id, dataspace_id, H5P_DEFAULT, spec_vol->compact_data_u16());
+    }
+    else
+    {
+        error = H5Dread(dset_id, H5T_NATIVE_UINT, memoryspace_id, dataspace_id, H5P_DEFAULT, spec_vol->compact_data_u32());
+    }
+    H5Sclose(memoryspace_id);
+    if (error < 0)
+    {
+        logW << "Could not read integer counts, loading as real values\n";
+        spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+        return false;
+    }
+    logI << "Keeping counts as " << (dsize <= 2 ? 16 : 32) << " bit integers\n";
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool HDF5_IO::_load_meta_plane(hid_t dset_id, hid_t dataspace_id, const hsize_t* offset, const hsize_t* count, data_struct::ArrayXXr& plane)
+{
+    hsize_t count_plane[2] = { (hsize_t)plane.rows(), (hsize_t)plane.cols() };
+    if (dset_id < 0 || plane.size() == 0)
+    {
+        return false;
+    }
+
+    // selection has to match the plane, otherwise the caller reads pixel by pixel
+    int rank = H5Sget_simple_extent_ndims(dataspace_id);
+    if (rank < 2)
+    {
+        return false;
+    }
+    std::vector<hsize_t> dims(rank);
+    H5Sget_simple_extent_dims(dataspace_id, dims.data(), nullptr);
+    hsize_t selected = 1;
+    for (int i = 0; i < rank; i++)
+    {
+        if (offset[i] + count[i] > dims[i])
+        {
+            return false;
+        }
+        selected *= count[i];
+    }
+    if (selected != (hsize_t)plane.size())
+    {
+        return false;
+    }
+
+    hid_t memoryspace_id = H5Screate_simple(2, count_plane, nullptr);
+    herr_t error = H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+    if (error > -1)
+    {
+        error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, plane.data());
+    }
+    H5Sclose(memoryspace_id);
+    return (error > -1);
+}
+
+//-----------------------------------------------------------------------------
+
 bool HDF5_IO::load_spectra_volume(std::string path, size_t detector_num, data_struct::Spectra_Volume* spec_vol)
 {
     std::lock_guard<std::mutex> lock(_mutex);
@@ -391,6 +504,19 @@ bool HDF5_IO::load_spectra_volume(std::string path, size_t detector_num, data_st
     real_t out_cnt = 1.0;
 
     offset_meta[0] = detector_num;
+
+    // meta data is detector x rows x cols, fill the volume planes in one pass each
+    hsize_t offset_plane[3] = { (hsize_t)detector_num, 0, 0 };
+    hsize_t count_plane[3] = { 1, (hsize_t)spec_vol->rows(), (hsize_t)spec_vol->cols() };
+    bool loaded_meta = _load_meta_plane(dset_lt_id, dataspace_lt_id, offset_plane, count_plane, spec_vol->elapsed_livetime())
+                    && _load_meta_plane(dset_rt_id, dataspace_rt_id, offset_plane, count_plane, spec_vol->elapsed_realtime())
+                    && _load_meta_plane(dset_incnt_id, dataspace_inct_id, offset_plane, count_plane, spec_vol->input_counts())
+                    && _load_meta_plane(dset_outcnt_id, dataspace_outct_id, offset_plane, count_plane, spec_vol->output_counts());
+    if (loaded_meta)
+    {
+        spec_vol->recalc_elapsed_livetime();
+    }
+
     for (size_t row=0; row < spec_vol->rows(); row++)
     {
          offset[1] = row;
@@ -406,23 +532,26 @@ bool HDF5_IO::load_spectra_volume(std::string path, size_t detector_num, data_st
                  offset_meta[2] = col;
                  data_struct::Spectra *spectra = &((*spec_vol)[row][col]);
 
-                 H5Sselect_hyperslab (dataspace_lt_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-                 error = H5Dread(dset_lt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_lt_id, H5P_DEFAULT, &live_time);
-                 spectra->elapsed_livetime(live_time);
+                 if (false == loaded_meta)
+                 {
+                     H5Sselect_hyperslab (dataspace_lt_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+                     error = H5Dread(dset_lt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_lt_id, H5P_DEFAULT, &live_time);
+                     spectra->elapsed_livetime(live_time);
 
-                 H5Sselect_hyperslab (dataspace_rt_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-                 error = H5Dread(dset_rt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_rt_id, H5P_DEFAULT, &real_time);
-                 spectra->elapsed_realtime(real_time);
+                     H5Sselect_hyperslab (dataspace_rt_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+                     error = H5Dread(dset_rt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_rt_id, H5P_DEFAULT, &real_time);
+                     spectra->elapsed_realtime(real_time);
 
-                 H5Sselect_hyperslab (dataspace_inct_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-                 error = H5Dread(dset_incnt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_inct_id, H5P_DEFAULT, &in_cnt);
-                 spectra->input_counts(in_cnt);
+                     H5Sselect_hyperslab (dataspace_inct_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+                     error = H5Dread(dset_incnt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_inct_id, H5P_DEFAULT, &in_cnt);
+                     spectra->input_counts(in_cnt);
 
-                 H5Sselect_hyperslab (dataspace_outct_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-                 error = H5Dread(dset_outcnt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_outct_id, H5P_DEFAULT, &out_cnt);
-                 spectra->output_counts(out_cnt);
+                     H5Sselect_hyperslab (dataspace_outct_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+                     error = H5Dread(dset_outcnt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_outct_id, H5P_DEFAULT, &out_cnt);
+                     spectra->output_counts(out_cnt);
 
-                 spectra->recalc_elapsed_livetime();
+                     spectra->recalc_elapsed_livetime();
+                 }
 
                  for(size_t s=0; s<count_row[0]; s++)
                  {
@@ -829,9 +958,17 @@ bool HDF5_IO::load_spectra_volume_confocal(std::string path, size_t detector_num
 		return false;
 	}
 
-    if(spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+    // integer counts are kept as integers when the volume allows it
+    bool loaded_contiguous = _load_volume_compact(dset_id, dataspace_id, dims_in, spec_vol);
+    if (false == loaded_contiguous)
     {
-        spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+        if (spec_vol->storage() != data_struct::Volume_Storage::REAL || spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+        {
+            spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+        }
+
+        // read the whole dataset straight into the volume buffer when the layouts match
+        loaded_contiguous = _load_volume_contiguous(dset_id, dataspace_id, dims_in, spec_vol);
     }
 
     if (false == confocal_ver_2020)
@@ -855,7 +992,25 @@ bool HDF5_IO::load_spectra_volume_confocal(std::string path, size_t detector_num
         delete[] det_dims_in;
     }
     error = H5Aread(attr_timebase_id, H5T_NATIVE_REAL, &time_base);
-    
+
+    bool loaded_meta = false;
+    if (false == confocal_ver_2020)
+    {
+        // detector scalers are rows x cols x names, fill the volume planes in one pass each
+        hsize_t offset_plane[3] = { 0, 0, (hsize_t)detector_lookup[elt_str] };
+        hsize_t count_plane[3] = { dims_in[0], dims_in[1], 1 };
+        loaded_meta = _load_meta_plane(dset_detectors_id, dataspace_detectors_id, offset_plane, count_plane, spec_vol->elapsed_livetime());
+        offset_plane[2] = detector_lookup[incnt_str];
+        loaded_meta = loaded_meta && _load_meta_plane(dset_detectors_id, dataspace_detectors_id, offset_plane, count_plane, spec_vol->input_counts());
+        offset_plane[2] = detector_lookup[outcnt_str];
+        loaded_meta = loaded_meta && _load_meta_plane(dset_detectors_id, dataspace_detectors_id, offset_plane, count_plane, spec_vol->output_counts());
+        if (loaded_meta)
+        {
+            spec_vol->elapsed_livetime() /= time_base;
+            spec_vol->input_counts() *= (real_t)1000.0;
+            spec_vol->output_counts() *= (real_t)1000.0;
+        }
+    }
 
     count[0] = 1; //1 row
 
@@ -881,8 +1036,12 @@ bool HDF5_IO::load_spectra_volume_confocal(std::string path, size_t detector_num
          offset[0] = row;
          offset_meta[0] = row;
 
-         H5Sselect_hyperslab (dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
-         error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+         error = 0;
+         if (false == loaded_contiguous)
+         {
+             H5Sselect_hyperslab (dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+             error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+         }
 
          if (error > -1 )
          {
@@ -918,7 +1077,7 @@ bool HDF5_IO::load_spectra_volume_confocal(std::string path, size_t detector_num
                          spectra->output_counts(out_cnt);
                      }
                  }
-                 else
+                 else if (false == loaded_meta)
                  {
                      offset_meta[2] = detector_lookup[elt_str];
                      H5Sselect_hyperslab(dataspace_detectors_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
@@ -937,9 +1096,12 @@ bool HDF5_IO::load_spectra_volume_confocal(std::string path, size_t detector_num
                      spectra->output_counts(out_cnt * 1000.0);
                  }
 
-                 for(size_t s=0; s<dims_in[2]; s++)
+                 if (false == loaded_contiguous)
                  {
-                     (*spectra)[s] = buffer[(col * dims_in[2] ) + s];
+                     for(size_t s=0; s<dims_in[2]; s++)
+                     {
+                         (*spectra)[s] = buffer[(col * dims_in[2] ) + s];
+                     }
                  }
              }
          }
@@ -1154,9 +1316,17 @@ bool HDF5_IO::load_spectra_volume_gsecars(std::string path, size_t detector_num,
 		return false;
 	}
 
-	if (spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+	// integer counts are kept as integers when the volume allows it
+	bool loaded_contiguous = _load_volume_compact(dset_id, dataspace_id, dims_in, spec_vol);
+	if (false == loaded_contiguous)
 	{
-		spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+		if (spec_vol->storage() != data_struct::Volume_Storage::REAL || spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+		{
+			spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+		}
+
+		// read the whole dataset straight into the volume buffer when the layouts match
+		loaded_contiguous = _load_volume_contiguous(dset_id, dataspace_id, dims_in, spec_vol);
 	}
 
 	count[0] = 1; //1 row
@@ -1173,14 +1343,25 @@ bool HDF5_IO::load_spectra_volume_gsecars(std::string path, size_t detector_num,
 	real_t in_cnt = 1.0;
 	real_t out_cnt = 1.0;
 
+	// meta data is rows x cols, fill the volume planes in one pass each
+	hsize_t offset_plane[2] = { 0, 0 };
+	hsize_t count_plane[2] = { dims_in[0], dims_in[1] };
+	bool loaded_meta = _load_meta_plane(realtime_id, realtime_dataspace_id, offset_plane, count_plane, spec_vol->elapsed_realtime())
+					&& _load_meta_plane(livetime_id, livetime_dataspace_id, offset_plane, count_plane, spec_vol->elapsed_livetime())
+					&& _load_meta_plane(inpcounts_id, inpcounts_dataspace_id, offset_plane, count_plane, spec_vol->input_counts())
+					&& _load_meta_plane(outcounts_id, outcounts_dataspace_id, offset_plane, count_plane, spec_vol->output_counts());
 
 	for (size_t row = 0; row < dims_in[0]; row++)
 	{
 		offset[0] = row;
 		offset_meta[0] = row;
 
-		H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
-		error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+		error = 0;
+		if (false == loaded_contiguous)
+		{
+			H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+			error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+		}
 
 		if (error > -1) //no error
 		{
@@ -1190,37 +1371,43 @@ bool HDF5_IO::load_spectra_volume_gsecars(std::string path, size_t detector_num,
 
 				data_struct::Spectra* spectra = &((*spec_vol)[row][col]);
 				
-				H5Sselect_hyperslab(livetime_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-				H5Sselect_hyperslab(realtime_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-				H5Sselect_hyperslab(inpcounts_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-				H5Sselect_hyperslab(outcounts_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
-
-				error = H5Dread(realtime_id, H5T_NATIVE_REAL, memoryspace_meta_id, realtime_dataspace_id, H5P_DEFAULT, &real_time);
-				if (error > -1)
-				{
-					spectra->elapsed_realtime(real_time);
-				}
-				error = H5Dread(livetime_id, H5T_NATIVE_REAL, memoryspace_meta_id, livetime_dataspace_id, H5P_DEFAULT, &live_time);
-				if (error > -1)
-				{
-					spectra->elapsed_livetime(live_time);
-				}
-				error = H5Dread(inpcounts_id, H5T_NATIVE_REAL, memoryspace_meta_id, inpcounts_dataspace_id, H5P_DEFAULT, &in_cnt);
-				if (error > -1)
+				if (false == loaded_meta)
 				{
-					spectra->input_counts(in_cnt);
-				}
-				error = H5Dread(outcounts_id, H5T_NATIVE_REAL, memoryspace_meta_id, outcounts_dataspace_id, H5P_DEFAULT, &out_cnt);
-				if (error > -1)
-				{
-					spectra->output_counts(out_cnt);
+					H5Sselect_hyperslab(livetime_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+					H5Sselect_hyperslab(realtime_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+					H5Sselect_hyperslab(inpcounts_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+					H5Sselect_hyperslab(outcounts_dataspace_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
+
+					error = H5Dread(realtime_id, H5T_NATIVE_REAL, memoryspace_meta_id, realtime_dataspace_id, H5P_DEFAULT, &real_time);
+					if (error > -1)
+					{
+						spectra->elapsed_realtime(real_time);
+					}
+					error = H5Dread(livetime_id, H5T_NATIVE_REAL, memoryspace_meta_id, livetime_dataspace_id, H5P_DEFAULT, &live_time);
+					if (error > -1)
+					{
+						spectra->elapsed_livetime(live_time);
+					}
+					error = H5Dread(inpcounts_id, H5T_NATIVE_REAL, memoryspace_meta_id, inpcounts_dataspace_id, H5P_DEFAULT, &in_cnt);
+					if (error > -1)
+					{
+						spectra->input_counts(in_cnt);
+					}
+					error = H5Dread(outcounts_id, H5T_NATIVE_REAL, memoryspace_meta_id, outcounts_dataspace_id, H5P_DEFAULT, &out_cnt);
+					if (error > -1)
+					{
+						spectra->output_counts(out_cnt);
+					}
 				}
-				
+
 				//spectra->recalc_elapsed_livetime();
 
-				for (size_t s = 0; s < dims_in[2]; s++)
+				if (false == loaded_contiguous)
 				{
-					(*spectra)[s] = buffer[(col * dims_in[2]) + s];
+					for (size_t s = 0; s < dims_in[2]; s++)
+					{
+						(*spectra)[s] = buffer[(col * dims_in[2]) + s];
+					}
 				}
 			}
 		}
@@ -1391,9 +1578,17 @@ bool HDF5_IO::load_spectra_volume_bnl(std::string path, size_t detector_num, dat
         return false;
     }
 
-    if (spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+    // integer counts are kept as integers when the volume allows it
+    bool loaded_contiguous = _load_volume_compact(dset_id, dataspace_id, dims_in, spec_vol);
+    if (false == loaded_contiguous)
     {
-        spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+        if (spec_vol->storage() != data_struct::Volume_Storage::REAL || spec_vol->rows() < dims_in[0] || spec_vol->cols() < dims_in[1] || spec_vol->samples_size() < dims_in[2])
+        {
+            spec_vol->resize_and_zero(dims_in[0], dims_in[1], dims_in[2]);
+        }
+
+        // read the whole dataset straight into the volume buffer when the layouts match
+        loaded_contiguous = _load_volume_contiguous(dset_id, dataspace_id, dims_in, spec_vol);
     }
 
     count[0] = 1; //1 row
@@ -1416,8 +1611,12 @@ bool HDF5_IO::load_spectra_volume_bnl(std::string path, size_t detector_num, dat
         offset[0] = row;
         offset_meta[0] = row;
 
-        H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
-        error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+        error = 0;
+        if (false == loaded_contiguous)
+        {
+            H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+            error = H5Dread(dset_id, H5T_NATIVE_REAL, memoryspace_id, dataspace_id, H5P_DEFAULT, buffer);
+        }
 
         if (error > -1) //no error
         {
@@ -1455,9 +1654,12 @@ bool HDF5_IO::load_spectra_volume_bnl(std::string path, size_t detector_num, dat
 
                 //spectra->recalc_elapsed_livetime();
                 */
-                for (size_t s = 0; s < dims_in[2]; s++)
+                if (false == loaded_contiguous)
                 {
-                    (*spectra)[s] = buffer[(col * dims_in[2]) + s];
+                    for (size_t s = 0; s < dims_in[2]; s++)
+                    {
+                        (*spectra)[s] = buffer[(col * dims_in[2]) + s];
+                    }
                 }
             }
         }
@@ -2347,7 +2549,8 @@ bool HDF5_IO::load_spectra_volume_emd_with_callback(std::string path,
 bool HDF5_IO::load_spectra_volume_with_callback(std::string path,
 												const std::vector<size_t>& detector_num_arr,
 												data_struct::IO_Callback_Func_Def callback_func,
-                                                void* user_data)
+                                                void* user_data,
+                                                data_struct::IO_Spectra_Alloc_Func_Def alloc_func)
 {
     std::lock_guard<std::mutex> lock(_mutex);
 
@@ -2494,7 +2697,7 @@ bool HDF5_IO::load_spectra_volume_with_callback(std::string path,
                  for(size_t detector_num : detector_num_arr)
                  {
                      offset_meta[0] = detector_num;
-                     data_struct::Spectra * spectra = new data_struct::Spectra(dims_in[0]);
+                     data_struct::Spectra * spectra = (alloc_func != nullptr) ? alloc_func(dims_in[0]) : new data_struct::Spectra(dims_in[0]);
 
                      H5Sselect_hyperslab (dataspace_lt_id, H5S_SELECT_SET, offset_meta, nullptr, count_meta, nullptr);
                      error = H5Dread(dset_lt_id, H5T_NATIVE_REAL, memoryspace_meta_id, dataspace_lt_id, H5P_DEFAULT, &live_time);
@@ -2674,10 +2877,13 @@ bool HDF5_IO::load_and_integrate_spectra_volume(std::string path, size_t detecto
      real_t in_cnt = 1.0;
      real_t out_cnt = 1.0;
 
-     real_t live_time_total = 0.0;
-     real_t real_time_total = 0.0;
-     real_t in_cnt_total = 0.0;
-     real_t out_cnt_total = 0.0;
+     compute_t live_time_total = 0.0;
+     compute_t real_time_total = 0.0;
+     compute_t in_cnt_total = 0.0;
+     compute_t out_cnt_total = 0.0;
+
+     // sum in compute_t, the float spectra only gets the rounded total
+     data_struct::ArrayXc sums = spectra->cast<compute_t>();
 
      offset_meta[0] = detector_num;
      for (size_t row=0; row < dims_in[1]; row++)
@@ -2712,7 +2918,7 @@ bool HDF5_IO::load_and_integrate_spectra_volume(std::string path, size_t detecto
 
                   for(size_t s=0; s<count_row[0]; s++)
                   {
-                      (*spectra)[s] += buffer[(count_row[1] * s) + col];
+                      sums[s] += buffer[(count_row[1] * s) + col];
                   }
               }
 
@@ -2724,6 +2930,7 @@ bool HDF5_IO::load_and_integrate_spectra_volume(std::string path, size_t detecto
           }
      }
 
+     static_cast<data_struct::Spectra::TMapXr&>(*spectra) = sums.cast<real_t>();
      spectra->elapsed_livetime(live_time_total);
      spectra->elapsed_realtime(real_time_total);
      spectra->input_counts(in_cnt_total);
@@ -4270,6 +4477,7 @@ bool HDF5_IO::save_spectra_volume(const std::string path,
     real_t life_time;
     real_t in_cnt;
     real_t out_cnt;
+    data_struct::Spectra pixel;
     for(size_t row=row_idx_start; row < (size_t)row_idx_end; row++)
     {
         offset[1] = row;
@@ -4277,6 +4485,11 @@ bool HDF5_IO::save_spectra_volume(const std::string path,
         for(size_t col=col_idx_start; col < (size_t)col_idx_end; col++)
         {
             const data_struct::Spectra *spectra = &((*spectra_volume)[row][col]);
+            if (spectra_volume->storage() != data_struct::Volume_Storage::REAL)
+            {
+                spectra_volume->pixel_spectra(row, col, pixel);
+                spectra = &pixel;
+            }
             offset[2] = col;
             offset_time[1] = col;
             H5Sselect_hyperslab (dataspace_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
@@ -4427,7 +4640,7 @@ bool HDF5_IO::save_spectra_volume(const std::string path,
 //-----------------------------------------------------------------------------
 
 bool HDF5_IO::save_element_fits(std::string path,
-                                const data_struct::Fit_Count_Dict * const element_counts,
+                                const data_struct::Fit_Count_Volume * const element_counts,
                                 size_t row_idx_start,
                                 int row_idx_end,
                                 size_t col_idx_start,
@@ -4435,53 +4648,43 @@ bool HDF5_IO::save_element_fits(std::string path,
 {
     std::lock_guard<std::mutex> lock(_mutex);
 
-    
-
     if(_cur_file_id < 0)
     {
         logE << "hdf5 file was never initialized. Call start_save_seq() before this function." << "\n";
         return false;
     }
 
+    if(element_counts->num_channels() == 0)
+    {
+        logW << "No fit counts to save for " << path << "\n";
+        return false;
+    }
+
     std::chrono::time_point<std::chrono::system_clock> start, end;
     start = std::chrono::system_clock::now();
     std::string xrf_grp_name = "XRF_Analyzed";
     hid_t   dset_id, dset_ch_id, dset_un_id;
-    hid_t   memoryspace, filespace, dataspace_id, dataspace_ch_id, dataspace_ch_off_id;
+    hid_t   memoryspace, filespace, dataspace_id, dataspace_ch_id, memoryspace_ch;
     hid_t   filetype, memtype, status;
     hid_t   dcpl_id;
     hid_t   xrf_grp_id, fit_grp_id, maps_grp_id;
-    //herr_t   error;
 
     dset_id = -1;
     dset_ch_id = -1;
     hsize_t dims_out[3];
     hsize_t offset[1] = {0};
-    hsize_t offset2[1] = {0};
     hsize_t offset_3d[3] = {0, 0, 0};
     hsize_t count[1] = {1};
-    hsize_t count_3d[3] = {1, 1, 1};
     hsize_t chunk_dims[3];
 	hsize_t tmp_dims[3];
 
-    //fix this
-    for(const auto& iter : *element_counts)
-    {
-		dims_out[1] = iter.second.rows();
-		dims_out[2] = iter.second.cols();
-        break;
-    }
-    //H5T_FLOAT
-
-    dims_out[0] = element_counts->size();
-    offset_3d[0] = 0;
-    offset_3d[1] = 0;
-    offset_3d[2] = 0;
-    count_3d[0] = 1;
-    count_3d[1] = dims_out[1];
-    count_3d[2] = dims_out[2];
+    //channels are already in save order, [channel][row][col]
+    dims_out[0] = element_counts->num_channels();
+    dims_out[1] = element_counts->rows();
+    dims_out[2] = element_counts->cols();
+    count[0] = dims_out[0];
     chunk_dims[0] = 1;
-    chunk_dims[1] = dims_out[1]; 
+    chunk_dims[1] = dims_out[1];
     chunk_dims[2] = dims_out[2];
 
 	hsize_t      maxdims[3] = {H5S_UNLIMITED, H5S_UNLIMITED, H5S_UNLIMITED };
@@ -4490,13 +4693,11 @@ bool HDF5_IO::save_element_fits(std::string path,
     H5Pset_chunk(dcpl_id, 3, chunk_dims);
     H5Pset_deflate (dcpl_id, 7);
 
-    memoryspace = H5Screate_simple(3, count_3d, nullptr);
+    memoryspace = H5Screate_simple(3, dims_out, nullptr);
     filespace = H5Screate_simple(3, dims_out, nullptr);
 
     dataspace_ch_id = H5Screate_simple (1, dims_out, nullptr);
-    dataspace_ch_off_id = H5Screate_simple (1, dims_out, nullptr);
-
-    H5Sselect_hyperslab (memoryspace, H5S_SELECT_SET, offset_3d, nullptr, count_3d, nullptr);
+    memoryspace_ch = H5Screate_simple (1, dims_out, nullptr);
 
     maps_grp_id = H5Gopen(_cur_file_id, "MAPS", H5P_DEFAULT);
     if(maps_grp_id < 0)
@@ -4583,99 +4784,30 @@ bool HDF5_IO::save_element_fits(std::string path,
 		return false;
 	}
 
-/*
-   if (row_idx_end < row_idx_start || row_idx_end > spectra_volume->rows() -1)
-    {
-        row_idx_end = spectra_volume->rows();
-    }
-    if (col_idx_end < col_idx_start || col_idx_end > spectra_volume->cols() -1)
-    {
-        col_idx_end = spectra_volume->cols();
-    }
-*/
-
-    //create save ordered vector by element Z number with K , L, M lines
-    std::vector<std::string> element_lines;
-    for (std::string el_name : data_struct::Element_Symbols)
-    {
-        element_lines.push_back(el_name);
-    }
-    for (std::string el_name : data_struct::Element_Symbols)
-    {
-        element_lines.push_back(el_name+"_L");
-    }
-    for (std::string el_name : data_struct::Element_Symbols)
-    {
-        element_lines.push_back(el_name+"_M");
-    }
-
-    //add pileups
-    for (const auto& itr : *element_counts)
-    {
-        if( std::find(element_lines.begin(), element_lines.end(), itr.first) == element_lines.end() )
-        {
-            element_lines.push_back(itr.first);
-        }
-
-        /*
-        int idx = itr.first.find("_");
-        int len = itr.first.length();
-        if(idx > -1)
-        {
-            std::string e1 = itr.first.substr(0, idx);
-            std::string e2 = itr.first.substr(idx+1, len);
-            auto it1 = std::find(element_lines.begin(), element_lines.end(), e1);
-            auto it2 = std::find(element_lines.begin(), element_lines.end(), e2);
-            if(it1 != element_lines.end() && it2 != element_lines.end())
-            {
-                element_lines.push_back(itr.first);
-            }
-        }
-        */
-    }
-/*
-    element_lines.push_back(STR_COHERENT_SCT_AMPLITUDE);
-    element_lines.push_back(STR_COMPTON_AMPLITUDE);
-	element_lines.push_back(STR_SUM_ELASTIC_INELASTIC_AMP);
-    element_lines.push_back(STR_TOTAL_FLUORESCENCE_YIELD);
-    element_lines.push_back(STR_NUM_ITR);
-*/
-    int i=0;
-    //save by element Z order
-    //for(const auto& iter : *element_counts)
+    //names and units packed in 255 char records so each goes out in one write
+    std::vector<char> names_buf(dims_out[0] * 255, '\0');
+    std::vector<char> units_buf(dims_out[0] * 255, '\0');
 	std::string units = "cts/s";
-    for (std::string el_name : element_lines)
+    for (size_t i = 0; i < dims_out[0]; i++)
     {
-        char tmp_char[256] = {0};
-        if(element_counts->count(el_name) < 1 )
-        {
-            continue;
-        }
-        offset[0] = i;
-        offset_3d[0] = i;
-
-        H5Sselect_hyperslab (dataspace_ch_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
-        H5Sselect_hyperslab (dataspace_ch_off_id, H5S_SELECT_SET, offset2, nullptr, count, nullptr);
-
-        el_name.copy(tmp_char, 254);
-
-        status = H5Dwrite (dset_ch_id, memtype, dataspace_ch_off_id, dataspace_ch_id, H5P_DEFAULT, (void*)tmp_char);
-
-		for (int z = 0; z < 256; z++)
-		{
-			tmp_char[z] = '\0';
-		}
+        const std::string& el_name = element_counts->channel_name((int)i);
+        el_name.copy(&names_buf[i * 255], 254);
 		if (el_name != STR_NUM_ITR && el_name != STR_RESIDUAL)
 		{
-			units.copy(tmp_char, 256);
+			units.copy(&units_buf[i * 255], 254);
 		}
-		status = H5Dwrite(dset_un_id, memtype, dataspace_ch_off_id, dataspace_ch_id, H5P_DEFAULT, (void*)tmp_char);
+    }
 
-        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset_3d, nullptr, chunk_dims, nullptr);
+    H5Sselect_hyperslab (dataspace_ch_id, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+    status = H5Dwrite (dset_ch_id, memtype, memoryspace_ch, dataspace_ch_id, H5P_DEFAULT, (void*)&names_buf[0]);
+    status = H5Dwrite (dset_un_id, memtype, memoryspace_ch, dataspace_ch_id, H5P_DEFAULT, (void*)&units_buf[0]);
 
-        status = H5Dwrite(dset_id, H5T_NATIVE_REAL, memoryspace, filespace, H5P_DEFAULT, (void*)element_counts->at(el_name).data());
-        
-        i++;
+    //whole cube in one write
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset_3d, nullptr, dims_out, nullptr);
+    status = H5Dwrite(dset_id, H5T_NATIVE_REAL, memoryspace, filespace, H5P_DEFAULT, (void*)element_counts->data());
+    if (status < 0)
+    {
+        logE << "writing MAPS/" << xrf_grp_name << "/" << path << "/Counts_Per_Sec" << "\n";
     }
 
     H5Dclose(dset_id);
@@ -4683,7 +4815,7 @@ bool HDF5_IO::save_element_fits(std::string path,
 	H5Dclose(dset_un_id);
     H5Sclose(memoryspace);
     H5Sclose(filespace);
-    H5Sclose(dataspace_ch_off_id);
+    H5Sclose(memoryspace_ch);
     H5Sclose(dataspace_ch_id);
     H5Tclose(filetype);
     H5Tclose(memtype);
@@ -4699,7 +4831,7 @@ bool HDF5_IO::save_element_fits(std::string path,
     logI << "elapsed time: " << elapsed_seconds.count() << "s"<<"\n";
 
 
-    return true;
+    return (status > -1);
 
 }
 
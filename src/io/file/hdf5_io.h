@@ -58,6 +58,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "hdf5.h"
 #include "data_struct/spectra_volume.h"
 #include "data_struct/fit_element_map.h"
+#include "data_struct/fit_count_volume.h"
 #include "data_struct/detector.h"
 #include "data_struct/params_override.h"
 #include "data_struct/scan_info.h"
@@ -89,7 +90,8 @@ public:
     bool load_spectra_volume_with_callback(std::string path,
 											const std::vector<size_t>& detector_num_arr,
 										   data_struct::IO_Callback_Func_Def callback_func,
-                                           void* user_data);
+                                           void* user_data,
+                                           data_struct::IO_Spectra_Alloc_Func_Def alloc_func = nullptr);
 
 	bool load_spectra_volume_emd_with_callback(std::string path,
 												const std::vector<size_t>& detector_num_arr,
@@ -171,7 +173,7 @@ public:
                              int col_idx_end=-1);
 
     bool save_element_fits(const std::string path,
-                           const data_struct::Fit_Count_Dict * const element_counts,
+                           const data_struct::Fit_Count_Volume * const element_counts,
                            size_t row_idx_start=0,
                            int row_idx_end=-1,
                            size_t col_idx_start=0,
@@ -272,6 +274,15 @@ private:
     bool _open_h5_object(hid_t &id, H5_OBJECTS obj, std::stack<std::pair<hid_t, H5_OBJECTS> > &close_map, std::string s1, hid_t id2, bool log_error=true, bool close_on_fail=true);
     void _close_h5_objects(std::stack<std::pair<hid_t, H5_OBJECTS> > &close_map);
 
+    /// read a rows x cols x samples dataset straight into the volume buffer, false if the layouts differ or the read fails
+    bool _load_volume_contiguous(hid_t dset_id, hid_t dataspace_id, const hsize_t* dims_in, data_struct::Spectra_Volume* spec_vol);
+
+    /// if the volume allows it and the dataset holds integers, resize the volume to compact storage and read the counts in one pass
+    bool _load_volume_compact(hid_t dset_id, hid_t dataspace_id, const hsize_t* dims_in, data_struct::Spectra_Volume* spec_vol);
+
+    /// read the offset/count selection of a meta data dataset into a rows x cols volume plane in one pass
+    bool _load_meta_plane(hid_t dset_id, hid_t dataspace_id, const hsize_t* offset, const hsize_t* count, data_struct::ArrayXXr& plane);
+
     hid_t _cur_file_id;
     std::string _cur_filename;
 
@@ -154,7 +154,14 @@ bool init_analysis_job_detectors(data_struct::Analysis_Job* analysis_job)
 
         if (detector->model == nullptr)
         {
-            detector->model = new fitting::models::Gaussian_Model();
+            fitting::models::Gaussian_Model* model = new fitting::models::Gaussian_Model();
+            if (analysis_job->line_window_sigmas >= 0.0)
+            {
+                model->set_line_window(analysis_job->line_window_sigmas);
+            }
+            // the detector model is evaluated from the thread pool workers, one thread per spectra
+            model->set_threading(fitting::models::Model_Threading::SINGLE);
+            detector->model = model;
         }
         data_struct::Params_Override * override_params = &(detector->fit_params_override_dict);
 
@@ -413,17 +420,10 @@ void save_optimized_fit_params(std::string dataset_dir, std::string dataset_file
         logE << "Fit Parameters == nullptr. Can not save!\n";
 		return;
     }
-	else
+	else if (fit_params->size() == 0)
 	{
-		unordered_map<string, Fit_Param> * params = fit_params->Params();
-		if (params != nullptr)
-		{
-			if (params->size() == 0)
-			{
-				logE << "Fit Parameters size = 0. Can not save!\n";
-				return;
-			}
-		}
+		logE << "Fit Parameters size = 0. Can not save!\n";
+		return;
 	}
 
     if (spectra == nullptr)
@@ -441,9 +441,9 @@ void save_optimized_fit_params(std::string dataset_dir, std::string dataset_file
     fitting::models::Gaussian_Model model;
     //Range of energy in spectra to fit
     fitting::models::Range energy_range = data_struct::get_energy_range(spectra->size(), fit_params);
-    data_struct::Spectra snip_spectra = spectra->sub_spectra(energy_range.min, energy_range.count());
+    data_struct::ArrayXr snip_spectra = spectra->segment(energy_range.min, energy_range.count());
 
-    data_struct::Spectra model_spectra = model.model_spectrum_mp(fit_params, elements_to_fit, energy_range);
+    data_struct::ArrayXr model_spectra = model.model_spectrum_mp(fit_params, elements_to_fit, energy_range);
     data_struct::ArrayXr background;
 
     real_t energy_offset = fit_params->value(STR_ENERGY_OFFSET);
@@ -1156,6 +1156,8 @@ bool load_and_integrate_spectra_volume(std::string dataset_directory,
     std::replace(dataset_directory.begin(), dataset_directory.end(), '/', DIR_END_CHAR);
 
     data_struct::Spectra_Volume spectra_volume;
+    // only integrated, integer counts can stay integers
+    spectra_volume.set_allow_compact(true);
 
     logI<<"Loading dataset "<<dataset_directory+"mda"+ DIR_END_CHAR +dataset_file<<"\n";
 
@@ -1375,6 +1377,8 @@ bool load_and_integrate_spectra_volume(std::string dataset_directory,
                 std::string full_filename;
                 data_struct::Spectra_Line spectra_line;
                 spectra_line.resize_and_zero(dims[1], integrated_spectra->size());
+                data_struct::Spectra_Accumulator accumulator(integrated_spectra->size());
+                accumulator.add_samples(*integrated_spectra);
                 for(size_t i=0; i<dims[0]; i++)
                 {
                     full_filename = dataset_directory + "flyXspress"+ DIR_END_CHAR + tmp_dataset_file + file_middle + std::to_string(i) + ".h5";
@@ -1382,10 +1386,11 @@ bool load_and_integrate_spectra_volume(std::string dataset_directory,
                     {
                         for(size_t k=0; k<spectra_line.size(); k++)
                         {
-                            *integrated_spectra += spectra_line[k];
+                            accumulator.add_samples(spectra_line[k]);
                         }
                     }
                 }
+                static_cast<data_struct::Spectra::TMapXr&>(*integrated_spectra) = accumulator.sums().cast<real_t>();
             }
         }
     }
@@ -459,7 +459,8 @@ bool MDA_IO::load_spectra_volume_with_callback(std::string path,
                                                  size_t &out_rows,
                                                  size_t &out_cols,
 												 data_struct::IO_Callback_Func_Def callback_func,
-                                                 void *user_data)
+                                                 void *user_data,
+                                                 data_struct::IO_Spectra_Alloc_Func_Def alloc_func)
 {
 	// detector , index
 	map<size_t, const data_struct::ArrayXXr*> elt_arr_map;
@@ -643,7 +644,7 @@ bool MDA_IO::load_spectra_volume_with_callback(std::string path,
 
                 for(size_t detector_num : detector_num_arr)
                 {
-                    data_struct::Spectra* spectra = new data_struct::Spectra(samples);
+                    data_struct::Spectra* spectra = (alloc_func != nullptr) ? alloc_func(samples) : new data_struct::Spectra(samples);
 
                     if (is_single_row)
                     {
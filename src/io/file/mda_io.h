@@ -92,7 +92,8 @@ public:
                                         size_t& out_rows,
                                         size_t& out_cols,
 										data_struct::IO_Callback_Func_Def callback_func,
-                                        void *user_data);
+                                        void *user_data,
+                                        data_struct::IO_Spectra_Alloc_Func_Def alloc_func = nullptr);
 
 	bool load_integrated_spectra(std::string path,
 								size_t detector_num,
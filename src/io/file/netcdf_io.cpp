@@ -288,7 +288,8 @@ bool NetCDF_IO::load_spectra_line_with_callback(std::string path,
                                                 size_t max_rows,
                                                 size_t max_cols,
                                                 data_struct::IO_Callback_Func_Def callback_fun,
-                                                void* user_data)
+                                                void* user_data,
+                                                data_struct::IO_Spectra_Alloc_Func_Def alloc_func)
 {
 
     std::lock_guard<std::mutex> lock(_mutex);
@@ -437,7 +438,7 @@ bool NetCDF_IO::load_spectra_line_with_callback(std::string path,
             ii = i1 | i2<<16;
             output_counts[detector_num] = ((float)ii) / elapsed_realtime[detector_num];
 
-            data_struct::Spectra * spectra = new data_struct::Spectra(spectra_size);
+            data_struct::Spectra * spectra = (alloc_func != nullptr) ? alloc_func(spectra_size) : new data_struct::Spectra(spectra_size);
 
             spectra->elapsed_livetime(elapsed_livetime[detector_num]);
             spectra->elapsed_realtime(elapsed_realtime[detector_num]);
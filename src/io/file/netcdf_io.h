@@ -88,7 +88,8 @@ public:
                                         size_t max_rows,
                                         size_t max_cols,
                                         data_struct::IO_Callback_Func_Def callback_fun,
-                                        void* user_data);
+                                        void* user_data,
+                                        data_struct::IO_Spectra_Alloc_Func_Def alloc_func = nullptr);
 
     size_t load_spectra_line_integrated(std::string path, size_t detector, size_t line_size, data_struct::Spectra* spectra);
 
@@ -128,7 +128,8 @@ data_struct::Stream_Block* Basic_Serializer::_decode_meta(char* message, size_t
     memcpy(&theta, message + idx, sizeof(real_t));
     idx += sizeof(real_t);
 
-    data_struct::Stream_Block* out_stream_block = new data_struct::Stream_Block(detector_number, row, col, height, width);
+    // recycled from the block pool, sinks release them back
+    data_struct::Stream_Block* out_stream_block = data_struct::Stream_Block_Pool::inst()->acquire_block(detector_number, row, col, height, width);
 
     //find dataset name
     for(size_t i=idx; i < message_len; i++)
@@ -365,7 +366,7 @@ void Basic_Serializer::_decode_spectra(char* message, size_t message_len, size_t
         logE<<"spectra_size < 1!\n";
         return;
     }
-    out_stream_block->spectra = new data_struct::Spectra(spectra_size);
+    out_stream_block->spectra = data_struct::Stream_Block_Pool::inst()->acquire_spectra(spectra_size);
     out_stream_block->spectra->elapsed_livetime(elt);
     out_stream_block->spectra->elapsed_realtime(ert);
     out_stream_block->spectra->input_counts(incnt);
@@ -52,6 +52,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "core/defines.h"
 #include "data_struct/stream_block.h"
+#include "data_struct/stream_block_pool.h"
 
 namespace io
 {
@@ -715,7 +715,9 @@ template <typename _T>
 void lmmin(const int n, _T* x, const int m, const void* data,
            void (*evaluate)(const _T* par, const int m_dat,
                             const void* data, _T* fvec, int* userbreak),
-           const lm_control_struct<_T>* C, lm_status_struct<_T>* S)
+           const lm_control_struct<_T>* C, lm_status_struct<_T>* S,
+           void (*jacobian)(const _T* par, const int m_dat, const void* data,
+                            _T* fjac, int* analytic, int* userbreak) = NULL)
 /*
  *   This routine contains the core algorithm of our library.
  *
@@ -752,6 +754,12 @@ void lmmin(const int n, _T* x, const int m, const void* data,
  *
  *      status contains OUTPUT variables that inform about the fit result,
  *        as declared and explained in lmstruct.h
+ *
+ *      jacobian is an optional user-supplied function that calculates
+ *        columns of the Jacobian d fvec[i] / d par[j] analytically.
+ *        It stores column j at fjac[j*m_dat] and sets analytic[j] to 1
+ *        for every column it filled, the others are approximated by
+ *        forward differences as without it.
  */
 {
     int j, i;
@@ -824,7 +832,7 @@ void lmmin(const int n, _T* x, const int m, const void* data,
 
     /* Allocate total workspace with just one system call */
     char* ws;
-    if ((ws = (char*)malloc((2*m + 5*n + m*n) * sizeof(_T) + n * sizeof(int))) == NULL)
+    if ((ws = (char*)malloc((2*m + 5*n + m*n) * sizeof(_T) + 2 * n * sizeof(int))) == NULL)
     {
         S->outcome = 9;
         return;
@@ -850,6 +858,8 @@ void lmmin(const int n, _T* x, const int m, const void* data,
     pws += m * sizeof(_T) / sizeof(char);
     int* Pivot = (int*)pws;
     pws += n * sizeof(int) / sizeof(char);
+    int* Analytic = (int*)pws;
+    pws += n * sizeof(int) / sizeof(char);
 
     /* Initialize diag. */
     if (!C->scale_diag)
@@ -886,7 +896,16 @@ void lmmin(const int n, _T* x, const int m, const void* data,
     for (int outer = 0;; ++outer) {
 
         /** Calculate the Jacobian. **/
+        for (j = 0; j < n; j++)
+            Analytic[j] = 0;
+        if (jacobian != NULL) {
+            (*jacobian)(x, m, data, fjac, Analytic, &(S->userbreak));
+            if (S->userbreak)
+                goto terminate;
+        }
         for (j = 0; j < n; j++) {
+            if (Analytic[j])
+                continue;
             temp = x[j];
             step = MAX(eps * eps, eps * std::fabs(temp));
             x[j] += step; /* replace temporarily */
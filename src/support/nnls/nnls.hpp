@@ -25,6 +25,8 @@
 // Argonne National Lab
 // Dec 2017 : Modified to make it template class and use Eigen data structures
 #include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
 
 namespace nsNNLS 
 {
@@ -47,6 +49,8 @@ namespace nsNNLS
 			this->b = b;
 			this->maxit = maxit; 
 			this->x0 = nullptr;
+			normal_eq = false;
+			btb = 0;
 			out.iter = -1;
 			fset = 0;
 			// convergence controlling parameters
@@ -57,6 +61,26 @@ namespace nsNNLS
 			sigma = .01;
 		}
 
+        // Normal equations form: A is A'A, b is A'b and btb is b'b. Every iteration then costs
+        // n x n instead of rows x n, A'b can be built from the nonzero rows of b only.
+        nnls(Eigen::Matrix<_T, Eigen::Dynamic, Eigen::Dynamic> *AtA, TArrayXr *Atb, _T btb, int maxit)
+        {
+            this->A = AtA;
+            this->b = Atb;
+            this->maxit = maxit;
+            this->x0 = nullptr;
+            normal_eq = true;
+            this->btb = btb;
+            out.iter = -1;
+            fset = 0;
+            // convergence controlling parameters
+            M = 100;
+            beta = 1.0;
+            decay = 0.9;
+            pgtol = 1e-3;
+            sigma = .01;
+        }
+
         nnls(Eigen::Matrix<_T, Eigen::Dynamic, Eigen::Dynamic> *A, TArrayXr *b, TArrayXr* x0, int maxit)
 		{
 			nnls(A, b, maxit);
@@ -143,6 +167,8 @@ namespace nsNNLS
         TArrayXr *b;
         TArrayXr ax;                 // vector to hold A*x
 		size_t* fset;               // fixed set 
+		bool normal_eq;             // A and b hold A'A and A'b
+		_T btb;                     // b'b in normal equations form
 		size_t fssize;              // sizeof fixed set
 
 		// The parameters of the solver
@@ -193,9 +219,10 @@ namespace nsNNLS
 			{
 				oldg.setZero();
 				x = (*x0);
-				ax = (*A) * x.matrix();
-				ax -= (*b);
-				gradient = A->transpose() * ax.matrix();
+			}
+			else if (normal_eq)
+			{
+				oldg = -(*b);
 			}
 			else
 			{
@@ -205,9 +232,7 @@ namespace nsNNLS
 			}
 
 			// old gradient = A'*(ax - b)
-			ax = (*A) * x.matrix();
-			ax -= (*b);
-			gradient = A->transpose() * ax.matrix();
+			computeGrad();
 
 			// Set the reference iterations
 			refx = x;
@@ -271,14 +296,34 @@ namespace nsNNLS
 			oldg = gradient;
 		}
 
-		void computeObjGrad()
+		void computeGrad()
 		{
+			if (normal_eq)
+			{
+				gradient = ((*A) * x.matrix()).array() - (*b); // A'A x - A'b
+				return;
+			}
 			ax = (*A) * x.matrix();
 			ax -= (*b);        // ax = ax - b
-			_T d = (ax*ax).sum();
+			gradient = A->transpose() * ax.matrix(); // A'(ax)
+		}
+
+		void computeObjGrad()
+		{
+			computeGrad();
+			_T d;
+			if (normal_eq)
+			{
+				// |Ax - b|^2 = x'(A'A x - A'b) - x'A'b + b'b
+				d = (x * gradient).sum() - (x * (*b)).sum() + btb;
+				d = std::max(d, (_T)0.0);
+			}
+			else
+			{
+				d = (ax*ax).sum();
+			}
 			d = std::sqrt(d);
 			out.obj[out.iter] =  (0.5 * d * d);
-			gradient = A->transpose() * ax.matrix(); // A'(ax)
 		}
 
 		_T computeBBStep()
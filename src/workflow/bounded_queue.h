@@ -0,0 +1,261 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+#ifndef Bounded_Queue_H
+#define Bounded_Queue_H
+
+#include "core/defines.h"
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace workflow
+{
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief Thread safe FIFO with an optional maximum size. push() blocks the producer while the queue is full
+///        and keeps track of how often and how long it had to wait. Consumers can block in wait_pop()
+///        until there is data or the queue is closed. Once closed push() rejects new data.
+///
+template<typename T>
+class DLL_EXPORT Bounded_Queue
+{
+
+public:
+
+    /// max_size of 0 means unbounded
+    Bounded_Queue(size_t max_size = 0)
+    {
+        _max_size = max_size;
+        _closed = false;
+        _stall_count = 0;
+        _stall_seconds = 0.0;
+    }
+
+    Bounded_Queue(const Bounded_Queue &) = delete;
+
+    Bounded_Queue& operator=(const Bounded_Queue&) = delete;
+
+    ~Bounded_Queue()
+    {
+
+    }
+
+    void set_max_size(size_t max_size)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _max_size = max_size;
+        }
+        _not_full.notify_all();
+    }
+
+    size_t max_size()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _max_size;
+    }
+
+    /// returns false and leaves val untouched if the queue is closed, before or while waiting for room
+    bool push(T&& val)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if(false == _closed && _is_full())
+        {
+            std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            _not_full.wait(lock, [this]{ return this->_closed || !this->_is_full(); });
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            _stall_count++;
+            _stall_seconds += elapsed.count();
+        }
+        if(_closed)
+        {
+            return false;
+        }
+        _queue.emplace(std::move(val));
+        lock.unlock();
+        _not_empty.notify_one();
+        return true;
+    }
+
+    bool try_pop(T& out)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if(_queue.empty())
+            {
+                return false;
+            }
+            out = std::move(_queue.front());
+            _queue.pop();
+        }
+        _not_full.notify_one();
+        return true;
+    }
+
+    /// move everything currently queued into out
+    void pop_all(std::queue<T> *out)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(!_queue.empty())
+            {
+                out->emplace(std::move(_queue.front()));
+                _queue.pop();
+            }
+        }
+        _not_full.notify_all();
+    }
+
+    /// block until there is data or the queue is closed, returns false once closed and empty
+    bool wait_pop(T& out)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_empty.wait(lock, [this]{ return this->_closed || !this->_queue.empty(); });
+            if(_queue.empty())
+            {
+                return false;
+            }
+            out = std::move(_queue.front());
+            _queue.pop();
+        }
+        _not_full.notify_one();
+        return true;
+    }
+
+    /// same as wait_pop() but takes everything that is queued
+    bool wait_pop_all(std::queue<T> *out)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_empty.wait(lock, [this]{ return this->_closed || !this->_queue.empty(); });
+            if(_queue.empty())
+            {
+                return false;
+            }
+            while(!_queue.empty())
+            {
+                out->emplace(std::move(_queue.front()));
+                _queue.pop();
+            }
+        }
+        _not_full.notify_all();
+        return true;
+    }
+
+    /// wake up all waiting consumers and producers, wait_pop() returns false after the remaining data is taken
+    void close()
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _not_empty.notify_all();
+        _not_full.notify_all();
+    }
+
+    void open()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _closed = false;
+    }
+
+    bool empty()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _queue.empty();
+    }
+
+    size_t size()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _queue.size();
+    }
+
+    /// number of times push() had to wait for room
+    size_t stall_count()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _stall_count;
+    }
+
+    /// total time push() spent waiting for room
+    double stall_seconds()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _stall_seconds;
+    }
+
+protected:
+
+    inline bool _is_full() { return _max_size > 0 && _queue.size() >= _max_size; }
+
+    std::mutex _mutex;
+
+    std::condition_variable _not_full;
+
+    std::condition_variable _not_empty;
+
+    std::queue<T> _queue;
+
+    size_t _max_size;
+
+    bool _closed;
+
+    size_t _stall_count;
+
+    double _stall_seconds;
+
+};
+
+} //namespace workflow
+
+#endif // Bounded_Queue_H
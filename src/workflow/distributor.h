@@ -52,6 +52,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "core/defines.h"
 #include "threadpool.h"
+#include "workflow/bounded_queue.h"
 #include <functional>
 
 namespace workflow
@@ -64,9 +65,9 @@ class DLL_EXPORT Distributor
 
 public:
 
-    Distributor(size_t num_threads)
+    Distributor(size_t num_threads, Thread_Pool_Mode pool_mode = Thread_Pool_Mode::SHARED_QUEUE)
     {
-        _thread_pool = new ThreadPool(num_threads);
+        _thread_pool = new ThreadPool(num_threads, pool_mode);
         _callback_func = std::bind(&Distributor::distribute, this, std::placeholders::_1);
     }
 
@@ -85,12 +86,34 @@ public:
         delete _thread_pool;
     }
 
+    // blocks the caller while the job queue is full. The queue does its own locking, holding a lock
+    // of ours across a full push would stall every other producer until the sink makes room
     void distribute(T_IN input)
     {
-        std::unique_lock<std::mutex> lock(_queue_mutex);
-        _job_queue.emplace( _thread_pool->enqueue(_dist_func, input) );
+        std::future<T_OUT> job = _thread_pool->enqueue(_dist_func, input);
+        if (false == _job_queue.push(std::move(job)))
+        {
+            // the queue was closed, nobody will consume this job. Wait for it and hand its output back
+            T_OUT output = job.get();
+            if (_release_func != nullptr)
+            {
+                _release_func(output);
+            }
+        }
     }
 
+    /// called with the output of jobs distributed after the queue was closed, set by Sink::connect
+    void set_release_function(std::function<void (T_OUT)> func) { _release_func = func; }
+
+    // maximum number of jobs waiting for the sink, 0 = unlimited
+    void set_max_queue_size(size_t max_size) { _job_queue.set_max_size(max_size); }
+
+    size_t max_queue_size() { return _job_queue.max_size(); }
+
+    size_t producer_stall_count() { return _job_queue.stall_count(); }
+
+    double producer_stall_seconds() { return _job_queue.stall_seconds(); }
+
     std::function<void (T_IN)> get_callback_func()
     {
         return _callback_func;
@@ -103,35 +126,44 @@ public:
 
     inline bool is_queue_empty() { return _job_queue.empty(); }
 
+    // blocks until a job is queued, returns T_OUT() once the queue is closed and drained
     T_OUT front_pop()
     {
-        std::unique_lock<std::mutex> lock(_queue_mutex);
-        auto ret = std::move(_job_queue.front());
-        _job_queue.pop();
+        std::future<T_OUT> ret;
+        if (false == _job_queue.wait_pop(ret))
+        {
+            return T_OUT();
+        }
         return ret.get();
     }
 
     void front_chunk(std::queue<std::future<T_OUT> > *queue)
     {
-        std::unique_lock<std::mutex> lock(_queue_mutex);
-        while(! _job_queue.empty() )
-        {
-            queue->emplace( std::move(_job_queue.front()) );
-            _job_queue.pop();
-        }
+        _job_queue.pop_all(queue);
+    }
+
+    // blocks until jobs are queued, returns false when the queue was closed and is drained
+    bool wait_front_chunk(std::queue<std::future<T_OUT> > *queue)
+    {
+        return _job_queue.wait_pop_all(queue);
     }
 
+    // no more input will be distributed, wakes up anyone in wait_front_chunk
+    void close_queue() { _job_queue.close(); }
+
+    void open_queue() { _job_queue.open(); }
+
 protected:
 
     std::function<void (T_IN)> _callback_func;
 
     std::function<T_OUT (T_IN)> _dist_func;
 
-    ThreadPool *_thread_pool;
+    std::function<void (T_OUT)> _release_func;
 
-    std::mutex _queue_mutex;
+    ThreadPool *_thread_pool;
 
-    std::queue<std::future<T_OUT> > _job_queue;
+    Bounded_Queue<std::future<T_OUT> > _job_queue;
 
 };
 
@@ -45,66 +45,388 @@ POSSIBILITY OF SUCH DAMAGE.
 
 /// Initial Author <2017>: Arthur Glowacki
 
-
-
 #ifndef Pipeline_H
 #define Pipeline_H
 
 #include "core/defines.h"
 #include "workflow/source.h"
-#include "workflow/distributor.h"
 #include "workflow/sink.h"
+#include "workflow/bounded_queue.h"
+#include "workflow/telemetry.h"
+#include "core/cpu_info.h"
+#include <map>
+#include <memory>
+#include <atomic>
 
 namespace workflow
 {
 
 //-----------------------------------------------------------------------------
-template <typename _T>
-class DLL_EXPORT Simple_Pipeline
+
+///
+/// \brief N stage pipeline: Source -> stage 0 -> ... -> stage N-1 -> Sink.
+///        Every stage has its own worker threads and a bounded input queue so that
+///        loading, processing and saving overlap on separate cores.
+///        When ordered (default) the sink receives items in the order the source produced them,
+///        the source is held back while more than the max queue size of items are ahead of the oldest unsent one.
+///        Every step records block counts, queue depth, time in queue and processing time in telemetry().
+///
+template <typename T>
+class DLL_EXPORT Pipeline
 {
 
 public:
 
-    Simple_Pipeline(int num_threads)
+    Pipeline()
+    {
+        _source = nullptr;
+        _sink = nullptr;
+        _ordered = true;
+        _pin_threads = false;
+        _next_seq = 0;
+        _sent_seq = 0;
+        _reorder_window = 0;
+        _output_queue.reset(new Bounded_Queue<Item>());
+        _source_telemetry = _telemetry.add_stage("source", [this]{ return this->_first_queue()->size(); });
+        _sink_telemetry = nullptr;
+    }
+
+    Pipeline(const Pipeline &) = delete;
+
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    ~Pipeline()
     {
-        _distributor = new Distributor<_T, _T>(num_threads);
+        _telemetry.stop_reporting();
+        _stop_threads();
+    }
 
-        _producer.connect(_distributor->get_callback_func());
-        _distributor->connect(_sink.get_job_queue());
+    /// append a stage that runs func on num_threads threads, max_queue_size of 0 means unbounded
+    void add_stage(std::string name, std::function<T (T)> func, size_t num_threads, size_t max_queue_size = 0)
+    {
+        Stage *stage = new Stage();
+        stage->name = name;
+        stage->func = func;
+        stage->num_threads = std::max((size_t)1, num_threads);
+        stage->input.set_max_size(max_queue_size);
+        stage->active_threads = 0;
+        Bounded_Queue<Item> *input = &(stage->input);
+        stage->telemetry = _telemetry.add_stage(name, [input]{ return input->size(); });
+        _stages.emplace_back(stage);
     }
 
-    ~Simple_Pipeline()
+    size_t num_stages() { return _stages.size(); }
+
+    void connect_source(Source<T> *source)
     {
-        delete _distributor;
+        _source = source;
+        _source->connect(std::bind(&Pipeline::push, this, std::placeholders::_1),
+                         std::bind(&Pipeline::set_max_queue_size, this, std::placeholders::_1));
     }
 
-    void set_producer_func(std::function<_T (void*)> func)
+    void connect_sink(Sink<T> *sink)
     {
-        _producer.set_function(func);
+        _sink = sink;
     }
 
-    void set_distributor_func(std::function<_T (_T)> func)
+    /// if false the sink receives items as soon as the last stage finishes them
+    void set_ordered(bool val) { _ordered = val; }
+
+    /// pin stage workers and the sink thread round robin over the numa nodes
+    void set_pin_threads(bool val) { _pin_threads = val; }
+
+    /// split max_size items between the stage input queues. In ordered mode at most max_size items
+    /// are in flight past the oldest unsent one, so one slow item can not grow the reorder buffer to the whole scan
+    void set_max_queue_size(size_t max_size)
     {
-        _distributor->set_function(func);
+        {
+            std::unique_lock<std::mutex> lock(_window_mutex);
+            _reorder_window = max_size;
+        }
+        _window_cond.notify_all();
+        size_t per_stage = max_size;
+        if(_stages.size() > 0)
+        {
+            per_stage = std::max((size_t)1, max_size / _stages.size());
+        }
+        for(auto &stage : _stages)
+        {
+            stage->input.set_max_size(per_stage);
+        }
+        _output_queue->set_max_size(per_stage);
     }
 
-    void set_sink_func(std::function<void (_T)> func)
+    /// feed an item into the first stage, blocks while its queue is full
+    void push(T val)
     {
-        _sink.set_function(func);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        // time the source spent producing this item since the previous push
+        _source_telemetry->process_time.add(_last_push, now);
+        Item item;
+        item.seq = _next_seq++;
+        item.val = val;
+        item.queued = now;
+        if(_ordered)
+        {
+            std::unique_lock<std::mutex> lock(_window_mutex);
+            _window_cond.wait(lock, [this, &item]{ return this->_reorder_window == 0 || item.seq < this->_sent_seq + this->_reorder_window; });
+        }
+        if(false == _first_queue()->push(std::move(item)))
+        {
+            // pipeline is shutting down, the item never enters a stage
+            _release(item.val);
+            return;
+        }
+        _last_push = std::chrono::steady_clock::now();
+        _source_telemetry->queue_time.add(now, _last_push);
+        _source_telemetry->blocks_out++;
     }
 
+    /// start all stages, run the source and wait until everything reached the sink
     void run()
     {
-        _sink.start();
-        _producer.run();
-        _sink.wait_and_stop();
+        _start_threads();
+        if(_source != nullptr)
+        {
+            _source->run();
+        }
+        _stop_threads();
+    }
+
+    size_t producer_stall_count()
+    {
+        return _stages.size() > 0 ? _stages[0]->input.stall_count() : _output_queue->stall_count();
     }
 
+    double producer_stall_seconds()
+    {
+        return _stages.size() > 0 ? _stages[0]->input.stall_seconds() : _output_queue->stall_seconds();
+    }
+
+    /// counters for the source, every stage and the sink
+    Telemetry* telemetry() { return &_telemetry; }
+
 protected:
 
-    Source<_T> _producer;
-    Distributor<_T, _T> *_distributor;
-    Sink<_T> _sink;
+    struct Item
+    {
+        size_t seq;
+        T val;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    struct Stage
+    {
+        std::string name;
+        std::function<T (T)> func;
+        size_t num_threads;
+        Bounded_Queue<Item> input;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> active_threads;
+        Stage_Telemetry *telemetry;
+    };
+
+    Bounded_Queue<Item>* _first_queue()
+    {
+        if(_stages.size() > 0)
+        {
+            return &(_stages[0]->input);
+        }
+        return _output_queue.get();
+    }
+
+    Bounded_Queue<Item>* _stage_output(size_t idx)
+    {
+        if(idx + 1 < _stages.size())
+        {
+            return &(_stages[idx + 1]->input);
+        }
+        return _output_queue.get();
+    }
+
+    void _start_threads()
+    {
+        std::vector<size_t> cores;
+        size_t next_core = 0;
+        if(_pin_threads)
+        {
+            cores = get_interleaved_cores();
+        }
+        _next_seq = 0;
+        _sent_seq = 0;
+        _last_push = std::chrono::steady_clock::now();
+        if(_sink_telemetry == nullptr)
+        {
+            Bounded_Queue<Item> *output = _output_queue.get();
+            _sink_telemetry = _telemetry.add_stage("sink", [output]{ return output->size(); });
+        }
+        _output_queue->open();
+        for(size_t i = 0; i < _stages.size(); i++)
+        {
+            Stage *stage = _stages[i].get();
+            stage->input.open();
+            stage->active_threads = stage->num_threads;
+            for(size_t t = 0; t < stage->num_threads; t++)
+            {
+                int core = _pin_threads ? (int)cores[next_core++ % cores.size()] : -1;
+                stage->threads.emplace_back([this, i, core]{ this->_stage_worker(i, core); });
+            }
+        }
+        int core = _pin_threads ? (int)cores[next_core % cores.size()] : -1;
+        _output_thread = std::thread([this, core]{ this->_output_worker(core); });
+    }
+
+    // close the first queue and let the end of input ripple through the stages
+    void _stop_threads()
+    {
+        if(_stages.size() > 0)
+        {
+            _stages[0]->input.close();
+        }
+        else
+        {
+            _output_queue->close();
+        }
+        for(auto &stage : _stages)
+        {
+            for(std::thread &thread : stage->threads)
+            {
+                thread.join();
+            }
+            stage->threads.clear();
+        }
+        if(_output_thread.joinable())
+        {
+            _output_thread.join();
+        }
+    }
+
+    void _stage_worker(size_t idx, int core)
+    {
+        if(core > -1)
+        {
+            pin_current_thread(core);
+        }
+        Stage *stage = _stages[idx].get();
+        Bounded_Queue<Item> *output = _stage_output(idx);
+        Item item;
+        Stage_Telemetry *telemetry = stage->telemetry;
+        while(stage->input.wait_pop(item))
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            telemetry->blocks_in++;
+            telemetry->queue_time.add(item.queued, start);
+            item.val = stage->func(item.val);
+            item.queued = std::chrono::steady_clock::now();
+            telemetry->process_time.add(start, item.queued);
+            telemetry->blocks_out++;
+            if(false == output->push(std::move(item)))
+            {
+                _release(item.val);
+            }
+        }
+        // last worker of this stage tells the next one no more input is coming
+        if(--stage->active_threads == 0)
+        {
+            output->close();
+        }
+    }
+
+    void _output_worker(int core)
+    {
+        if(core > -1)
+        {
+            pin_current_thread(core);
+        }
+        std::map<size_t, T> reorder_buffer;
+        size_t next_seq = 0;
+        Item item;
+        while(_output_queue->wait_pop(item))
+        {
+            _sink_telemetry->blocks_in++;
+            _sink_telemetry->queue_time.add(item.queued, std::chrono::steady_clock::now());
+            if(false == _ordered)
+            {
+                _send_to_sink(item.val);
+                continue;
+            }
+            reorder_buffer[item.seq] = item.val;
+            auto itr = reorder_buffer.begin();
+            if(itr->first != next_seq)
+            {
+                continue;
+            }
+            while(itr != reorder_buffer.end() && itr->first == next_seq)
+            {
+                _send_to_sink(itr->second);
+                itr = reorder_buffer.erase(itr);
+                next_seq++;
+            }
+            // let the source run ahead again
+            {
+                std::unique_lock<std::mutex> lock(_window_mutex);
+                _sent_seq = next_seq;
+            }
+            _window_cond.notify_all();
+        }
+        for(auto &itr : reorder_buffer)
+        {
+            _send_to_sink(itr.second);
+        }
+    }
+
+    // hand back an item that was rejected by a closed queue
+    void _release(T val)
+    {
+        if(_sink != nullptr)
+        {
+            _sink->release_block(val);
+        }
+    }
+
+    void _send_to_sink(T val)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(_sink != nullptr)
+        {
+            _sink->sink_function(val);
+        }
+        _sink_telemetry->process_time.add(start, std::chrono::steady_clock::now());
+        _sink_telemetry->blocks_out++;
+    }
+
+    Source<T> *_source;
+
+    Sink<T> *_sink;
+
+    std::vector<std::unique_ptr<Stage> > _stages;
+
+    std::unique_ptr<Bounded_Queue<Item> > _output_queue;
+
+    std::thread _output_thread;
+
+    std::atomic<size_t> _next_seq;
+
+    /// ordered mode : items below _sent_seq reached the sink, the source waits while _next_seq - _sent_seq >= _reorder_window
+    size_t _sent_seq;
+
+    size_t _reorder_window;
+
+    std::mutex _window_mutex;
+
+    std::condition_variable _window_cond;
+
+    Telemetry _telemetry;
+
+    Stage_Telemetry *_source_telemetry;
+
+    Stage_Telemetry *_sink_telemetry;
+
+    std::chrono::steady_clock::time_point _last_push;
+
+    bool _ordered;
+
+    bool _pin_threads;
 
 };
 
@@ -54,6 +54,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <functional>
 #include <future>
 #include <thread>
+#include <atomic>
 #include "workflow/distributor.h"
 
 namespace workflow
@@ -72,6 +73,7 @@ public:
         _thread = nullptr;
         _running = false;
         _delete_block = true;
+        _release_func = nullptr;
     }
 
 	Sink(const Sink &)
@@ -88,19 +90,34 @@ public:
     {
         if(_thread != nullptr)
         {
-            _thread->join();
-            delete _thread;
+            stop();
         }
         _thread = nullptr;
     }
 
     void set_delete_block(bool val) { _delete_block = val; }
 
+    /// called instead of delete once a block is consumed, lets a pool recycle it
+    void set_release_function(std::function<void (T_IN)> func) { _release_func = func; }
+
+    /// give back a block that will never reach sink_function
+    void release_block(T_IN val)
+    {
+        if(val != nullptr)
+        {
+            _release(val);
+        }
+    }
+
     template<typename _T>
     void connect(Distributor<_T, T_IN> *distributor)
     {
         _check_func = std::bind(&Distributor<_T, T_IN>::is_queue_empty, distributor);
-        _get_func = std::bind(&Distributor<_T, T_IN>::front_chunk, distributor, std::placeholders::_1);
+        _get_func = std::bind(&Distributor<_T, T_IN>::wait_front_chunk, distributor, std::placeholders::_1);
+        _close_func = std::bind(&Distributor<_T, T_IN>::close_queue, distributor);
+        _open_func = std::bind(&Distributor<_T, T_IN>::open_queue, distributor);
+        // jobs distributed after stop() closed the queue are released here instead of leaking
+        distributor->set_release_function(std::bind(&Sink<T_IN>::release_block, this, std::placeholders::_1));
         //_get_func = std::bind(&Distributor<_T, T_IN>::front_pop, distributor);
     }
 
@@ -115,26 +132,27 @@ public:
         {
             stop();
         }
+        if(_open_func != nullptr)
+        {
+            _open_func();
+        }
         std::packaged_task<void(void)> task([this](){ this->_execute(); });
         _running = true;
         _thread = new std::thread(std::move(task));
     }
 
+    // stop after the chunk currently being processed
     void stop()
     {
         _running = false;
-        _thread->join();
-        delete _thread;
-        _thread = nullptr;
+        _join();
     }
 
+    // call once the source is done, processes everything still queued then stops
     void wait_and_stop()
     {
-        while( _check_func() == false || !_job_queue.empty())
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(400));
-        }
-        stop();
+        _join();
+        _running = false;
     }
 
     void sink_function(T_IN val)
@@ -143,19 +161,45 @@ public:
 		// if sink thread is not running we have to delete the stream_block
 		if (_delete_block && _running == false)
 		{
-			delete val;
+			_release(val);
 		}
     }
 
 protected:
 
+    void _release(T_IN val)
+    {
+        if(_release_func != nullptr)
+        {
+            _release_func(val);
+        }
+        else
+        {
+            delete val;
+        }
+    }
+
+    void _join()
+    {
+        if(_close_func != nullptr)
+        {
+            _close_func();
+        }
+        if(_thread != nullptr)
+        {
+            _thread->join();
+            delete _thread;
+            _thread = nullptr;
+        }
+    }
+
     void _execute()
     {
         while(_running)
         {
-            if( _check_func() == false)
+            // sleeps until the distributor queues jobs, false once it is closed and drained
+            if( _get_func(&_job_queue) )
             {
-                _get_func(&_job_queue);
                 while(! _job_queue.empty())
                 {
                     auto ret = std::move(_job_queue.front());
@@ -166,29 +210,56 @@ protected:
 
                     if(_delete_block && input_block != nullptr)
                     {
-                        delete input_block;
+                        _release(input_block);
 						input_block = nullptr;
                     }
                 }
             }
             else
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                break;
+            }
+        }
+        _drain();
+    }
+
+    // stopped before the distributor was drained : nobody will consume the jobs still queued,
+    // hand their blocks to the release function so pooled blocks are not lost
+    void _drain()
+    {
+        do
+        {
+            while(! _job_queue.empty())
+            {
+                auto ret = std::move(_job_queue.front());
+                _job_queue.pop();
+                T_IN input_block = ret.get();
+                if(input_block != nullptr)
+                {
+                    _release(input_block);
+                }
             }
         }
+        while( _get_func(&_job_queue) );
     }
 
 
     std::function<bool (void)> _check_func;
 
-    std::function<void (std::queue<std::future<T_IN> > *)> _get_func;
+    std::function<bool (std::queue<std::future<T_IN> > *)> _get_func;
+
+    std::function<void (void)> _close_func;
+
+    std::function<void (void)> _open_func;
     //std::function<T_IN (void)> _get_func;
 
     std::function<void (T_IN)> _callback_func;
 
+    std::function<void (T_IN)> _release_func;
+
     std::queue<std::future<T_IN> > _job_queue;
 
-    bool _running;
+    std::atomic<bool> _running;
 
     std::thread *_thread;
 
@@ -71,6 +71,7 @@ public:
     Source()
     {
         _output_callback_func = nullptr;
+        _output_queue_size_func = nullptr;
     }
 
     virtual ~Source()
@@ -82,11 +83,20 @@ public:
     void connect(Distributor<T_OUT, _T> *distributor)
     {
         _output_callback_func = std::bind(&Distributor<T_OUT, _T>::distribute, distributor, std::placeholders::_1);
+        _output_queue_size_func = std::bind(&Distributor<T_OUT, _T>::set_max_queue_size, distributor, std::placeholders::_1);
     }
 
     void connect(Sink<T_OUT> *sink)
     {
         _output_callback_func = std::bind(&Sink<T_OUT>::sink_function, sink, std::placeholders::_1);
+        _output_queue_size_func = nullptr;
+    }
+
+    /// connect to any consumer, queue_size_func is called with the number of outputs that may be queued
+    void connect(Callback_Func_Def out_callback_func, std::function<void (size_t)> queue_size_func = nullptr)
+    {
+        _output_callback_func = out_callback_func;
+        _output_queue_size_func = queue_size_func;
     }
 
     template<typename _T>
@@ -101,11 +111,6 @@ public:
     }
 
 /*
-    void connect( Callback_Func_Def out_callback_func)
-    {
-        _output_callback_func = out_callback_func;
-    }
-
     void set_function(Source_Func_Def func)
     {
         _prod_func = func;
@@ -127,8 +132,19 @@ public:
 */
 protected:
 
+    // limit how many outputs can be queued downstream before _output_callback_func blocks
+    void _set_max_output_queue_size(size_t max_size)
+    {
+        if(_output_queue_size_func != nullptr)
+        {
+            _output_queue_size_func(max_size);
+        }
+    }
+
     Callback_Func_Def _output_callback_func;
 
+    std::function<void (size_t)> _output_queue_size_func;
+
 };
 
 } //namespace workflow
@@ -0,0 +1,385 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+
+/// Initial Author <2017>: Arthur Glowacki
+
+#include "telemetry.h"
+#include <sstream>
+#include <algorithm>
+
+namespace workflow
+{
+
+//-----------------------------------------------------------------------------
+
+Latency_Histogram::Latency_Histogram()
+{
+    reset();
+}
+
+//-----------------------------------------------------------------------------
+
+void Latency_Histogram::add(double seconds)
+{
+    unsigned long long us = seconds > 0.0 ? (unsigned long long)(seconds * 1000000.0) : 0;
+    size_t bucket = 0;
+    unsigned long long val = us >> 1;
+    while (val > 0 && bucket < NUM_BUCKETS - 1)
+    {
+        val >>= 1;
+        bucket++;
+    }
+    _buckets[bucket]++;
+    _count++;
+    _total_us += us;
+    unsigned long long cur_max = _max_us;
+    while (us > cur_max && false == _max_us.compare_exchange_weak(cur_max, us))
+    {
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Latency_Histogram::add(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    add(std::chrono::duration<double>(end - start).count());
+}
+
+//-----------------------------------------------------------------------------
+
+void Latency_Histogram::reset()
+{
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _total_us = 0;
+    _max_us = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+double Latency_Histogram::mean_ms() const
+{
+    size_t cnt = _count;
+    if (cnt == 0)
+    {
+        return 0.0;
+    }
+    return ((double)_total_us / (double)cnt) / 1000.0;
+}
+
+//-----------------------------------------------------------------------------
+
+double Latency_Histogram::percentile_ms(double p) const
+{
+    size_t cnt = _count;
+    if (cnt == 0)
+    {
+        return 0.0;
+    }
+    size_t target = (size_t)(p * (double)cnt);
+    size_t sum = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        sum += _buckets[i];
+        if (sum > target)
+        {
+            return std::min((double)(2ULL << i) / 1000.0, max_ms());
+        }
+    }
+    return max_ms();
+}
+
+//-----------------------------------------------------------------------------
+
+std::string Latency_Histogram::to_json() const
+{
+    std::stringstream ss;
+    ss << "{\"count\":" << count() << ",\"mean_ms\":" << mean_ms() << ",\"p50_ms\":" << percentile_ms(0.5)
+       << ",\"p99_ms\":" << percentile_ms(0.99) << ",\"max_ms\":" << max_ms() << ",\"buckets_us\":[";
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        if (i > 0)
+        {
+            ss << ",";
+        }
+        ss << _buckets[i];
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+Telemetry::Telemetry()
+{
+    _start_time = std::chrono::steady_clock::now();
+    _reporting = false;
+    _csv = false;
+    _period_sec = 5.0;
+    _publish_func = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+
+Telemetry::~Telemetry()
+{
+    stop_reporting();
+}
+
+//-----------------------------------------------------------------------------
+
+Stage_Telemetry* Telemetry::add_stage(const std::string& name, std::function<size_t (void)> queue_depth)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stage_Telemetry* stage = new Stage_Telemetry(name);
+    stage->queue_depth = queue_depth;
+    _stages.emplace_back(stage);
+    return stage;
+}
+
+//-----------------------------------------------------------------------------
+
+Latency_Histogram* Telemetry::histogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto itr = _histograms.find(name);
+    if (itr != _histograms.end())
+    {
+        return itr->second.get();
+    }
+    Latency_Histogram* hist = new Latency_Histogram();
+    _histograms[name].reset(hist);
+    return hist;
+}
+
+//-----------------------------------------------------------------------------
+
+double Telemetry::_elapsed_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time).count();
+}
+
+//-----------------------------------------------------------------------------
+
+std::string Telemetry::to_json()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::stringstream ss;
+    ss << "{\"time\":" << _elapsed_seconds() << ",\"stages\":[";
+    for (size_t i = 0; i < _stages.size(); i++)
+    {
+        Stage_Telemetry* stage = _stages[i].get();
+        size_t depth = stage->queue_depth != nullptr ? stage->queue_depth() : 0;
+        if (i > 0)
+        {
+            ss << ",";
+        }
+        ss << "{\"name\":\"" << stage->name << "\",\"blocks_in\":" << stage->blocks_in << ",\"blocks_out\":" << stage->blocks_out
+           << ",\"queue_depth\":" << depth << ",\"queue_time\":" << stage->queue_time.to_json()
+           << ",\"process_time\":" << stage->process_time.to_json() << "}";
+    }
+    ss << "],\"histograms\":{";
+    bool first = true;
+    for (const auto& itr : _histograms)
+    {
+        if (false == first)
+        {
+            ss << ",";
+        }
+        first = false;
+        ss << "\"" << itr.first << "\":" << itr.second->to_json();
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+
+std::string Telemetry::csv_header()
+{
+    return "time,name,blocks_in,blocks_out,queue_depth,queue_count,queue_mean_ms,queue_p50_ms,queue_p99_ms,queue_max_ms,process_count,process_mean_ms,process_p50_ms,process_p99_ms,process_max_ms";
+}
+
+//-----------------------------------------------------------------------------
+
+std::string Telemetry::to_csv()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::stringstream ss;
+    double now = _elapsed_seconds();
+    auto write_hist = [&ss](const Latency_Histogram& hist)
+    {
+        ss << "," << hist.count() << "," << hist.mean_ms() << "," << hist.percentile_ms(0.5) << "," << hist.percentile_ms(0.99) << "," << hist.max_ms();
+    };
+    for (auto& stage : _stages)
+    {
+        size_t depth = stage->queue_depth != nullptr ? stage->queue_depth() : 0;
+        ss << now << "," << stage->name << "," << stage->blocks_in << "," << stage->blocks_out << "," << depth;
+        write_hist(stage->queue_time);
+        write_hist(stage->process_time);
+        ss << "\n";
+    }
+    // histograms without a stage only fill the process columns
+    for (const auto& itr : _histograms)
+    {
+        ss << now << "," << itr.first << ",,,,,,,,";
+        write_hist(*itr.second);
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+
+bool Telemetry::start_reporting(const std::string& filename, double period_sec, std::function<void (const std::string&)> publish_func)
+{
+    stop_reporting();
+    _period_sec = period_sec > 0.0 ? period_sec : 1.0;
+    _publish_func = publish_func;
+    _csv = false;
+    if (filename.length() > 0)
+    {
+        _csv = (filename.length() > 4 && filename.substr(filename.length() - 4) == ".csv");
+        _file.open(filename, std::ios::out | std::ios::trunc);
+        if (false == _file.is_open())
+        {
+            logE << "Could not open telemetry file " << filename << "\n";
+            return false;
+        }
+        if (_csv)
+        {
+            _file << csv_header() << "\n";
+        }
+        logI << "Writing telemetry to " << filename << " every " << _period_sec << "s\n";
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reporting = true;
+    }
+    _thread = std::thread(&Telemetry::_report_loop, this);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void Telemetry::stop_reporting()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (false == _reporting)
+        {
+            return;
+        }
+        _reporting = false;
+    }
+    _cond.notify_all();
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+    _report();
+    if (_file.is_open())
+    {
+        _file.close();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Telemetry::log_summary()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& stage : _stages)
+    {
+        logI << stage->name << ": " << stage->blocks_out << " blocks, queue mean " << stage->queue_time.mean_ms() << "ms p99 " << stage->queue_time.percentile_ms(0.99)
+             << "ms, process mean " << stage->process_time.mean_ms() << "ms p99 " << stage->process_time.percentile_ms(0.99) << "ms\n";
+    }
+    for (const auto& itr : _histograms)
+    {
+        logI << itr.first << ": " << itr.second->count() << " calls, mean " << itr.second->mean_ms() << "ms p99 " << itr.second->percentile_ms(0.99) << "ms max " << itr.second->max_ms() << "ms\n";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Telemetry::_report_loop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_reporting)
+    {
+        _cond.wait_for(lock, std::chrono::duration<double>(_period_sec), [this] { return false == this->_reporting; });
+        if (false == _reporting)
+        {
+            break;
+        }
+        lock.unlock();
+        _report();
+        lock.lock();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Telemetry::_report()
+{
+    if (_file.is_open())
+    {
+        _file << (_csv ? to_csv() : to_json() + "\n");
+        _file.flush();
+    }
+    if (_publish_func != nullptr)
+    {
+        _publish_func(to_json());
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace workflow
@@ -0,0 +1,210 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+
+/// Initial Author <2017>: Arthur Glowacki
+
+#ifndef Telemetry_H
+#define Telemetry_H
+
+#include "core/defines.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace workflow
+{
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief Lock free latency histogram. Bucket i counts samples in [2^i, 2^(i+1)) microseconds.
+///
+class DLL_EXPORT Latency_Histogram
+{
+
+public:
+
+    static const size_t NUM_BUCKETS = 26;
+
+    Latency_Histogram();
+
+    void add(double seconds);
+
+    void add(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    void reset();
+
+    size_t count() const { return _count; }
+
+    double mean_ms() const;
+
+    double max_ms() const { return (double)_max_us / 1000.0; }
+
+    /// upper bound of the bucket holding the p (0 - 1) quantile, clamped to the max
+    double percentile_ms(double p) const;
+
+    std::string to_json() const;
+
+protected:
+
+    std::atomic<size_t> _buckets[NUM_BUCKETS];
+
+    std::atomic<size_t> _count;
+
+    std::atomic<unsigned long long> _total_us;
+
+    std::atomic<unsigned long long> _max_us;
+
+};
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief Counters for one step of a stream (source, pipeline stage or sink), updated by its threads.
+///        queue_time is how long blocks waited in the step's input queue, for the source it is the time
+///        spent blocked on a full queue. process_time is the time spent on each block.
+///
+struct DLL_EXPORT Stage_Telemetry
+{
+    Stage_Telemetry(const std::string& name_) : name(name_), blocks_in(0), blocks_out(0), queue_depth(nullptr) {}
+
+    std::string name;
+
+    std::atomic<size_t> blocks_in;
+
+    std::atomic<size_t> blocks_out;
+
+    /// sampled when a snapshot is taken
+    std::function<size_t (void)> queue_depth;
+
+    Latency_Histogram queue_time;
+
+    Latency_Histogram process_time;
+};
+
+//-----------------------------------------------------------------------------
+
+///
+/// \brief Collects stage counters and named latency histograms and periodically writes snapshots
+///        as json lines (or csv rows if the file name ends in .csv) and/or hands them to a publish function.
+///
+class DLL_EXPORT Telemetry
+{
+
+public:
+
+    Telemetry();
+
+    Telemetry(const Telemetry &) = delete;
+
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    ~Telemetry();
+
+    /// stages are reported in the order they were added
+    Stage_Telemetry* add_stage(const std::string& name, std::function<size_t (void)> queue_depth = nullptr);
+
+    /// histogram not tied to a stage, ex: fit latency per routine. Created on first use, keep the pointer.
+    Latency_Histogram* histogram(const std::string& name);
+
+    std::string to_json();
+
+    std::string to_csv();
+
+    static std::string csv_header();
+
+    /// write a snapshot every period_sec seconds until stop_reporting(). filename and publish_func are optional.
+    bool start_reporting(const std::string& filename, double period_sec, std::function<void (const std::string&)> publish_func = nullptr);
+
+    /// writes a final snapshot and stops the reporter thread
+    void stop_reporting();
+
+    /// one info line per stage and histogram
+    void log_summary();
+
+protected:
+
+    void _report_loop();
+
+    void _report();
+
+    double _elapsed_seconds();
+
+    std::chrono::steady_clock::time_point _start_time;
+
+    std::vector<std::unique_ptr<Stage_Telemetry> > _stages;
+
+    std::map<std::string, std::unique_ptr<Latency_Histogram> > _histograms;
+
+    std::mutex _mutex;
+
+    std::condition_variable _cond;
+
+    std::thread _thread;
+
+    bool _reporting;
+
+    bool _csv;
+
+    double _period_sec;
+
+    std::ofstream _file;
+
+    std::function<void (const std::string&)> _publish_func;
+
+};
+
+} //namespace workflow
+
+#endif // Telemetry_H
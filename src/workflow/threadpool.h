@@ -23,6 +23,9 @@ freely, subject to the following restrictions:
    3. This notice may not be removed or altered from any source
    distribution.
 
+Altered for XRF-Maps: optional work-stealing scheduling mode with per worker
+task deques, targeted enqueue and worker cpu pinning.
+
 ***/
 
 #ifndef THREAD_POOL_H
@@ -30,9 +33,11 @@ freely, subject to the following restrictions:
 
 #include <vector>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <future>
 #include <functional>
@@ -42,21 +47,68 @@ freely, subject to the following restrictions:
 #include <Windows.h>
 #else
 #include <sched.h>
+#include <pthread.h>
 #endif
 
 //#include "task.h"
 
+/**
+ * @brief Scheduling strategy used by ThreadPool.
+ *  SHARED_QUEUE : all workers pop from one mutex guarded FIFO (original behaviour).
+ *  WORK_STEALING : every worker owns a deque and pops from its head, idle workers steal from the tail of other deques.
+ */
+enum class Thread_Pool_Mode { SHARED_QUEUE, WORK_STEALING };
+
 class ThreadPool {
 public:
-    ThreadPool(size_t);
+    ThreadPool(size_t, Thread_Pool_Mode mode = Thread_Pool_Mode::SHARED_QUEUE);
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::result_of<F(Args...)>::type>;
 
+    // work stealing mode: queue on a given worker, it can still be stolen by idle workers
+    template<class F, class... Args>
+    auto enqueue_to(size_t worker, F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
+
     //void enqueue_task(task* t);
 
+    // pin worker i to cores[i % cores.size()]
+    bool pin_workers(const std::vector<size_t> &cores);
+
+    // core each worker is pinned to, empty if not pinned or if pinning any worker failed
+    const std::vector<size_t>& worker_cores() const { return _worker_cores; }
+
+    Thread_Pool_Mode mode() const { return _mode; }
+
+    size_t size() const { return workers.size(); }
+
+    // number of tasks taken from another worker's deque (work stealing mode only)
+    size_t num_steals() const { return _num_steals.load(); }
+
     ~ThreadPool();
 private:
+
+    // per worker task deque used in work stealing mode
+    struct Worker_Queue
+    {
+        std::mutex mutex;
+        std::deque< std::function<void()> > tasks;
+    };
+
+    void _push_task(std::function<void()> &&task, int worker = -1);
+
+    bool _pop_task(size_t idx, std::function<void()> &task);
+
+    void _shared_queue_worker();
+
+    void _work_stealing_worker(size_t idx);
+
+    // worker index of the calling thread if it belongs to this pool
+    static ThreadPool*& _local_pool() { static thread_local ThreadPool* pool = nullptr; return pool; }
+
+    static size_t& _local_index() { static thread_local size_t idx = 0; return idx; }
+
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
     // the task queue
@@ -65,35 +117,163 @@ private:
     // synchronization
     std::mutex queue_mutex;
     std::condition_variable condition;
-    bool stop;
+    std::atomic<bool> stop;
+
+    Thread_Pool_Mode _mode;
+
+    std::vector< std::unique_ptr<Worker_Queue> > _worker_queues;
+    std::atomic<size_t> _num_pending;
+    std::atomic<size_t> _num_sleeping;
+    std::atomic<size_t> _next_queue;
+    std::atomic<size_t> _num_steals;
+    std::vector<size_t> _worker_cores;
 };
 
 // the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads)
-    :   stop(false)
+inline ThreadPool::ThreadPool(size_t threads, Thread_Pool_Mode mode)
+    :   stop(false), _mode(mode), _num_pending(0), _num_sleeping(0), _next_queue(0), _num_steals(0)
+{
+    if(threads == 0)
+        threads = 1;
+
+    if(_mode == Thread_Pool_Mode::WORK_STEALING)
+    {
+        for(size_t i = 0;i<threads;++i)
+            _worker_queues.emplace_back(new Worker_Queue());
+        for(size_t i = 0;i<threads;++i)
+            workers.emplace_back([this, i]{ this->_work_stealing_worker(i); });
+    }
+    else
+    {
+        for(size_t i = 0;i<threads;++i)
+            workers.emplace_back([this]{ this->_shared_queue_worker(); });
+    }
+}
+
+inline void ThreadPool::_shared_queue_worker()
+{
+    for(;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(this->queue_mutex);
+            this->condition.wait(lock,
+                [this]{ return this->stop || !this->tasks.empty(); });
+            if(this->stop && this->tasks.empty())
+                return;
+            task = std::move(this->tasks.front());
+            this->tasks.pop();
+        }
+
+        task();
+    }
+}
+
+// look in our own deque first (head), then try to steal from the tail of the others
+inline bool ThreadPool::_pop_task(size_t idx, std::function<void()> &task)
+{
+    {
+        Worker_Queue &own = *_worker_queues[idx];
+        std::unique_lock<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            _num_pending--;
+            return true;
+        }
+    }
+    size_t num_queues = _worker_queues.size();
+    for(size_t n = 1; n < num_queues; n++)
+    {
+        Worker_Queue &victim = *_worker_queues[(idx + n) % num_queues];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if(lock.owns_lock() && !victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            _num_pending--;
+            _num_steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void ThreadPool::_work_stealing_worker(size_t idx)
+{
+    _local_pool() = this;
+    _local_index() = idx;
+    for(;;)
+    {
+        std::function<void()> task;
+        if(_pop_task(idx, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->queue_mutex);
+        if(this->stop && _num_pending.load() == 0)
+            return;
+        _num_sleeping++;
+        this->condition.wait(lock,
+            [this]{ return this->stop || _num_pending.load() > 0; });
+        _num_sleeping--;
+        if(this->stop && _num_pending.load() == 0)
+            return;
+    }
+}
+
+// tasks submitted by a worker go to the head of its own deque, others are spread round robin on the tails
+inline void ThreadPool::_push_task(std::function<void()> &&task, int worker)
 {
-    for(size_t i = 0;i<threads;++i)
-        workers.emplace_back(
-            [this]
+    if(_mode == Thread_Pool_Mode::WORK_STEALING)
+    {
+        if(stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        if(worker > -1)
+        {
+            Worker_Queue &queue = *_worker_queues[worker % _worker_queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::move(task));
+        }
+        else if(_local_pool() == this)
+        {
+            Worker_Queue &own = *_worker_queues[_local_index()];
+            std::unique_lock<std::mutex> lock(own.mutex);
+            own.tasks.emplace_front(std::move(task));
+        }
+        else
+        {
+            Worker_Queue &queue = *_worker_queues[_next_queue++ % _worker_queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::move(task));
+        }
+        _num_pending++;
+        // only touch the shared mutex if somebody could be waiting on it
+        if(_num_sleeping.load() > 0)
+        {
             {
-                for(;;)
-                {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition.wait(lock,
-                            [this]{ return this->stop || !this->tasks.empty(); });
-                        if(this->stop && this->tasks.empty())
-                            return;
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    task();
-                }
+                std::unique_lock<std::mutex> lock(queue_mutex);
             }
-        );
+            condition.notify_one();
+        }
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+
+        // don't allow enqueueing after stopping the pool
+        if(stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        tasks.emplace(std::move(task));
+        lock.unlock();
+        condition.notify_one();
+    }
 }
 
 // add new work item to the pool
@@ -108,19 +288,56 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
         );
 
     std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+    _push_task([task](){ (*task)(); });
+    return res;
+}
 
-        // don't allow enqueueing after stopping the pool
-        if(stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
+template<class F, class... Args>
+auto ThreadPool::enqueue_to(size_t worker, F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    using return_type = typename std::result_of<F(Args...)>::type;
 
-        tasks.emplace([task](){ (*task)(); });
-    }
-    condition.notify_one();
+    auto task = std::make_shared< std::packaged_task<return_type()> >(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
+
+    std::future<return_type> res = task->get_future();
+    _push_task([task](){ (*task)(); }, static_cast<int>(worker));
     return res;
 }
 
+inline bool ThreadPool::pin_workers(const std::vector<size_t> &cores)
+{
+    if(cores.size() == 0)
+        return false;
+    bool ret = true;
+    _worker_cores.clear();
+    for(size_t i = 0;i<workers.size();++i)
+    {
+        size_t core = cores[i % cores.size()];
+#if defined _WIN32 || defined __CYGWIN__
+        bool pinned = (SetThreadAffinityMask(workers[i].native_handle(), (DWORD_PTR)1 << core) != 0);
+#else
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(core, &cpuset);
+        bool pinned = (pthread_setaffinity_np(workers[i].native_handle(), sizeof(cpu_set_t), &cpuset) == 0);
+#endif
+        if(pinned)
+        {
+            _worker_cores.push_back(core);
+        }
+        ret &= pinned;
+    }
+    // numa placement is planned per worker index, only report cores if every worker is really on its core
+    if(false == ret)
+    {
+        _worker_cores.clear();
+    }
+    return ret;
+}
+
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool()
 {
@@ -65,6 +65,8 @@ Spectra_File_Source::Spectra_File_Source() : Source<data_struct::Stream_Block*>(
     _current_dataset_name = nullptr;
 	_max_num_stream_blocks = -1;
     _cb_function = std::bind(&Spectra_File_Source::cb_load_spectra_data, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6, std::placeholders::_7);
+    _alloc_function = std::bind(&Spectra_File_Source::_alloc_spectra, this, std::placeholders::_1);
+    _block_pool = data_struct::Stream_Block_Pool::inst();
 }
 
 //-----------------------------------------------------------------------------
@@ -77,6 +79,8 @@ Spectra_File_Source::Spectra_File_Source(data_struct::Analysis_Job* analysis_job
     _init_fitting_routines = true;
 	_max_num_stream_blocks = -1;
     _cb_function = std::bind(&Spectra_File_Source::cb_load_spectra_data, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6, std::placeholders::_7);
+    _alloc_function = std::bind(&Spectra_File_Source::_alloc_spectra, this, std::placeholders::_1);
+    _block_pool = data_struct::Stream_Block_Pool::inst();
 }
 
 //-----------------------------------------------------------------------------
@@ -98,7 +102,7 @@ bool Spectra_File_Source::load_netcdf_line(std::string dirpath,
 	bool retVal;
 	_current_dataset_directory = new std::string(dirpath);
 	_current_dataset_name = new std::string(filename);
-	retVal = io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(dirpath+filename, detector_num_arr, row, row_size, col_size, _cb_function, nullptr);
+	retVal = io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(dirpath+filename, detector_num_arr, row, row_size, col_size, _cb_function, nullptr, _alloc_function);
 	delete _current_dataset_directory;
 	delete _current_dataset_name;
 	return retVal;
@@ -108,11 +112,23 @@ bool Spectra_File_Source::load_netcdf_line(std::string dirpath,
 
 data_struct::Stream_Block* Spectra_File_Source::_alloc_stream_block(int detector, size_t row, size_t col, size_t height, size_t width, size_t spectra_size)
 {
-	if (_max_num_stream_blocks == -1)
+	if (_max_num_stream_blocks == -1 && _analysis_job != nullptr && _analysis_job->mem_limit > 0)
 	{
-		_max_num_stream_blocks = _analysis_job->mem_limit / (spectra_size * sizeof(real_t));
+		_max_num_stream_blocks = std::max(1LL, _analysis_job->mem_limit / (long long)(spectra_size * sizeof(real_t)));
+		logI << "Limiting stream queue to " << _max_num_stream_blocks << " blocks (" << _analysis_job->mem_limit << " bytes)\n";
+		_set_max_output_queue_size(_max_num_stream_blocks);
+		_block_pool->set_max_size(_max_num_stream_blocks);
+		// enough for the first row, the rest comes back from the sink
+		_block_pool->preallocate(width, spectra_size);
 	}
-	return new data_struct::Stream_Block(detector, row, col, height, width);
+	return _block_pool->acquire_block(detector, row, col, height, width);
+}
+
+// ----------------------------------------------------------------------------
+
+data_struct::Spectra* Spectra_File_Source::_alloc_spectra(size_t spectra_size)
+{
+	return _block_pool->acquire_spectra(spectra_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -140,6 +156,11 @@ void Spectra_File_Source::cb_load_spectra_data(size_t row, size_t col, size_t he
                 stream_block->model = cp->model;
             }
         }
+        else
+        {
+            // recycled blocks can still hold counts maps from a previous job
+            stream_block->fitting_blocks.clear();
+        }
         if(_analysis_job != nullptr)
         {
             stream_block->optimize_fit_params_preset = _analysis_job->optimize_fit_params_preset;
@@ -154,7 +175,7 @@ void Spectra_File_Source::cb_load_spectra_data(size_t row, size_t col, size_t he
     }
     else
     {
-        delete spectra;
+        _block_pool->release_spectra(spectra);
     }
 
 }
@@ -194,7 +215,7 @@ void Spectra_File_Source::run()
         }
 
 		//send end of file stream block
-		data_struct::Stream_Block* end_block = new data_struct::Stream_Block(-1, -1, -1, -1, -1);
+		data_struct::Stream_Block* end_block = _block_pool->acquire_block(-1, -1, -1, -1, -1);
 		end_block->dataset_directory = _current_dataset_directory;
 		end_block->dataset_name = _current_dataset_name;
 		end_block->del_str_ptr = true;
@@ -289,7 +310,8 @@ bool Spectra_File_Source::_load_spectra_volume_with_callback(std::string dataset
                                                         row_size,
                                                         col_size,
                                                         callback_fun,
-                                                        nullptr) )
+                                                        nullptr,
+                                                        _alloc_function) )
     {
         logE<<"load spectra "<<dataset_directory+"mda"+ DIR_END_CHAR +dataset_file<<"\n";
         delete _current_dataset_directory;
@@ -310,7 +332,7 @@ bool Spectra_File_Source::_load_spectra_volume_with_callback(std::string dataset
                     full_filename = dataset_directory + "flyXRF"+ DIR_END_CHAR + tmp_dataset_file + file_middle + std::to_string(i) + ".nc";
                     //todo: add verbose option
                     //logI<<"Loading file "<<full_filename<<"\n";
-                    io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(full_filename, detector_num_arr, i, row_size, col_size, callback_fun, nullptr);
+                    io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(full_filename, detector_num_arr, i, row_size, col_size, callback_fun, nullptr, _alloc_function);
                 }
             }
             else
@@ -337,7 +359,7 @@ bool Spectra_File_Source::_load_spectra_volume_with_callback(std::string dataset
                     }
                     row_idx_str_full += row_idx_str;
                     full_filename = dataset_directory + "flyXRF"+ DIR_END_CHAR + bnp_netcdf_base_name + row_idx_str_full + ".nc";
-                    io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(full_filename, detector_num_arr, i, row_size, col_size, callback_fun, nullptr);
+                    io::file::NetCDF_IO::inst()->load_spectra_line_with_callback(full_filename, detector_num_arr, i, row_size, col_size, callback_fun, nullptr, _alloc_function);
                 }
             }
             else
@@ -348,7 +370,7 @@ bool Spectra_File_Source::_load_spectra_volume_with_callback(std::string dataset
         }
         else if (hasHdf)
         {
-            io::file::HDF5_IO::inst()->load_spectra_volume_with_callback(dataset_directory + "flyXRF.h5"+ DIR_END_CHAR + tmp_dataset_file + file_middle + "0.h5", detector_num_arr, callback_fun, nullptr);
+            io::file::HDF5_IO::inst()->load_spectra_volume_with_callback(dataset_directory + "flyXRF.h5"+ DIR_END_CHAR + tmp_dataset_file + file_middle + "0.h5", detector_num_arr, callback_fun, nullptr, _alloc_function);
         }
 
     }
@@ -54,6 +54,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "workflow/source.h"
 #include "data_struct/stream_block.h"
+#include "data_struct/stream_block_pool.h"
 #include "data_struct/analysis_job.h"
 #include "io/file/netcdf_io.h"
 #include "io/file/mda_io.h"
@@ -104,7 +105,9 @@ protected:
 
 	data_struct::Stream_Block* _alloc_stream_block(int detector, size_t row, size_t col, size_t height, size_t width, size_t spectra_size);
 
-	int _max_num_stream_blocks;
+    data_struct::Spectra* _alloc_spectra(size_t spectra_size);
+
+	long long _max_num_stream_blocks;
 	int _allocated_stream_blocks;
 
     std::string *_current_dataset_directory;
@@ -120,6 +123,11 @@ protected:
 
     std::function <void (size_t, size_t, size_t, size_t, size_t, data_struct::Spectra*, void*)> _cb_function;
 
+    // loaders take spectra from the block pool, the sink returns them
+    data_struct::IO_Spectra_Alloc_Func_Def _alloc_function;
+
+    data_struct::Stream_Block_Pool* _block_pool;
+
     bool _init_fitting_routines;
 
 };
@@ -63,6 +63,7 @@ Spectra_Net_Streamer::Spectra_Net_Streamer(std::string port) : Sink<data_struct:
     _send_spectra = true;
 
     _callback_func = std::bind(&Spectra_Net_Streamer::stream, this, std::placeholders::_1);
+    set_release_function(std::bind(&data_struct::Stream_Block_Pool::release_block, data_struct::Stream_Block_Pool::inst(), std::placeholders::_1));
 
     std::string conn_str = "tcp://*:" + port;
 	_context = new zmq::context_t(1);
@@ -99,6 +100,7 @@ void Spectra_Net_Streamer::stream(data_struct::Stream_Block* stream_block)
 {
 #ifdef _BUILD_WITH_ZMQ
 	std::string data;
+    std::lock_guard<std::mutex> lock(_socket_mutex);
 
     if(_send_counts && _send_spectra)
     {
@@ -143,5 +145,23 @@ void Spectra_Net_Streamer::stream(data_struct::Stream_Block* stream_block)
 
 // ----------------------------------------------------------------------------
 
+void Spectra_Net_Streamer::publish(const std::string& topic, const std::string& data)
+{
+#ifdef _BUILD_WITH_ZMQ
+    std::lock_guard<std::mutex> lock(_socket_mutex);
+    zmq::message_t topic_msg(topic.c_str(), topic.length());
+    _zmq_socket->send(topic_msg, ZMQ_SNDMORE);
+    zmq::message_t message(data.c_str(), data.length());
+    if (false == _zmq_socket->send(message, 0))
+    {
+        logE << "sending ZMQ " << topic << " message"<<"\n";
+    }
+#else
+    logE<<"Spectra_Net_Streamer needs ZeroMQ to work. Recompile with option -DBUILD_WITH_ZMQ\n";
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
 } //namespace xrf
 } //namespace workflow
@@ -54,7 +54,9 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "workflow/sink.h"
 #include "data_struct/stream_block.h"
+#include "data_struct/stream_block_pool.h"
 #include "io/net/basic_serializer.h"
+#include <mutex>
 #ifdef _BUILD_WITH_ZMQ
 #include "support/zmq/zmq.hpp"
 #endif
@@ -80,12 +82,18 @@ public:
 
     void set_send_spectra(bool val) {_send_spectra = val;}
 
+    /// send a text message on its own topic, ex: XRF-Telemetry. Safe to call from another thread.
+    void publish(const std::string& topic, const std::string& data);
+
 protected:
 #ifdef _BUILD_WITH_ZMQ
 	zmq::context_t *_context;
 
 	zmq::socket_t *_zmq_socket;
 #endif
+    // zmq sockets are not thread safe, publish() runs on the telemetry thread
+    std::mutex _socket_mutex;
+
 	io::net::Basic_Serializer _serializer;
 
     bool _send_counts;
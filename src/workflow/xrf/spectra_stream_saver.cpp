@@ -59,13 +59,21 @@ namespace xrf
 Spectra_Stream_Saver::Spectra_Stream_Saver() : Sink<data_struct::Stream_Block*>()
 {
     _callback_func = std::bind(&Spectra_Stream_Saver::save_stream, this, std::placeholders::_1);
+    // blocks and saved spectra go back to the pool the sources allocate from
+    _block_pool = data_struct::Stream_Block_Pool::inst();
+    set_release_function(std::bind(&data_struct::Stream_Block_Pool::release_block, _block_pool, std::placeholders::_1));
 }
 
 //-----------------------------------------------------------------------------
 
 Spectra_Stream_Saver::~Spectra_Stream_Saver()
 {
-
+    // save whatever is left of datasets that never got an end block
+    for (auto itr : _dataset_map)
+    {
+        _finalize_dataset(itr.first, itr.second);
+    }
+    _dataset_map.clear();
 }
 
 // ----------------------------------------------------------------------------
@@ -82,7 +90,26 @@ void Spectra_Stream_Saver::save_stream(data_struct::Stream_Block* stream_block)
         if (_dataset_map.count(d_hash) > 0)
         {
             Dataset_Save* dataset = _dataset_map.at(d_hash);
-            _finalize_dataset(dataset);
+            // file sources share one pair of strings between all blocks of a dataset, the dataset already owns them
+            if (stream_block->dataset_directory == dataset->dataset_directory && stream_block->dataset_name == dataset->dataset_name)
+            {
+                stream_block->del_str_ptr = false;
+            }
+            dataset->end_received = true;
+            // blocks can still be in flight, finalize when the last row arrives
+            if (_is_dataset_complete(dataset))
+            {
+                _finalize_dataset(d_hash, dataset);
+                _dataset_map.erase(d_hash);
+            }
+        }
+        else
+        {
+            // end overtook every pixel block of the dataset, remember it and keep the strings the pixel blocks will point at
+            Dataset_Save *dataset = new Dataset_Save();
+            _take_strings(dataset, stream_block);
+            dataset->end_received = true;
+            _dataset_map.insert( {d_hash, dataset} );
         }
     }
     else
@@ -90,13 +117,6 @@ void Spectra_Stream_Saver::save_stream(data_struct::Stream_Block* stream_block)
         // Is this a new dataset
         if (_dataset_map.count(d_hash) < 1)
         {
-            // Close any open datasets because we should not get any more data from them
-            for (auto itr : _dataset_map)
-            {
-                _finalize_dataset(itr.second);
-            }
-            _dataset_map.clear();
-
             //insert new dataset
              _new_dataset(d_hash, stream_block);
         }
@@ -108,32 +128,12 @@ void Spectra_Stream_Saver::save_stream(data_struct::Stream_Block* stream_block)
             {
                 _new_detector(dataset, stream_block);
             }
-            else
-            {
-                Detector_Save* detector = dataset->detector_map.at(detector_num);
+            _add_to_row(d_hash, dataset->detector_map.at(detector_num), stream_block);
 
-                if (detector->last_row > -1 && stream_block->row() > (size_t)detector->last_row)
-                {
-                    io::file::HDF5_IO::inst()->save_stream_row(d_hash, detector_num, detector->last_row, &detector->spectra_line);
-                    for (size_t i = 0; i < detector->spectra_line.size(); i++)
-                    {
-                        if (detector->spectra_line[i] != nullptr)
-                        {
-                            delete detector->spectra_line[i];
-                            detector->spectra_line[i] = nullptr;
-                        }
-                    }
-                }
-
-                detector->last_row = stream_block->row();
-                detector->integrated_spectra.add(*stream_block->spectra);
-                //TODO: add limit checks to spectra_line
-                if (detector->spectra_line[stream_block->col()] != nullptr)
-                {
-                    delete detector->spectra_line[stream_block->col()];
-                }
-                detector->spectra_line[stream_block->col()] = stream_block->spectra;
-                stream_block->spectra = nullptr;
+            if (dataset->end_received && _is_dataset_complete(dataset))
+            {
+                _finalize_dataset(d_hash, dataset);
+                _dataset_map.erase(d_hash);
             }
         }
     }
@@ -144,31 +144,112 @@ void Spectra_Stream_Saver::save_stream(data_struct::Stream_Block* stream_block)
 void Spectra_Stream_Saver::_new_dataset(size_t d_hash, data_struct::Stream_Block* stream_block)
 {
     Dataset_Save *dataset = new Dataset_Save();
-    dataset->dataset_directory = stream_block->dataset_directory;
-    dataset->dataset_name = stream_block->dataset_name;
+    _take_strings(dataset, stream_block);
     _dataset_map.insert( {d_hash, dataset} );
     _new_detector(dataset, stream_block);
+    _add_to_row(d_hash, dataset->detector_map.at(stream_block->detector_number()), stream_block);
+}
+
+// ----------------------------------------------------------------------------
+
+void Spectra_Stream_Saver::_take_strings(Dataset_Save *dataset, data_struct::Stream_Block* stream_block)
+{
+    // the dataset deletes them, the block must not free them when it goes back to the pool
+    dataset->dataset_directory = stream_block->dataset_directory;
+    dataset->dataset_name = stream_block->dataset_name;
+    stream_block->del_str_ptr = false;
 }
 
 // ----------------------------------------------------------------------------
 
 void Spectra_Stream_Saver::_new_detector(Dataset_Save *dataset, data_struct::Stream_Block* stream_block)
 {
-    Detector_Save *detector = new Detector_Save(stream_block->width());
+    Detector_Save *detector = new Detector_Save(stream_block->height(), stream_block->width());
     dataset->detector_map.insert( { stream_block->detector_number(), detector } );
 
-    detector->integrated_spectra = *stream_block->spectra;
-    detector->spectra_line[stream_block->col()] = stream_block->spectra;
+    io::file::HDF5_IO::inst()->generate_stream_dataset(*dataset->dataset_directory, *dataset->dataset_name, stream_block->detector_number(), stream_block->height(), stream_block->width());
+}
+
+// ----------------------------------------------------------------------------
 
+void Spectra_Stream_Saver::_add_to_row(size_t d_hash, Detector_Save *detector, data_struct::Stream_Block* stream_block)
+{
+    if (stream_block->spectra == nullptr)
+    {
+        return;
+    }
+    if (stream_block->col() >= detector->width)
+    {
+        logW << "Column " << stream_block->col() << " is outside of row width " << detector->width << ". Skipping.\n";
+        return;
+    }
+
+    if (detector->integrated_spectra.size() == 0)
+    {
+        detector->integrated_spectra.setZero(stream_block->spectra->size());
+    }
+    detector->integrated_spectra.add(*stream_block->spectra);
+
+    Row_Buffer &row_buffer = detector->row_buffer[stream_block->row()];
+    if (row_buffer.spectra_line.size() == 0)
+    {
+        row_buffer.num_received = 0;
+        row_buffer.spectra_line.resize(detector->width, nullptr);
+    }
+
+    if (row_buffer.spectra_line[stream_block->col()] != nullptr)
+    {
+        _block_pool->release_spectra(row_buffer.spectra_line[stream_block->col()]);
+    }
+    else
+    {
+        row_buffer.num_received++;
+    }
     //release ownership
+    row_buffer.spectra_line[stream_block->col()] = stream_block->spectra;
     stream_block->spectra = nullptr;
 
-    io::file::HDF5_IO::inst()->generate_stream_dataset(*dataset->dataset_directory, *dataset->dataset_name, stream_block->detector_number(), stream_block->height(), stream_block->width());
+    if (row_buffer.num_received == detector->width)
+    {
+        _save_row(d_hash, stream_block->detector_number(), detector, stream_block->row());
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void Spectra_Stream_Saver::_save_row(size_t d_hash, int detector_num, Detector_Save *detector, size_t row)
+{
+    Row_Buffer &row_buffer = detector->row_buffer.at(row);
+    io::file::HDF5_IO::inst()->save_stream_row(d_hash, detector_num, row, &row_buffer.spectra_line);
+    for (size_t i = 0; i < row_buffer.spectra_line.size(); i++)
+    {
+        if (row_buffer.spectra_line[i] != nullptr)
+        {
+            _block_pool->release_spectra(row_buffer.spectra_line[i]);
+            row_buffer.spectra_line[i] = nullptr;
+        }
+    }
+    detector->row_buffer.erase(row);
+    detector->rows_saved++;
+}
+
+// ----------------------------------------------------------------------------
+
+bool Spectra_Stream_Saver::_is_dataset_complete(Dataset_Save *dataset)
+{
+    for (auto itr : dataset->detector_map)
+    {
+        if (itr.second->rows_saved < itr.second->height || itr.second->row_buffer.size() > 0)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 // ----------------------------------------------------------------------------
 
-void Spectra_Stream_Saver::_finalize_dataset(Dataset_Save *dataset)
+void Spectra_Stream_Saver::_finalize_dataset(size_t d_hash, Dataset_Save *dataset)
 {
     if (dataset != nullptr)
     {
@@ -178,7 +259,13 @@ void Spectra_Stream_Saver::_finalize_dataset(Dataset_Save *dataset)
             //save and close hdf5 for this detector
             if (detector != nullptr)
             {
-                io::file::HDF5_IO::inst()->save_itegrade_spectra(&detector->integrated_spectra);
+                // flush rows that never got all their columns
+                while (detector->row_buffer.size() > 0)
+                {
+                    _save_row(d_hash, itr.first, detector, detector->row_buffer.begin()->first);
+                }
+                data_struct::Spectra integrated_spectra = detector->integrated_spectra.to_spectra();
+                io::file::HDF5_IO::inst()->save_itegrade_spectra(&integrated_spectra);
                 ///io::file::HDF5_IO::inst()->save_scan_scalers(detector_num, stream_block->mda_io, params_override, false);
                 //io::file::HDF5_IO::inst()->close_dataset(d_hash);
             }
@@ -54,6 +54,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "workflow/sink.h"
 #include "data_struct/stream_block.h"
+#include "data_struct/stream_block_pool.h"
 #include "io/file/mda_io.h"
 #include "io/file/hdf5_io.h"
 #include <functional>
@@ -80,32 +81,54 @@ public:
 
 protected:
 
+    // columns of one row, blocks can arrive in any order
+    struct Row_Buffer
+    {
+        size_t num_received;
+        std::vector< data_struct::Spectra* > spectra_line;
+    };
+
     class Detector_Save
     {
     public:
-        Detector_Save(size_t width)
+        Detector_Save(size_t height, size_t width)
         {
-            last_row = -1;
-            spectra_line.resize(width);
-            for(size_t i=0;i<width; i++)
-            {
-                spectra_line[i] = nullptr;
-            }
+            this->height = height;
+            this->width = width;
+            rows_saved = 0;
         }
         ~Detector_Save()
         {
-            spectra_line.resize(1);
+            for(auto& itr : row_buffer)
+            {
+                for(auto* spectra : itr.second.spectra_line)
+                {
+                    if(spectra != nullptr)
+                    {
+                        delete spectra;
+                    }
+                }
+            }
+            row_buffer.clear();
         }
 
-        int last_row;
-        data_struct::Spectra integrated_spectra;
-        std::vector< data_struct::Spectra* > spectra_line;
+        size_t height;
+        size_t width;
+        size_t rows_saved;
+        data_struct::Spectra_Accumulator integrated_spectra;
+        //rows still waiting on columns, by row index
+        std::map<size_t, Row_Buffer> row_buffer;
     };
 
     class Dataset_Save
     {
     public:
-        Dataset_Save(){}
+        Dataset_Save()
+        {
+            dataset_directory = nullptr;
+            dataset_name = nullptr;
+            end_received = false;
+        }
         ~Dataset_Save()
         {
             if (dataset_directory != nullptr)
@@ -130,19 +153,31 @@ protected:
 
         std::string *dataset_directory;
         std::string *dataset_name;
+        bool end_received;
         //by detector_num
         std::map<int, Detector_Save*> detector_map;
     };
 
     void _new_dataset(size_t d_hash, data_struct::Stream_Block* stream_block);
 
+    /// dataset takes ownership of the directory and name strings of stream_block
+    void _take_strings(Dataset_Save *dataset, data_struct::Stream_Block* stream_block);
+
     void _new_detector(Dataset_Save *dataset, data_struct::Stream_Block* stream_block);
 
-    void _finalize_dataset(Dataset_Save *dataset);
+    void _add_to_row(size_t d_hash, Detector_Save *detector, data_struct::Stream_Block* stream_block);
+
+    void _save_row(size_t d_hash, int detector_num, Detector_Save *detector, size_t row);
+
+    bool _is_dataset_complete(Dataset_Save *dataset);
+
+    void _finalize_dataset(size_t d_hash, Dataset_Save *dataset);
 
     //by detector_dir + dataset hash
     std::map<size_t, Dataset_Save*> _dataset_map;
 
+    data_struct::Stream_Block_Pool* _block_pool;
+
 };
 
 //-----------------------------------------------------------------------------
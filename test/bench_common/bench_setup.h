@@ -0,0 +1,281 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+/// Shared setup of the proc_spectra benchmarks: loads the reference element data and the fit parameter override
+/// of a dataset, builds a synthetic Spectra_Volume from the detector model and times proc_spectra on a copy of it.
+/// Run the benchmarks from bin/ so the default ../reference/ and ../test/2_ID_E_dataset/ paths resolve.
+
+#ifndef Bench_Setup_H
+#define Bench_Setup_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/process_whole.h"
+#include "io/file/hl_file_io.h"
+#include "io/file/hdf5_io.h"
+
+namespace bench
+{
+
+//-----------------------------------------------------------------------------
+
+struct Bench_Args
+{
+    Bench_Args()
+    {
+        reference_dir = "../reference/";
+        dataset_dir = "../test/2_ID_E_dataset/";
+        scratch_file = "proc_spectra_bench.h5";
+        rows = 32;
+        cols = 32;
+        tile_rows = 1;
+        tile_cols = 8;
+        max_threads = std::max((size_t)1, (size_t)std::thread::hardware_concurrency());
+        repeat = 3;
+        routines = { data_struct::Fitting_Routines::ROI, data_struct::Fitting_Routines::GAUSS_MATRIX };
+    }
+
+    std::string reference_dir;
+    /// directory with maps_fit_parameters_override.txt, it picks the elements and the detector model
+    std::string dataset_dir;
+    /// proc_spectra saves its fit counts here, removed at exit
+    std::string scratch_file;
+    size_t rows;
+    size_t cols;
+    size_t tile_rows;
+    size_t tile_cols;
+    size_t max_threads;
+    /// every configuration is run this many times and the fastest run is reported
+    size_t repeat;
+    std::vector<data_struct::Fitting_Routines> routines;
+};
+
+//-----------------------------------------------------------------------------
+
+inline void print_usage(const char* name)
+{
+    printf("%s [--rows N] [--cols N] [--tile-rows N] [--tile-cols N] [--threads N] [--repeat N]\n", name);
+    printf("    [--routines roi,matrix,nnls,tails] [--reference-dir DIR] [--dataset-dir DIR] [--scratch FILE]\n");
+}
+
+//-----------------------------------------------------------------------------
+
+inline bool parse_args(int argc, char* argv[], Bench_Args& args)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string opt = argv[i];
+        if (opt == "-h" || opt == "--help" || i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+        std::string val = argv[++i];
+        if (opt == "--rows") args.rows = std::stoul(val);
+        else if (opt == "--cols") args.cols = std::stoul(val);
+        else if (opt == "--tile-rows") args.tile_rows = std::max(1ul, std::stoul(val));
+        else if (opt == "--tile-cols") args.tile_cols = std::max(1ul, std::stoul(val));
+        else if (opt == "--threads") args.max_threads = std::max(1ul, std::stoul(val));
+        else if (opt == "--repeat") args.repeat = std::max(1ul, std::stoul(val));
+        else if (opt == "--reference-dir") args.reference_dir = val + "/";
+        else if (opt == "--dataset-dir") args.dataset_dir = val + "/";
+        else if (opt == "--scratch") args.scratch_file = val;
+        else if (opt == "--routines")
+        {
+            args.routines.clear();
+            size_t start = 0;
+            while (start <= val.length())
+            {
+                size_t end = val.find(',', start);
+                if (end == std::string::npos)
+                {
+                    end = val.length();
+                }
+                std::string name = val.substr(start, end - start);
+                if (name == "roi") args.routines.push_back(data_struct::Fitting_Routines::ROI);
+                else if (name == "matrix") args.routines.push_back(data_struct::Fitting_Routines::GAUSS_MATRIX);
+                else if (name == "nnls") args.routines.push_back(data_struct::Fitting_Routines::NNLS);
+                else if (name == "tails") args.routines.push_back(data_struct::Fitting_Routines::GAUSS_TAILS);
+                else
+                {
+                    printf("Unknown fit routine %s\n", name.c_str());
+                    return false;
+                }
+                start = end + 1;
+            }
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+/// load the element database and set up detector 0 of the dataset the same way xrf_maps does
+inline bool init_job(const Bench_Args& args, data_struct::Analysis_Job& job)
+{
+    if (false == io::load_element_info(args.reference_dir + "henke.xdr", args.reference_dir + "xrf_library.csv"))
+    {
+        return false;
+    }
+    job.dataset_directory = args.dataset_dir;
+    job.detector_num_arr = { 0 };
+    job.fitting_routines = args.routines;
+    return io::init_analysis_job_detectors(&job);
+}
+
+//-----------------------------------------------------------------------------
+
+/// rows x cols pixels of the detector model with every element on its own smooth blob plus poisson noise,
+/// so neighbouring pixels differ and fit cost varies with the counts like in a real scan
+inline void make_volume(data_struct::Detector* detector, const Bench_Args& args, data_struct::Spectra_Volume& volume)
+{
+    const size_t samples = 2048;
+    data_struct::Params_Override* override_params = &detector->fit_params_override_dict;
+    fitting::models::Range energy_range = data_struct::get_energy_range(samples, &override_params->fit_params);
+
+    data_struct::Fit_Parameters fit_params = detector->model->fit_parameters();
+    for (const auto& itr : override_params->elements_to_fit)
+    {
+        fit_params.add_parameter(data_struct::Fit_Param(itr.first, (real_t)-10.0));
+    }
+
+    // scatter only, then one spectrum per element with unit amplitude on top of it
+    data_struct::Spectra scatter(samples);
+    scatter.setZero();
+    scatter.segment(energy_range.min, energy_range.count()) = detector->model->model_spectrum_mp(&fit_params, &override_params->elements_to_fit, energy_range);
+    std::vector<ArrayXr> element_spectra;
+    for (const auto& itr : override_params->elements_to_fit)
+    {
+        fit_params[itr.first].value = (real_t)0.0;
+        ArrayXr spectra = ArrayXr::Zero(samples);
+        spectra.segment(energy_range.min, energy_range.count()) = detector->model->model_spectrum_mp(&fit_params, &override_params->elements_to_fit, energy_range);
+        element_spectra.push_back(spectra - (ArrayXr)scatter);
+        fit_params[itr.first].value = (real_t)-10.0;
+    }
+
+    volume.resize_and_zero(args.rows, args.cols, samples);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> center_row, center_col;
+    for (size_t e = 0; e < element_spectra.size(); e++)
+    {
+        center_row.push_back(uniform(gen) * args.rows);
+        center_col.push_back(uniform(gen) * args.cols);
+    }
+    const double blob = 0.25 * (double)std::max(args.rows, args.cols);
+    for (size_t r = 0; r < args.rows; r++)
+    {
+        for (size_t c = 0; c < args.cols; c++)
+        {
+            ArrayXr expected = (ArrayXr)scatter * (real_t)0.2;
+            for (size_t e = 0; e < element_spectra.size(); e++)
+            {
+                double dr = (double)r - center_row[e];
+                double dc = (double)c - center_col[e];
+                double amplitude = 5.0 + 200.0 * std::exp(-(dr * dr + dc * dc) / (2.0 * blob * blob));
+                expected += element_spectra[e] * (real_t)amplitude;
+            }
+            real_t* out = volume.data() + (r * args.cols + c) * volume.stride();
+            double total = 0.0;
+            for (size_t k = 0; k < samples; k++)
+            {
+                double mean = std::max(0.0, (double)expected(k));
+                out[k] = (mean > 0.0) ? (real_t)std::poisson_distribution<int>(mean)(gen) : (real_t)0.0;
+                total += out[k];
+            }
+            volume.elapsed_livetime()(r, c) = 1.0;
+            volume.elapsed_realtime()(r, c) = 1.0;
+            volume.input_counts()(r, c) = (real_t)total;
+            volume.output_counts()(r, c) = (real_t)total;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+/// seconds one proc_spectra call takes on a fresh copy of volume, the copy is first touched by the calling thread
+inline double time_proc_spectra(data_struct::Analysis_Job& job,
+                                const data_struct::Spectra_Volume& volume,
+                                ThreadPool* tp,
+                                const Bench_Args& args,
+                                bool numa_aware)
+{
+    data_struct::Spectra_Volume copy(volume);
+    // fit routines keep per run state such as the integrated spectra, start every run from the same state
+    job.init_fit_routines(volume.samples_size(), true);
+    io::file::HDF5_IO::inst()->start_save_seq(args.scratch_file, true);
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    proc_spectra(&copy, job.get_first_detector(), tp, false, nullptr, args.tile_rows, args.tile_cols, numa_aware);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+//-----------------------------------------------------------------------------
+
+inline size_t num_tiles(const Bench_Args& args)
+{
+    return ((args.rows + args.tile_rows - 1) / args.tile_rows) * ((args.cols + args.tile_cols - 1) / args.tile_cols) * args.routines.size();
+}
+
+//-----------------------------------------------------------------------------
+
+} //namespace bench
+
+#endif // Bench_Setup_H
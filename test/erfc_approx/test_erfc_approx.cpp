@@ -0,0 +1,189 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+/// Accuracy check and micro-benchmark of fitting::models::erfc_approx against std::erfc.
+/// Returns non zero if the error bounds documented in vector_math.h do not hold.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include "fitting/models/vector_math.h"
+
+using data_struct::ArrayXr;
+using fitting::models::erfc_approx;
+
+// step() and tail() evaluate erfc on (E - E_peak) / (sqrt(2) * sigma) (+ 1 / (sqrt(2) * gamma) for the tail),
+// which covers both sides of the peak out to where the gaussian is long gone.
+static const double RANGE_MIN = -10.0;
+static const double RANGE_MAX = 10.0;
+static const int NUM_POINTS = 200001;
+
+// bounds from the erfc_approx doc comment
+#if defined _REAL_FLOAT
+static const double MAX_ABS_ERROR = 5.0e-7;
+static const double MAX_REL_ERROR = 1.0e-5;
+#else
+static const double MAX_ABS_ERROR = 2.5e-7;
+static const double MAX_REL_ERROR = 1.2e-7;
+#endif
+
+static const int BENCH_SIZE = 2048;
+static const int BENCH_ITERS = 20000;
+
+//-----------------------------------------------------------------------------
+
+static bool check_accuracy()
+{
+    ArrayXr x(NUM_POINTS);
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+        x(i) = (real_t)(RANGE_MIN + (RANGE_MAX - RANGE_MIN) * (double)i / (double)(NUM_POINTS - 1));
+    }
+
+    const ArrayXr approx = erfc_approx(x);
+
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+    double max_abs_x = 0.0;
+    double max_rel_x = 0.0;
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+        // compare against erfc of the argument actually passed in so the rounding of x is not counted
+        const double exact = std::erfc((double)x(i));
+        const double abs_err = std::abs((double)approx(i) - exact);
+        if (abs_err > max_abs)
+        {
+            max_abs = abs_err;
+            max_abs_x = x(i);
+        }
+        // relative error only means something while the result is a normal number
+        if (exact > (double)std::numeric_limits<real_t>::min())
+        {
+            const double rel_err = abs_err / exact;
+            if (rel_err > max_rel)
+            {
+                max_rel = rel_err;
+                max_rel_x = x(i);
+            }
+        }
+    }
+
+    printf("erfc_approx over [%g, %g], %d points\n", RANGE_MIN, RANGE_MAX, NUM_POINTS);
+    printf("  max abs error %.3e at x = %g (limit %.1e)\n", max_abs, max_abs_x, MAX_ABS_ERROR);
+    printf("  max rel error %.3e at x = %g (limit %.1e)\n", max_rel, max_rel_x, MAX_REL_ERROR);
+
+    bool ok = true;
+    if (max_abs > MAX_ABS_ERROR)
+    {
+        printf("FAILED: absolute error above limit\n");
+        ok = false;
+    }
+    if (max_rel > MAX_REL_ERROR)
+    {
+        printf("FAILED: relative error above limit\n");
+        ok = false;
+    }
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+
+static void benchmark()
+{
+    ArrayXr x(BENCH_SIZE);
+    for (int i = 0; i < BENCH_SIZE; i++)
+    {
+        x(i) = (real_t)(-4.0 + 8.0 * (double)i / (double)(BENCH_SIZE - 1));
+    }
+    ArrayXr out(BENCH_SIZE);
+    // keep the compiler from dropping the loops
+    double sink = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCH_ITERS; n++)
+    {
+        out = erfc_approx(x);
+        sink += out(n % BENCH_SIZE);
+    }
+    auto end = std::chrono::steady_clock::now();
+    const double approx_ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)BENCH_ITERS * BENCH_SIZE);
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCH_ITERS; n++)
+    {
+        for (int i = 0; i < BENCH_SIZE; i++)
+        {
+            out(i) = std::erfc(x(i));
+        }
+        sink += out(n % BENCH_SIZE);
+    }
+    end = std::chrono::steady_clock::now();
+    const double std_ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)BENCH_ITERS * BENCH_SIZE);
+
+    printf("benchmark, %d values x %d iterations\n", BENCH_SIZE, BENCH_ITERS);
+    printf("  erfc_approx %.3f ns/value\n", approx_ns);
+    printf("  std::erfc   %.3f ns/value\n", std_ns);
+    printf("  speedup     %.2fx (checksum %g)\n", std_ns / approx_ns, sink);
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const bool ok = check_accuracy();
+    // "--no-bench" skips the timing so the check stays quick under ctest
+    if (argc < 2 || std::string(argv[1]) != "--no-bench")
+    {
+        benchmark();
+    }
+    return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,189 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+/// Scaling of proc_spectra with thread placement. For 1, 2, 4, ... up to --threads workers runs
+///   off   : shared queue, unpinned workers (the default)
+///   pin   : shared queue, workers pinned round robin over the numa nodes (--pin-threads)
+///   numa  : work stealing, pinned workers, one block of rows per numa node (--numa-aware)
+/// and prints the fastest of --repeat runs with its speedup over "off" on one worker.
+/// With more than one numa node proc_spectra first copies the volume into node local memory, which holds a second
+/// copy of the samples until the copy finishes. That copy is timed on its own so the fitting time without it is visible.
+
+#include "bench_common/bench_setup.h"
+
+//-----------------------------------------------------------------------------
+
+enum class Placement { OFF, PIN, NUMA };
+
+static const char* placement_name(Placement placement)
+{
+    switch (placement)
+    {
+    case Placement::PIN:
+        return "pin";
+    case Placement::NUMA:
+        return "numa";
+    default:
+        return "off";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+/// the begin_relocate / relocate_tile / end_relocate pass proc_spectra runs for numa_aware pools
+static double time_relocate(const data_struct::Spectra_Volume& volume, ThreadPool* tp, const bench::Bench_Args& args, size_t& num_ranges)
+{
+    data_struct::Spectra_Volume copy(volume);
+    std::vector<Tile_Row_Range> row_ranges = generate_row_ranges(tp, copy.rows(), true);
+    num_ranges = row_ranges.size();
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    Fit_Tile_Counter counter;
+    counter.tiles_done = 0;
+    copy.begin_relocate();
+    size_t total_tiles = submit_tiles(tp, row_ranges, copy.cols(), args.tile_rows, args.tile_cols,
+                                      std::bind(localize_spectra_tile, &copy, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, &counter));
+    wait_for_tiles(&counter, total_tiles, nullptr);
+    copy.end_relocate();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    bench::Bench_Args args;
+    if (false == bench::parse_args(argc, argv, args))
+    {
+        return 1;
+    }
+
+    data_struct::Analysis_Job job;
+    if (false == bench::init_job(args, job))
+    {
+        printf("Failed to load the element info or the fit parameter override from %s\n", args.dataset_dir.c_str());
+        return 1;
+    }
+
+    data_struct::Spectra_Volume volume;
+    bench::make_volume(job.get_first_detector(), args, volume);
+    const double volume_mb = (double)(volume.rows() * volume.cols() * volume.samples_size() * sizeof(real_t)) / (1024.0 * 1024.0);
+
+    std::vector<size_t> thread_counts;
+    for (size_t n = 1; n < args.max_threads; n *= 2)
+    {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(args.max_threads);
+
+    const size_t pixels = args.rows * args.cols * args.routines.size();
+    double baseline = 0.0;
+    std::vector<std::string> lines;
+    char line[256];
+    snprintf(line, sizeof(line), "%8s %9s %10s %12s %9s %8s %12s %12s %10s", "workers", "placement", "seconds", "pixels/s", "speedup", "ranges", "relocate_s", "fit_only_s", "extra_MB");
+    lines.push_back(line);
+    for (size_t num_threads : thread_counts)
+    {
+        for (Placement placement : { Placement::OFF, Placement::PIN, Placement::NUMA })
+        {
+            Thread_Pool_Mode mode = (placement == Placement::NUMA) ? Thread_Pool_Mode::WORK_STEALING : Thread_Pool_Mode::SHARED_QUEUE;
+            double best = 0.0;
+            double best_relocate = 0.0;
+            size_t num_ranges = 1;
+            for (size_t r = 0; r < args.repeat; r++)
+            {
+                ThreadPool tp(num_threads, mode);
+                if (placement != Placement::OFF)
+                {
+                    pin_thread_pool(&tp);
+                }
+                double seconds = bench::time_proc_spectra(job, volume, &tp, args, placement == Placement::NUMA);
+                if (r == 0 || seconds < best)
+                {
+                    best = seconds;
+                }
+                if (placement == Placement::NUMA)
+                {
+                    double relocate = time_relocate(volume, &tp, args, num_ranges);
+                    if (r == 0 || relocate < best_relocate)
+                    {
+                        best_relocate = relocate;
+                    }
+                }
+            }
+            if (num_threads == 1 && placement == Placement::OFF)
+            {
+                baseline = best;
+            }
+            if (placement == Placement::NUMA)
+            {
+                // proc_spectra only relocates when the rows are split over more than one node
+                double fit_only = (num_ranges > 1) ? std::max(0.0, best - best_relocate) : best;
+                snprintf(line, sizeof(line), "%8zu %9s %10.3f %12.1f %9.2f %8zu %12.3f %12.3f %10.1f", num_threads, placement_name(placement), best, pixels / best, baseline / best,
+                         num_ranges, best_relocate, fit_only, (num_ranges > 1) ? volume_mb : 0.0);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "%8zu %9s %10.3f %12.1f %9.2f %8s %12s %12.3f %10s", num_threads, placement_name(placement), best, pixels / best, baseline / best, "1", "-", best, "-");
+            }
+            lines.push_back(line);
+        }
+    }
+
+    // proc_spectra logs while it runs, print the table in one piece at the end
+    printf("\nproc_spectra %zu x %zu pixels (%.1f MB of samples), tiles of %zu x %zu, %zu fit routine(s), %zu numa node(s), best of %zu\n",
+           args.rows, args.cols, volume_mb, args.tile_rows, args.tile_cols, args.routines.size(), get_numa_node_cores().size(), args.repeat);
+    printf("relocate_s times the begin_relocate / relocate_tile / end_relocate copy alone, extra_MB is the second copy of the samples it holds\n");
+    for (const std::string& l : lines)
+    {
+        printf("%s\n", l.c_str());
+    }
+    std::remove(args.scratch_file.c_str());
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
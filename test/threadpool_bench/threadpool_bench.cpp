@@ -0,0 +1,125 @@
+/***
+Copyright (c) 2016, UChicago Argonne, LLC. All rights reserved.
+
+Copyright 2016. UChicago Argonne, LLC. This software was produced
+under U.S. Government contract DE-AC02-06CH11357 for Argonne National
+Laboratory (ANL), which is operated by UChicago Argonne, LLC for the
+U.S. Department of Energy. The U.S. Government has rights to use,
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+UChicago Argonne, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is
+modified to produce derivative works, such modified software should
+be clearly marked, so as not to confuse it with the version available
+from ANL.
+
+Additionally, redistribution and use in source and binary forms, with
+or without modification, are permitted provided that the following
+conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the
+      distribution.
+
+    * Neither the name of UChicago Argonne, LLC, Argonne National
+      Laboratory, ANL, the U.S. Government, nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY UChicago Argonne, LLC AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL UChicago
+Argonne, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+***/
+
+/// Initial Author <2017>: Arthur Glowacki
+
+/// Compares the shared queue and work stealing thread pools on proc_spectra.
+/// For every pool mode and thread count (1, 2, 4, ... up to --threads) prints the fastest of --repeat runs
+/// as tiles per second and pixels per second, with the number of tiles the work stealing workers stole.
+
+#include "bench_common/bench_setup.h"
+
+//-----------------------------------------------------------------------------
+
+static const char* mode_name(Thread_Pool_Mode mode)
+{
+    return (mode == Thread_Pool_Mode::WORK_STEALING) ? "work_stealing" : "shared_queue";
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    bench::Bench_Args args;
+    if (false == bench::parse_args(argc, argv, args))
+    {
+        return 1;
+    }
+
+    data_struct::Analysis_Job job;
+    if (false == bench::init_job(args, job))
+    {
+        printf("Failed to load the element info or the fit parameter override from %s\n", args.dataset_dir.c_str());
+        return 1;
+    }
+
+    data_struct::Spectra_Volume volume;
+    bench::make_volume(job.get_first_detector(), args, volume);
+
+    std::vector<size_t> thread_counts;
+    for (size_t n = 1; n < args.max_threads; n *= 2)
+    {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(args.max_threads);
+
+    const size_t tiles = bench::num_tiles(args);
+    const size_t pixels = args.rows * args.cols * args.routines.size();
+    std::vector<std::string> lines;
+    char line[256];
+    snprintf(line, sizeof(line), "%-14s %8s %8s %10s %12s %12s %8s", "mode", "threads", "tiles", "seconds", "tiles/s", "pixels/s", "steals");
+    lines.push_back(line);
+    for (size_t num_threads : thread_counts)
+    {
+        for (Thread_Pool_Mode mode : { Thread_Pool_Mode::SHARED_QUEUE, Thread_Pool_Mode::WORK_STEALING })
+        {
+            double best = 0.0;
+            size_t steals = 0;
+            for (size_t r = 0; r < args.repeat; r++)
+            {
+                ThreadPool tp(num_threads, mode);
+                double seconds = bench::time_proc_spectra(job, volume, &tp, args, false);
+                if (r == 0 || seconds < best)
+                {
+                    best = seconds;
+                    steals = tp.num_steals();
+                }
+            }
+            snprintf(line, sizeof(line), "%-14s %8zu %8zu %10.3f %12.1f %12.1f %8zu", mode_name(mode), num_threads, tiles, best, tiles / best, pixels / best, steals);
+            lines.push_back(line);
+        }
+    }
+
+    // proc_spectra logs while it runs, print the table in one piece at the end
+    printf("\nproc_spectra %zu x %zu pixels, tiles of %zu x %zu, %zu fit routine(s), best of %zu\n", args.rows, args.cols, args.tile_rows, args.tile_cols, args.routines.size(), args.repeat);
+    for (const std::string& l : lines)
+    {
+        printf("%s\n", l.c_str());
+    }
+    std::remove(args.scratch_file.c_str());
+    return 0;
+}
+
+//-----------------------------------------------------------------------------